@@ -61,27 +61,117 @@
   CFG1                (P2_0) not connected.
 */
 
+/*
+  Frames
+  The constant part of each frame (Len, Cmd0, Cmd1 and fixed fields) is kept in flash.  Len counts the whole data field, including the mutable fields that SREQ_P() appends from RAM.
+*/
+static const uint8_t SysResetFrame[] PROGMEM = {0x01, 0x41, 0x00, 0x00}; // SYS_RESET_REQ
+static const uint8_t TxPowerFrame[] PROGMEM = {0x01, 0x21, 0x14}; // SYS_SET_TX_POWER + TxPower
+static const uint8_t GPIOFrame[] PROGMEM = {0x02, 0x21, 0x0E}; // SYS_GPIO + Operation, Value
+static const uint8_t ReadConfigFrame[] PROGMEM = {0x01, 0x26, 0x04}; // ZB_READ_CONFIGURATION + ConfigId
+static const uint8_t StartupKeepFrame[] PROGMEM = {0x03, 0x26, 0x05, 0x03, 0x01, 0x00}; // Keeps device specific and network parameters stored in non-volitile (NV) memory
+static const uint8_t StartupClearFrame[] PROGMEM = {0x03, 0x26, 0x05, 0x03, 0x01, 0x03}; // Clears device specific and network parameters stored in non-volitile (NV) memory
+static const uint8_t PanIDFrame[] PROGMEM = {0x04, 0x26, 0x05, 0x83, 0x02}; // ZCD_NV_PANID + PanID
+static const uint8_t ChanListFrame[] PROGMEM = {0x06, 0x26, 0x05, 0x84, 0x04}; // ZCD_NV_CHANLIST + ChanList
+static const uint8_t LogicalTypeFrame[] PROGMEM = {0x03, 0x26, 0x05, 0x87, 0x01}; // ZCD_NV_LOGICAL_TYPE + LogicalType
+static const uint8_t ZdoDirectCbFrame[] PROGMEM = {0x03, 0x26, 0x05, 0x8F, 0x01}; // ZCD_NV_ZDO_DIRECT_CB + ZdoDirectCb
+static const uint8_t PollRateFrame[] PROGMEM = {0x04, 0x26, 0x05, 0x35, 0x02}; // ZCD_NV_POLL_RATE + PollRate
+static const uint8_t QueuedPollRateFrame[] PROGMEM = {0x04, 0x26, 0x05, 0x25, 0x02}; // ZCD_NV_QUEUED_POLL_RATE + QueuedPollRate
+static const uint8_t ResponsePollRateFrame[] PROGMEM = {0x04, 0x26, 0x05, 0x26, 0x02}; // ZCD_NV_RESPONSE_POLL_RATE + ResponsePollRate
+static const uint8_t RejoinPollRateFrame[] PROGMEM = {0x04, 0x26, 0x05, 0x27, 0x02}; // ZCD_NV_REJOIN_POLL_RATE + RejoinPollRate
+static const uint8_t PollFailRetriesFrame[] PROGMEM = {0x03, 0x26, 0x05, 0x29, 0x01}; // ZCD_NV_POLL_FAILURE_RETRIES + PollFailRetries
+static const uint8_t PreCfgKeyEnableFrame[] PROGMEM = {0x03, 0x26, 0x05, 0x63, 0x01}; // ZCD_NV_PRECFGKEYS_ENABLE + PreCfgKeyEnable
+static const uint8_t PreCfgKeyFrame[] PROGMEM = {0x12, 0x26, 0x05, 0x62, 0x10}; // ZCD_NV_PRECFGKEY + PreCfgKey
+static const uint8_t ZDOStartUpFromAppFrame[] PROGMEM = {0x02, 0x25, 0x40, 0x00, 0x00};
+static const uint8_t NodeDescFrame[] PROGMEM = {0x04, 0x25, 0x02}; // ZDO_NODE_DESC_REQ + DstAddr, NWKAddrOfInterest
+static const uint8_t ZBGetShortAddrFrame[] PROGMEM = {0x01, 0x26, 0x06, 0x02};
+static const uint8_t ZBGetIEEEAddrFrame[] PROGMEM = {0x01, 0x26, 0x06, 0x01};
+static const uint8_t UtilGetDeviceInfoFrame[] PROGMEM = {0x00, 0x27, 0x00};
+static const uint8_t PermitJoinTrueFrame[] PROGMEM = {0x04, 0x25, 0x36, 0x00, 0x00, 0xFF, 0x00};
+static const uint8_t PermitJoinFalseFrame[] PROGMEM = {0x04, 0x25, 0x36, 0x00, 0x00, 0x00, 0x00};
+static const uint8_t NwkUpdateFrame[] PROGMEM = {0x0B, 0x25, 0x37, 0x00, 0x00, 0x02}; // ZDO_MGMT_NWK_UPDATE_REQ to the coordinator (Addr16Bit 0x0000) + ChannelMask, ScanDuration, ScanCount, NwkManagerAddr
+
+const uint8_t CC2530::NumBytes;
+volatile boolean CC2530::_SrdyEvent = false;
+
 /*
   Constructor
   Define pin modes and states
 */
 CC2530::CC2530(uint8_t PIN_EN, uint8_t PIN_SRDY, uint8_t PIN_RES, uint8_t PIN_SS_MRDY, uint8_t PIN_MOSI, uint8_t PIN_MISO, uint8_t PIN_SCK)
 {
+  _PINS(PIN_EN, PIN_SRDY, PIN_RES, PIN_SS_MRDY);
+  _MOSI = PIN_MOSI;
+  _MISO = PIN_MISO;
+  _SCK = PIN_SCK;
+#if defined(ARDUINO_ARCH_AVR)
+  _SrdyIn = portInputRegister(digitalPinToPort(PIN_SRDY));
+  _SrdyMask = digitalPinToBitMask(PIN_SRDY);
+  _MrdyOut = portOutputRegister(digitalPinToPort(PIN_SS_MRDY));
+  _MrdyMask = digitalPinToBitMask(PIN_SS_MRDY);
+#endif
+}
+
+#if defined(ARDUINO_ARCH_AVR)
+/*
+  Constructor
+  Used by CC2530T with the SRDY and MRDY port registers resolved at compile time.  MOSI, MISO and SCK are the hardware SPI pins.
+*/
+CC2530::CC2530(uint8_t PIN_EN, uint8_t PIN_SRDY, uint8_t PIN_RES, uint8_t PIN_SS_MRDY, PinRegister SrdyIn, uint8_t SrdyMask, PinRegister MrdyOut, uint8_t MrdyMask)
+{
+  _PINS(PIN_EN, PIN_SRDY, PIN_RES, PIN_SS_MRDY);
+  _MOSI = 11;
+  _MISO = 12;
+  _SCK = 13;
+  _SrdyIn = SrdyIn;
+  _SrdyMask = SrdyMask;
+  _MrdyOut = MrdyOut;
+  _MrdyMask = MrdyMask;
+}
+#endif
+
+#if CC2530_UART
+/*
+  Constructor
+  Drives the E18-MS1 in UART ZNP mode through Port, which the sketch has started at the E18-MS1's baud rate (e.g. Serial1.begin(115200)).  Only the EN and RES pins are used.
+*/
+CC2530::CC2530(Stream &Port, uint8_t PIN_EN, uint8_t PIN_RES)
+{
+  pinMode(PIN_RES, INPUT_PULLUP); // Not held in RESET, see WARM_START()
+  pinMode(PIN_EN, OUTPUT);
+  digitalWrite(PIN_EN, LOW);
+
+  _EN = PIN_EN;
+  _SRDY = 0xFF;
+  _RES = PIN_RES;
+  _SS_MRDY = 0xFF;
+  _MOSI = 0xFF;
+  _MISO = 0xFF;
+  _SCK = 0xFF;
+#if defined(ARDUINO_ARCH_AVR)
+  _SrdyIn = 0;
+  _MrdyOut = 0;
+  _SrdyMask = 0;
+  _MrdyMask = 0;
+#endif
+  _Uart = &Port;
+}
+#endif
+
+void CC2530::_PINS(uint8_t PIN_EN, uint8_t PIN_SRDY, uint8_t PIN_RES, uint8_t PIN_SS_MRDY)
+{
+  digitalWrite(PIN_SS_MRDY, HIGH);
   pinMode(PIN_SS_MRDY, OUTPUT);
   pinMode(PIN_SRDY, INPUT);
-  pinMode(PIN_RES, OUTPUT);
+  pinMode(PIN_RES, INPUT_PULLUP); // Not held in RESET: an E18-MS1 still running from before the application processor restarted keeps its network, see WARM_START()
   pinMode(PIN_EN, OUTPUT);
 
   digitalWrite(PIN_EN, LOW);
-  digitalWrite(PIN_RES, LOW); // Hold in RESET
 
   _EN = PIN_EN;
   _SRDY = PIN_SRDY;
   _RES = PIN_RES;
   _SS_MRDY = PIN_SS_MRDY;
-  _MOSI = PIN_MOSI;
-  _MISO = PIN_MISO;
-  _SCK = PIN_SCK;
 }
 
 /*
@@ -100,88 +190,43 @@ uint16_t CC2530::cmd_conv(uint8_t Cmd0, uint8_t Cmd1)
 */
 void CC2530::SetPANID(uint16_t Val)
 {
-  _PanID[5] = ((Val & 0xFFFF) >> 8);
-	_PanID[6] = (Val & 0xFF);
+  _Cfg.PanID[0] = ((Val & 0xFFFF) >> 8);
+	_Cfg.PanID[1] = (Val & 0xFF);
 }
 
 /*
   Set the Channel
   Description: Set the wireless channel
-  Valid Values: 0xFF or 11 to 26
+  Valid Values: 0xFF (all channels) or 11 to 26
   Default Value: 11
 */
 void CC2530::SetCHANLIST(uint8_t Val)
 {
-  if (Val == 0xFF) // Channel ALL - 0x07FFF800 (00 F8 FF 07)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0xF8; _Channel[7] = 0xFF; _Channel[8] = 0x07;
-  }
-  else if (Val == 11) // Channel 11 - 0x00000800 (00 08 00 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x08; _Channel[7] = 0x00; _Channel[8] = 0x00;
-  }
-  else if (Val == 12) // Channel 12 - 0x00001000 (00 10 00 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x10; _Channel[7] = 0x00; _Channel[8] = 0x00;
-  }
-  else if (Val == 13) // Channel 13 - 0x00002000 (00 20 00 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x20; _Channel[7] = 0x00; _Channel[8] = 0x00;
-  }
-  else if (Val == 14) // Channel 14 - 0x00004000 (00 40 00 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x40; _Channel[7] = 0x00; _Channel[8] = 0x00;
-  }
-  else if (Val == 15) // Channel 15 - 0x00008000 (00 80 00 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x80; _Channel[7] = 0x00; _Channel[8] = 0x00;
-  }
-  else if (Val == 16) // Channel 16 - 0x00010000 (00 00 01 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x01; _Channel[8] = 0x00;
-  }
-  else if (Val == 17) // Channel 17 - 0x00020000 (00 00 02 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x02; _Channel[8] = 0x00;
-  }
-  else if (Val == 18) // Channel 18 - 0x00040000 (00 00 04 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x04; _Channel[8] = 0x00;
-  }
-  else if (Val == 19) // Channel 19 - 0x00080000 (00 00 08 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x08; _Channel[8] = 0x00;
-  }
-  else if (Val == 20) // Channel 20 - 0x00100000 (00 00 10 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x10; _Channel[8] = 0x00;
-  }
-  else if (Val == 21) // Channel 21 - 0x00200000 (00 00 20 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x20; _Channel[8] = 0x00;
-  }
-  else if (Val == 22) // Channel 22 - 0x00400000 (00 00 40 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x40; _Channel[8] = 0x00;
-  }
-  else if (Val == 23) // Channel 23 - 0x00800000 (00 00 80 00)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x80; _Channel[8] = 0x00;
-  }
-  else if (Val == 24) // Channel 24 - 0x01000000 (00 00 00 01)
-  {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x00; _Channel[8] = 0x01;
-  }
-  else if (Val == 25) // Channel 25 - 0x02000000 (00 00 00 02)
+  if (Val == 0xFF)
   {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x00; _Channel[8] = 0x02;
+    SetCHANLIST_MASK(0x07FFF800);
   }
-  else if (Val == 26) // Channel 26 - 0x04000000 (00 00 00 04)
+  else if (Val >= 11 && Val <= 26)
   {
-    _Channel[5] = 0x00; _Channel[6] = 0x00; _Channel[7] = 0x00; _Channel[8] = 0x04;
+    SetCHANLIST_MASK((uint32_t) 1 << Val);
   }
 }
 
+/*
+  Set the Channel List
+  Description: Set the channels the device may use, bit n for channel n.  A coordinator forms its network on one of them, a router or end device joins a network on one of them.
+  Valid Values: Any combination of 0x00000800 (channel 11) to 0x04000000 (channel 26), other bits are ignored.  Example: 0x02108800 for channels 11, 15, 20 and 25, clear of Wi-Fi channels 1, 6 and 11
+  Default Value: 0x00000800 (channel 11)
+*/
+void CC2530::SetCHANLIST_MASK(uint32_t Mask)
+{
+  Mask &= 0x07FFF800;
+  _Cfg.ChanList[0] = Mask;
+  _Cfg.ChanList[1] = Mask >> 8;
+  _Cfg.ChanList[2] = Mask >> 16;
+  _Cfg.ChanList[3] = Mask >> 24;
+}
+
 /*
   Set the Logical Type
   Description: Set the device type.
@@ -190,7 +235,7 @@ void CC2530::SetCHANLIST(uint8_t Val)
 */
 void CC2530::SetLOGICAL_TYPE(uint8_t Val)
 {
-  _LogicalType[5] = Val;
+  _Cfg.LogicalType = Val;
 }
 
 /*
@@ -201,7 +246,7 @@ void CC2530::SetLOGICAL_TYPE(uint8_t Val)
 */
 void CC2530::SetZDO_DIRECT_CB(uint8_t Val)
 {
-  _CallBack[5] = Val;
+  _Cfg.ZdoDirectCb = Val;
 }
 
 /*
@@ -212,8 +257,8 @@ void CC2530::SetZDO_DIRECT_CB(uint8_t Val)
 */
 void CC2530::SetPOLL_RATE(uint16_t Val)
 {
-  _PollRate[5] = ((Val & 0xFFFF) >> 8);
-	_PollRate[6] = (Val & 0xFF);
+  _Cfg.PollRate[0] = ((Val & 0xFFFF) >> 8);
+	_Cfg.PollRate[1] = (Val & 0xFF);
 }
 
 /*
@@ -224,8 +269,8 @@ void CC2530::SetPOLL_RATE(uint16_t Val)
 */
 void CC2530::SetQUEUED_POLL_RATE(uint16_t Val)
 {
-  _QueuedPollRate[5] = ((Val & 0xFFFF) >> 8);
-	_QueuedPollRate[6] = (Val & 0xFF);
+  _Cfg.QueuedPollRate[0] = ((Val & 0xFFFF) >> 8);
+	_Cfg.QueuedPollRate[1] = (Val & 0xFF);
 }
 
 /*
@@ -236,8 +281,8 @@ void CC2530::SetQUEUED_POLL_RATE(uint16_t Val)
 */
 void CC2530::SetRESPONSE_POLL_RATE(uint16_t Val)
 {
-  _ResponsePollRate[5] = ((Val & 0xFFFF) >> 8);
-	_ResponsePollRate[6] = (Val & 0xFF);
+  _Cfg.ResponsePollRate[0] = ((Val & 0xFFFF) >> 8);
+	_Cfg.ResponsePollRate[1] = (Val & 0xFF);
 }
 
 /*
@@ -248,8 +293,8 @@ void CC2530::SetRESPONSE_POLL_RATE(uint16_t Val)
 */
 void CC2530::SetREJOIN_POLL_RATE(uint16_t Val)
 {
-  _RejoinPollRate[5] = ((Val & 0xFFFF) >> 8);
-	_RejoinPollRate[6] = (Val & 0xFF);
+  _Cfg.RejoinPollRate[0] = ((Val & 0xFFFF) >> 8);
+	_Cfg.RejoinPollRate[1] = (Val & 0xFF);
 }
 
 /*
@@ -260,7 +305,7 @@ void CC2530::SetREJOIN_POLL_RATE(uint16_t Val)
 */
 void CC2530::SetPOLL_FAILURE_RETRIES(uint8_t Val)
 {
-  _PollFailRetries[5] = Val;
+  _Cfg.PollFailRetries = Val;
 }
 
 /*
@@ -271,7 +316,7 @@ void CC2530::SetPOLL_FAILURE_RETRIES(uint8_t Val)
 */
 void CC2530::SetPRECFGKEYEnable(uint8_t Val)
 {
-  _PreCFGKeyEnable[5] = Val;
+  _Cfg.PreCfgKeyEnable = Val;
 }
 
 /*
@@ -282,22 +327,22 @@ void CC2530::SetPRECFGKEYEnable(uint8_t Val)
 */
 void CC2530::SetPRECFGKEY(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint8_t e, uint8_t f, uint8_t g, uint8_t h, uint8_t i, uint8_t j, uint8_t k, uint8_t l, uint8_t m, uint8_t n, uint8_t o, uint8_t p)
 {
-  _PreCFGKey[5] = a;
-  _PreCFGKey[6] = b;
-  _PreCFGKey[7] = c;
-  _PreCFGKey[8] = d;
-  _PreCFGKey[9] = e;
-  _PreCFGKey[10] = f;
-  _PreCFGKey[11] = g;
-  _PreCFGKey[12] = h;
-  _PreCFGKey[13] = i;
-  _PreCFGKey[14] = j;
-  _PreCFGKey[15] = k;
-  _PreCFGKey[16] = l;
-  _PreCFGKey[17] = m;
-  _PreCFGKey[18] = n;
-  _PreCFGKey[19] = o;
-  _PreCFGKey[20] = p;
+  _Cfg.PreCfgKey[0] = a;
+  _Cfg.PreCfgKey[1] = b;
+  _Cfg.PreCfgKey[2] = c;
+  _Cfg.PreCfgKey[3] = d;
+  _Cfg.PreCfgKey[4] = e;
+  _Cfg.PreCfgKey[5] = f;
+  _Cfg.PreCfgKey[6] = g;
+  _Cfg.PreCfgKey[7] = h;
+  _Cfg.PreCfgKey[8] = i;
+  _Cfg.PreCfgKey[9] = j;
+  _Cfg.PreCfgKey[10] = k;
+  _Cfg.PreCfgKey[11] = l;
+  _Cfg.PreCfgKey[12] = m;
+  _Cfg.PreCfgKey[13] = n;
+  _Cfg.PreCfgKey[14] = o;
+  _Cfg.PreCfgKey[15] = p;
 }
 
 /*
@@ -309,330 +354,3014 @@ void CC2530::SetPRECFGKEY(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint8_t e,
   SourceEP    0x01
   ClusterID0  0xB0
   ClusterID1  0xFE
-  TransID     0x01
+  TransID     Ignored, every request gets the next TransID (see AF_TRANS_ID())
   Options     0x00
   Radius      0x04
 */
 void CC2530::SetAF_DATA_REQUEST(uint8_t DesEP, uint8_t SourceEP, uint8_t ClusterID0, uint8_t ClusterID1, uint8_t TransID, uint8_t Options, uint8_t Radius)
 {
-  _AFDataReqCfg[0] = DesEP;
-  _AFDataReqCfg[1] = SourceEP;
-  _AFDataReqCfg[2] = ClusterID0;
-  _AFDataReqCfg[3] = ClusterID1;
-  _AFDataReqCfg[4] = TransID;
-  _AFDataReqCfg[5] = Options;
-  _AFDataReqCfg[6] = Radius;
+  _Cfg.AFDataReq[0] = DesEP;
+  _Cfg.AFDataReq[1] = SourceEP;
+  _Cfg.AFDataReq[2] = ClusterID0;
+  _Cfg.AFDataReq[3] = ClusterID1;
+  _Cfg.AFDataReq[4] = TransID;
+  _Cfg.AFDataReq[5] = Options;
+  _Cfg.AFDataReq[6] = Radius;
+}
+
+/*
+  Set parameters for AF_DATA_REQUEST_EXT
+  Description: Set the parameters for sending a AF_DATA_REQUEST_EXT
+  Valid Values: Refer to Z-Stack ZNP Interface Specification
+  Default Values:
+  DesEP       0x01
+  PanID0      0xA1
+  PanID1      0x00
+  SourceEP    0x01
+  ClusterID0  0xB0
+  ClusterID1  0xFE
+  TransID     Ignored, every request gets the next TransID (see AF_TRANS_ID())
+  Options     0x00
+  Radius      0x04
+*/
+void CC2530::SetAF_DATA_REQUEST_EXT(uint8_t DesEP, uint8_t PanID0, uint8_t PanID1, uint8_t SourceEP, uint8_t ClusterID0, uint8_t ClusterID1, uint8_t TransID, uint8_t Options, uint8_t Radius)
+{
+  _Cfg.AFDataReqExt[0] = DesEP;
+  _Cfg.AFDataReqExt[1] = PanID0;
+  _Cfg.AFDataReqExt[2] = PanID1;
+  _Cfg.AFDataReqExt[3] = SourceEP;
+  _Cfg.AFDataReqExt[4] = ClusterID0;
+  _Cfg.AFDataReqExt[5] = ClusterID1;
+  _Cfg.AFDataReqExt[6] = TransID;
+  _Cfg.AFDataReqExt[7] = Options;
+  _Cfg.AFDataReqExt[8] = Radius;
+}
+
+/*
+  Set TX_POWER
+  Description: Set the radio transmit power in dBm sent with SYS_SET_TX_POWER by COMMISSION() and COMMISSION_UPDATE().  The E18-MS1 rounds to the nearest level it supports.  TX_POWER_BEGIN() adapts the level instead and replaces this value.
+  Valid Values: -22 to 4 dBm
+  Default Value: 4 dBm
+*/
+void CC2530::SetTX_POWER(int8_t Val)
+{
+  _Cfg.TxPower = Val;
+}
+
+/*
+  Set SREQ_TIMEOUT
+  Description: The time in milliseconds to wait for the E18-MS1 to assert SRDY, either to accept a request or to return its synchronous response.  A request that times out releases MRDY and returns SREQ_TIMEOUT instead of hanging the application processor.
+  Valid Values: 1 to 65535 milliseconds
+  Default Value: 2000 milliseconds
+*/
+void CC2530::SetSREQ_TIMEOUT(uint16_t Val)
+{
+  _SreqTimeout = Val;
+}
+
+/*
+  Set RESET_TIMEOUT
+  Description: Set the longest time in milliseconds POWER_UP(), HARD_RESET_REQ() and SYS_RESET_REQ() wait for the E18-MS1 to report that it has started (SYS_RESET_IND).  The wait normally ends as soon as it has.
+  Valid Values: 1 to 65535 milliseconds
+  Default Value: 5000 milliseconds
+*/
+void CC2530::SetRESET_TIMEOUT(uint16_t Val)
+{
+  _ResetTimeout = Val;
+}
+
+/*
+  Set SPI_CLOCK
+  Description: Set the SPI clock in Hz.  The AVR SPI runs at the fastest F_CPU / 2^n that does not exceed it, e.g. 4 MHz on an 8 MHz VT1100 Mini.  A faster clock shortens every frame and the time MRDY is held.
+  Valid Values: Up to 4000000 Hz (the maximum for the CC2530 SPI slave)
+  Default Value: 2000000 Hz
+*/
+void CC2530::SetSPI_CLOCK(uint32_t Val)
+{
+  if (Val > 4000000)
+  {
+    Val = 4000000;
+  }
+  _SpiClock = Val;
+}
+
+/*
+  Set SRDY_INTERRUPT
+  Description: Enables the pin change interrupt on the SRDY pin so the application processor can sleep while it waits for the E18-MS1 (WAIT_SRDY(), SREQ_WAIT(), RECV_CALLBACK() and ZDO_STARTUP_FROM_APP()) instead of polling SRDY.  The sketch must route the pin change vector of the SRDY pin to the library, for SRDY on D8:
+    ISR(PCINT0_vect)
+    {
+      CC2530::SRDY_ISR();
+    }
+  Valid Values: true or false.  Only available on AVR boards.
+  Default Value: false
+*/
+void CC2530::SetSRDY_INTERRUPT(boolean Val)
+{
+#if defined(ARDUINO_ARCH_AVR)
+  volatile uint8_t *Pcicr = digitalPinToPCICR(_SRDY);
+  if (Pcicr == 0)
+  {
+    return;
+  }
+  if (Val)
+  {
+    *digitalPinToPCMSK(_SRDY) |= _BV(digitalPinToPCMSKbit(_SRDY));
+    *Pcicr |= _BV(digitalPinToPCICRbit(_SRDY));
+  }
+  else
+  {
+    *digitalPinToPCMSK(_SRDY) &= ~_BV(digitalPinToPCMSKbit(_SRDY)); // PCICR is left on for other pins in the group
+  }
+  _SrdyInterrupt = Val;
+#endif
+}
+
+/*
+  Set SLEEP_MODE
+  Description: The sleep mode used by WAIT_SRDY() and the functions that wait for an AREQ when SRDY_INTERRUPT is enabled.  SREQ_WAIT() always uses SLEEP_MODE_IDLE so the SREQ timeout keeps running.
+  In SLEEP_MODE_PWR_DOWN Timer0 stops, so millis() and the WAIT_SRDY() timeout only advance while awake: the wait ends on the next SRDY edge (or another wake up source such as the watchdog).
+  Valid Values: SLEEP_MODE_IDLE, SLEEP_MODE_PWR_DOWN or another avr/sleep.h mode
+  Default Value: SLEEP_MODE_IDLE
+*/
+void CC2530::SetSLEEP_MODE(uint8_t Val)
+{
+  _SleepMode = Val;
+}
+
+/*
+  Set DISPATCH_DISCARD
+  Description: For a sketch that handles every frame it needs with ON_AREQ() and ON_AF_INCOMING_MSG(): DISPATCH() removes the frames without a handler from the receive ring, counted by RX_UNHANDLED(), instead of keeping them for AF_INCOMING_MSG() or READ_FRAME().
+  Valid Values: true or false
+  Default Value: false
+*/
+void CC2530::SetDISPATCH_DISCARD(boolean Val)
+{
+  _DispatchDiscard = Val;
+}
+
+/*
+  POWER_UP
+  Description: Resets the E18-MS1 with the reset pin and waits until it has started (SYS_RESET_IND).  Returns the reset reason, or 0xFF if the E18-MS1 did not start within the reset timeout.
+*/
+uint8_t CC2530::POWER_UP()
+{
+#if CC2530_UART
+  if (!_Uart)
+#endif
+  {
+    _MRDY(HIGH);
+  }
+  pinMode(_RES, OUTPUT);
+  digitalWrite(_RES, LOW); // RESET
+  delay(1);
+  pinMode(_RES, INPUT_PULLUP); // Wake on RESET
+
+  return _WAIT_RESET_IND();
+}
+
+/*
+  WARM_START
+  Description: Resumes an E18-MS1 that kept running while the application processor restarted (brown-out, watchdog or reset button) instead of resetting it.  The device state is read with UTIL_GET_DEVICE_INFO().  If the E18-MS1 is still in the network it kept its registered endpoints and network state, so no AF_REGISTER, ZDO_STARTUP_FROM_APP() or reset is needed.
+  Returns the device state (0x06 end device, 0x07 router, 0x09 coordinator), or 0 if the E18-MS1 did not respond or is not in the network: start it with POWER_UP(), AF_REGISTER and ZDO_STARTUP_FROM_APP().
+*/
+uint8_t CC2530::WARM_START()
+{
+  uint8_t State = UTIL_GET_DEVICE_INFO();
+  if (State == 0x06 || State == 0x07 || State == 0x09)
+  {
+    DEBUG_SERIAL.print(F("Warm start, device state 0x"));
+    DEBUG_SERIAL.println(State, HEX);
+    return State;
+  }
+  return 0;
+}
+
+/*
+  Commission the E18-MS1
+  Description: Clears the network state and configuration parameters then writes the new configuration parameters to non volatile memory.  This function should only be run once when joining a network.
+*/
+void CC2530::COMMISSION()
+{
+  WRITE_DATA_P(StartupClearFrame); // ZCD_NV_STARTUP_OPTION_CLEAR
+
+  // RESET
+  SYS_RESET_REQ();
+
+  WRITE_DATA_P(StartupKeepFrame); // ZCD_NV_STARTUP_OPTION_KEEP
+  WRITE_DATA_P(LogicalTypeFrame, &_Cfg.LogicalType, 1); // ZCD_NV_LogicalType
+  WRITE_DATA_P(PanIDFrame, _Cfg.PanID, 2); // ZCD_NV_PanID
+  WRITE_DATA_P(ChanListFrame, _Cfg.ChanList, 4); // ZCD_NV_CHANLIST
+  WRITE_DATA_P(PollRateFrame, _Cfg.PollRate, 2); // ZCD_NV_POLL_RATE
+  WRITE_DATA_P(QueuedPollRateFrame, _Cfg.QueuedPollRate, 2); // ZCD_NV_QUEUED_POLL_RATE
+  WRITE_DATA_P(ResponsePollRateFrame, _Cfg.ResponsePollRate, 2); // ZCD_NV_RESPONSE_POLL_RATE
+  WRITE_DATA_P(RejoinPollRateFrame, _Cfg.RejoinPollRate, 2); // ZCD_NV_REJOIN_POLL_RATE
+  WRITE_DATA_P(PollFailRetriesFrame, &_Cfg.PollFailRetries, 1); // ZCD_NV_POLL_FAILURE_RETRIES
+  WRITE_DATA_P(ZdoDirectCbFrame, &_Cfg.ZdoDirectCb, 1); // ZCD_NV_ZDO_DIRECT_CB
+  WRITE_DATA_P(PreCfgKeyEnableFrame, &_Cfg.PreCfgKeyEnable, 1); // ZCD_NV_PRECFGKEYEnable
+  WRITE_DATA_P(PreCfgKeyFrame, _Cfg.PreCfgKey, 16); // ZCD_NV_PRECFGKEY
+  WRITE_DATA_P(TxPowerFrame, &_Cfg.TxPower, 1); // SYS_SET_TX_POWER
+
+  // IMPORTANT! RESET again to apply POLL settings.  All NV settings are saved on RESET.  If you don't RESET after setting POLL NV settings there will be a periodic POLL every few seconds.
+  SYS_RESET_REQ();
+}
+
+/*
+  Commission the E18-MS1 where it differs
+  Description: Reads each configuration parameter back from non volatile memory (ZB_READ_CONFIGURATION) and writes only the parameters that differ from the Set functions.  An E18-MS1 already commissioned with the same configuration is not written or reset.
+  A changed network parameter (logical type, PAN ID, channel list, pre-configured key) or a startup option other than keep needs the network state cleared, so COMMISSION() is run instead.  Other changed parameters are written and applied with one SYS_RESET_REQ, or on the next reset if Reset is false.
+  Returns the number of parameters written, or 0xFF if COMMISSION() was run.
+*/
+uint8_t CC2530::COMMISSION_UPDATE(boolean Reset)
+{
+  struct NvItem
+  {
+    const uint8_t *Frame;
+    uint8_t Offset; // Of the value in Config
+    boolean Network;
+  };
+  static const NvItem Items[] PROGMEM = {
+    {LogicalTypeFrame, offsetof(Config, LogicalType), true},
+    {PanIDFrame, offsetof(Config, PanID), true},
+    {ChanListFrame, offsetof(Config, ChanList), true},
+    {PreCfgKeyEnableFrame, offsetof(Config, PreCfgKeyEnable), true},
+    {PreCfgKeyFrame, offsetof(Config, PreCfgKey), true},
+    {PollRateFrame, offsetof(Config, PollRate), false},
+    {QueuedPollRateFrame, offsetof(Config, QueuedPollRate), false},
+    {ResponsePollRateFrame, offsetof(Config, ResponsePollRate), false},
+    {RejoinPollRateFrame, offsetof(Config, RejoinPollRate), false},
+    {PollFailRetriesFrame, offsetof(Config, PollFailRetries), false},
+    {ZdoDirectCbFrame, offsetof(Config, ZdoDirectCb), false},
+  };
+
+  DEBUG_SERIAL.println(F("COMMISSION_UPDATE"));
+  const uint8_t Keep = 0x00;
+  if (!_NV_MATCHES(StartupKeepFrame, &Keep))                          // A clear is still pending
+  {
+    COMMISSION();
+    return 0xFF;
+  }
+
+  uint8_t Written = 0;
+  for (uint8_t i = 0; i < sizeof(Items) / sizeof(Items[0]); i++)
+  {
+    NvItem Item;
+    memcpy_P(&Item, &Items[i], sizeof(Item));
+    const uint8_t *Value = (const uint8_t*) &_Cfg + Item.Offset;
+    if (_NV_MATCHES(Item.Frame, Value))
+    {
+      continue;
+    }
+    if (Item.Network)                                                 // Network items come first, nothing has been written yet
+    {
+      COMMISSION();
+      return 0xFF;
+    }
+    WRITE_DATA_P(Item.Frame, Value, pgm_read_byte(&Item.Frame[4]));
+    Written++;
+  }
+  WRITE_DATA_P(TxPowerFrame, &_Cfg.TxPower, 1); // SYS_SET_TX_POWER is not kept in NV
+
+  if (Written > 0 && Reset)
+  {
+    SYS_RESET_REQ();
+  }
+  return Written;
+}
+
+/*
+  Read the NV item written by a ZB_WRITE_CONFIGURATION Frame and compare it with its value at Data.  False if it differs or could not be read.
+*/
+boolean CC2530::_NV_MATCHES(const uint8_t *Frame, const uint8_t *Data)
+{
+  uint8_t ConfigId = pgm_read_byte(&Frame[3]);
+  uint8_t Len = pgm_read_byte(&Frame[4]);
+  if (WRITE_DATA_P(ReadConfigFrame, &ConfigId, 1) != SREQ_COMPLETE)
+  {
+    return 0;
+  }
+  return ReceivedBytes[3] == 0x00 && ReceivedBytes[4] == ConfigId && ReceivedBytes[5] == Len && memcmp(&ReceivedBytes[6], Data, Len) == 0; // Status, ConfigId, Len, Value
+}
+
+/*
+  POLL
+  Description: The application processor polls the E18-MS1 for queued data.  The frames are received into the receive ring, then handed to the registered handlers (see DISPATCH()).
+*/
+void CC2530::POLL()
+{
+  _POLL();
+  DISPATCH();
+}
+
+/*
+  Receive every frame the E18-MS1 has queued into the receive ring, without dispatching them
+*/
+void CC2530::_POLL()
+{
+#if CC2530_UART
+  if (_Uart)                                                          // Frames arrive unrequested, between and around SRSPs
+  {
+    _UART_RECEIVE();
+    return;
+  }
+#endif
+  if (_SreqResult == SREQ_PENDING)                                    // An SREQ owns the bus until its SRSP is read, see TICK()
+  {
+    return;
+  }
+  while (_AREQ_WAITING())                                             // If SRDY is low CC2530 has message to send
+  {
+    DEBUG_SERIAL.println(F("POLL"));
+    _MRDY(LOW);                                                       // Detect SRDY is low then make MRDY low
+    SPI.beginTransaction(SPISettings(_SpiClock, MSBFIRST, SPI_MODE0));
+    const uint8_t Poll[3] = {0x00, 0x00, 0x00};                       // POLL message: Send three zero's to CC2530 (Length = 0, Cmd0 = 0 & Cmd1 = 0)
+    _WRITE(Poll, sizeof(Poll));
+
+    unsigned long time_now = millis();
+#if CC2530_TRACE
+    unsigned long TraceStart = CC2530_TRACE_CLOCK();
+#endif
+    while (!_SRDY_HIGH())                                             // Wait for SRDY to go high (CC2530 has AREQ frame to send, and will set SRDY high when ready to send)
+    {
+      if (millis() - time_now >= _SreqTimeout)
+      {
+        SPI.endTransaction();
+        _MRDY(HIGH);
+        CC2530_TRACE_EVENT(TRACE_TIMEOUT, 0x00, 0x00, 0, SREQ_TIMEOUT, TraceStart);
+        DEBUG_SERIAL.println(F("POLL TIMEOUT"));
+        return;
+      }
+    }
+
+    uint8_t Header[3];
+    _SPI_READ(Header, sizeof(Header));
+    uint8_t Len = Header[0];
+    uint8_t Cmd0 = Header[1];
+    uint8_t Cmd1 = Header[2];
+
+    uint8_t *Frame = 0;
+    if (Len > 0)
+    {
+      if (Len > NumBytes - 3)                                         // Frame would not fit ReceivedBytes: clock it out and discard it
+      {
+        _RxOverruns++;
+        CC2530_TRACE_EVENT(TRACE_OVERRUN, Cmd0, Cmd1, Len, 0, TraceStart);
+      }
+      else
+      {
+        Frame = _RX_PUSH(Len + 3);                                    // Receive straight into the ring
+        if (Frame == 0)
+        {
+          _RxDropped++;
+          CC2530_TRACE_EVENT(TRACE_DROPPED, Cmd0, Cmd1, Len, 0, TraceStart);
+        }
+      }
+
+      if (Frame)
+      {
+        _SPI_READ(&Frame[3], Len);
+        Frame[0] = Len;
+        Frame[1] = Cmd0;
+        Frame[2] = Cmd1;
+        _RX_FRAME(Frame);
+        CC2530_TRACE_EVENT(TRACE_AREQ, Cmd0, Cmd1, Len, 0, TraceStart);
+      }
+      else
+      {
+        uint8_t Data[3] = {0xFF, 0x00, 0x00};
+        for (int i = 0; i < Len; i++)
+        {
+          uint8_t Byte = SPI.transfer(0x00);
+          if (i < 3)
+          {
+            Data[i] = Byte;
+          }
+        }
+        if (Cmd0 == 0x44 && Cmd1 == 0x80 && Len >= 3)                 // The confirm is still tracked when the ring is full
+        {
+          _AF_CONFIRM(Data[0], Data[2]);
+        }
+      }
+    }
+    SPI.endTransaction();
+    _MRDY(HIGH);                                                      // At the end of each frame set MRDY = HIGH.  SRDY will go low again if the CC2530 has another queued message to send.
+
+    if (Len > 0)
+    {
+      if (Frame)
+      {
+        _PRINT_FRAME(Frame);                                          // Printed after MRDY is released (the frame stays in the ring until popped)
+      }
+      else
+      {
+        DEBUG_SERIAL.println(F("2530 AREQ"));
+        DEBUG_SERIAL.print(F("CMD: 0x"));
+        DEBUG_SERIAL.println(cmd_conv(Cmd0, Cmd1), HEX);
+        DEBUG_SERIAL.println(F("Dropped"));
+        DEBUG_SERIAL.println(F(""));
+      }
+    }
+  }
+}
+
+/*
+  SRSP
+  Description: Synchronous response data from the E18-MS1 in response to a synchronous request by the application processor.  The response is read into ReceivedBytes.  Returns false if the response was longer than ReceivedBytes, in which case the excess bytes are discarded.
+*/
+boolean CC2530::SRSP()
+{
+  uint8_t Len;
+  boolean Fits;
+#if CC2530_UART
+  if (_Uart)                                                          // Already in ReceivedBytes, see _UART_FRAME()
+  {
+    Len = ReceivedBytes[0];
+    Fits = _UartSrsp == 1;
+    _UartSrsp = 0;
+  }
+  else
+#endif
+  {
+    _SPI_READ(ReceivedBytes, 3);
+    Len = ReceivedBytes[0];
+    Fits = Len <= NumBytes - 3;
+
+    ReceivedBytes[0] = Fits ? Len : NumBytes - 3;
+
+    if (Len > 0)
+    {
+      _SPI_READ(&ReceivedBytes[3], ReceivedBytes[0]);
+      if (!Fits)
+      {
+        for (int i = ReceivedBytes[0]; i < Len; i++)                  // Clock out and discard the excess
+        {
+          SPI.transfer(0x00);
+        }
+        _RxOverruns++;
+      }
+    }
+    SPI.endTransaction();
+    _MRDY(HIGH);                                                      // At the end of a SRSP set MRDY = HIGH.  SRDY will also remain HIGH, until the CC2530 has another queued message to send.
+  }
+
+  if (!Fits)
+  {
+    CC2530_TRACE_EVENT(TRACE_OVERRUN, ReceivedBytes[1], ReceivedBytes[2], Len, 0, _TraceSreq);
+  }
+  DEBUG_SERIAL.println(F("SRSP"));
+  if (Len > 0)
+  {
+    _PRINT_FRAME(ReceivedBytes);
+  }
+  return Fits;
+}
+
+/*
+  Print a frame (Len, Cmd0, Cmd1, Data) to the debug Serial.  Only called once MRDY is released.
+*/
+void CC2530::_PRINT_FRAME(const uint8_t *Frame)
+{
+  if (!DEBUG)
+  {
+    return;
+  }
+  DEBUG_SERIAL.println(F("2530 AREQ"));                                     // Recieve AREQ message from CC2530
+  DEBUG_SERIAL.print(F("Data length: "));
+  DEBUG_SERIAL.println(Frame[0], HEX);
+  DEBUG_SERIAL.print(F("CMD: 0x"));
+  DEBUG_SERIAL.println(cmd_conv(Frame[1], Frame[2]), HEX);                  // Bit shift Cmd0 and Cmd1 to put in correct order.
+  DEBUG_SERIAL.print(F("Data: "));
+  for (int i = 0; i < Frame[0]; i++)
+  {
+    DEBUG_SERIAL.print(Frame[i+3], HEX);
+    DEBUG_SERIAL.print(F(" "));
+  }
+  DEBUG_SERIAL.println(F(""));
+  DEBUG_SERIAL.println(F(""));
+}
+
+/*
+  Empty the Receive Buffer
+  Description: Clears ReceivedBytes and discards every frame waiting in the receive ring
+*/
+void CC2530::EMPTY_BUFFER()
+{
+  for (uint8_t n = 0; n < NumBytes; n++)
+  {
+    ReceivedBytes[n] = 0;
+  }
+  _RxHead = 0;
+  _RxTail = 0;
+  _RxUsed = 0;
+  _RxCount = 0;
+  NewData = false;
+  AFDataIncoming = false;
+}
+
+/*
+  NEW_DATA
+  Description: Function returns true when a frame is waiting in the receive ring.  The oldest frame is moved into ReceivedBytes for processing in the main sketch.
+*/
+boolean CC2530::NEW_DATA()
+{
+  return READ_FRAME(ReceivedBytes);
+}
+
+/*
+  AF_INCOMING_MSG
+  Description: Moves the oldest frame in the receive ring into ReceivedBytes.  Function returns true when that frame is an AF_INCOMING_MSG for processing in the main sketch.  Call it until it returns false with RX_AVAILABLE() at 0 to drain every frame.
+*/
+boolean CC2530::AF_INCOMING_MSG()
+{
+  if (READ_FRAME(ReceivedBytes))
+  {
+    return ReceivedBytes[1] == 0x44 && ReceivedBytes[2] == 0x81;
+  }
+  return 0;
+}
+
+/*
+  PEEK_FRAME
+  Description: Returns a pointer to the oldest frame in the receive ring (Len, Cmd0, Cmd1, Data) without removing it, or 0 when the ring is empty.  The pointer is valid until the frame is popped.
+*/
+const uint8_t *CC2530::PEEK_FRAME()
+{
+  if (_RxCount == 0)
+  {
+    return 0;
+  }
+  _RX_SKIP_WRAP();
+  return &_Ring[_RxTail];
+}
+
+/*
+  POP_FRAME
+  Description: Removes the oldest frame from the receive ring.  Returns false when the ring is empty.
+*/
+boolean CC2530::POP_FRAME()
+{
+  const uint8_t *Frame = PEEK_FRAME();
+  if (Frame == 0)
+  {
+    return 0;
+  }
+  uint8_t Size = Frame[0] + 3;
+  _RxTail += Size;
+  if (_RxTail == CC2530_RX_RING_SIZE)
+  {
+    _RxTail = 0;
+  }
+  _RxUsed -= Size;
+  _RxCount--;
+  if (_RxCount == 0)
+  {
+    _RxHead = 0;                                                      // Empty: restart at the beginning for the longest contiguous space
+    _RxTail = 0;
+    _RxUsed = 0;
+    NewData = false;
+    AFDataIncoming = false;
+  }
+  return 1;
+}
+
+/*
+  READ_FRAME
+  Description: Copies the oldest frame in the receive ring to Buf (at least 64 bytes) and removes it from the ring.  Returns false when the ring is empty.
+*/
+boolean CC2530::READ_FRAME(uint8_t *Buf)
+{
+  const uint8_t *Frame = PEEK_FRAME();
+  if (Frame == 0)
+  {
+    return 0;
+  }
+  memcpy(Buf, Frame, Frame[0] + 3);
+  return POP_FRAME();
+}
+
+/*
+  DISPATCH
+  Description: Hands the frames in the receive ring to their handlers, oldest first, until every frame has been offered once (see ON_AREQ()).  A frame without a handler is moved behind the others and stays in the ring, in the order received, for AF_INCOMING_MSG() or READ_FRAME(), so it does not hold back the frames after it.  Frames received while a handler runs are offered after the ones already in the ring.  With SetDISPATCH_DISCARD() it is removed instead.  Called by POLL().  Returns the number of frames handled.
+*/
+uint8_t CC2530::DISPATCH()
+{
+  if (_Dispatching || (_HandlerCount == 0 && _AfHandlerCount == 0))
+  {
+    return 0;
+  }
+  _Dispatching = true;
+  uint8_t Count = 0;
+  uint8_t Pending = _RxCount;                                         // Frames still to offer, oldest first
+  uint8_t Kept = 0;                                                   // Frames without a handler, moved behind the pending ones
+  const uint8_t *Frame;
+  while (Pending > 0 && (Frame = PEEK_FRAME()) != 0)
+  {
+    Pending--;
+    FrameHandler Handler = _HANDLER(Frame);
+    if (Handler == 0 && _DispatchDiscard)
+    {
+      POP_FRAME();
+      if (_RxUnhandled < 0xFFFF)
+      {
+        _RxUnhandled++;
+      }
+      continue;
+    }
+    if (Handler == 0)
+    {
+      _RX_REQUEUE();
+      Kept++;
+      continue;
+    }
+    READ_FRAME(ReceivedBytes);
+    for (uint8_t i = 0; Kept > 0 && i < Pending; i++)                 // Kept frames to the tail, so frames received by the handler queue behind the pending ones
+    {
+      _RX_REQUEUE();
+    }
+    uint8_t Before = _RxCount;
+    Handler(*this, ReceivedBytes);
+    Count++;
+    if (_RxCount > Before)
+    {
+      Pending += _RxCount - Before;
+    }
+    for (uint8_t i = 0; Pending > 0 && i < Kept; i++)                 // And back behind them
+    {
+      _RX_REQUEUE();
+    }
+  }
+  _Dispatching = false;
+  return Count;
+}
+
+/*
+  ON_AREQ
+  Description: Registers Handler for the frames with command Cmd (cmd_conv(Cmd0, Cmd1), e.g. 0x45C0), or for every frame without another handler when Cmd is 0x0000.  Replaces the handler already registered for Cmd, a null Handler removes it.  Returns false when CC2530_HANDLERS handlers are registered.
+*/
+boolean CC2530::ON_AREQ(uint16_t Cmd, FrameHandler Handler)
+{
+  uint8_t i = 0;
+  while (i < _HandlerCount && _Handlers[i].Cmd != Cmd)
+  {
+    i++;
+  }
+  if (Handler == 0)
+  {
+    if (i < _HandlerCount)
+    {
+      _Handlers[i] = _Handlers[--_HandlerCount];
+    }
+    return 1;
+  }
+  if (i == _HandlerCount)
+  {
+    if (_HandlerCount == CC2530_HANDLERS)
+    {
+      return 0;
+    }
+    _HandlerCount++;
+  }
+  _Handlers[i].Cmd = Cmd;
+  _Handlers[i].Handler = Handler;
+  return 1;
+}
+
+/*
+  ON_AF_INCOMING_MSG
+  Description: Registers Handler for the AF_INCOMING_MSGs to EndPoint with ClusterID.  Replaces the handler already registered for them, a null Handler removes it.  Returns false when CC2530_AF_HANDLERS handlers are registered.
+*/
+boolean CC2530::ON_AF_INCOMING_MSG(uint8_t EndPoint, uint16_t ClusterID, FrameHandler Handler)
+{
+  uint8_t i = 0;
+  while (i < _AfHandlerCount && (_AfHandlers[i].EndPoint != EndPoint || _AfHandlers[i].ClusterID != ClusterID))
+  {
+    i++;
+  }
+  if (Handler == 0)
+  {
+    if (i < _AfHandlerCount)
+    {
+      _AfHandlers[i] = _AfHandlers[--_AfHandlerCount];
+    }
+    return 1;
+  }
+  if (i == _AfHandlerCount)
+  {
+    if (_AfHandlerCount == CC2530_AF_HANDLERS)
+    {
+      return 0;
+    }
+    _AfHandlerCount++;
+  }
+  _AfHandlers[i].EndPoint = EndPoint;
+  _AfHandlers[i].ClusterID = ClusterID;
+  _AfHandlers[i].Handler = Handler;
+  return 1;
+}
+
+/*
+  The handler for a frame (Len, Cmd0, Cmd1, Data): by endpoint and cluster for an AF_INCOMING_MSG, then by command, then the 0x0000 handler.  0 if none.
+*/
+CC2530::FrameHandler CC2530::_HANDLER(const uint8_t *Frame)
+{
+  uint16_t Cmd = cmd_conv(Frame[1], Frame[2]);
+  if (Cmd == 0x4481 && Frame[0] >= 8)                                 // ClusterID at 5, DstEndpoint at 10
+  {
+    uint16_t ClusterID = Frame[5] | Frame[6] << 8;
+    for (uint8_t i = 0; i < _AfHandlerCount; i++)
+    {
+      if (_AfHandlers[i].EndPoint == Frame[10] && _AfHandlers[i].ClusterID == ClusterID)
+      {
+        return _AfHandlers[i].Handler;
+      }
+    }
+  }
+  FrameHandler Default = 0;
+  for (uint8_t i = 0; i < _HandlerCount; i++)
+  {
+    if (_Handlers[i].Cmd == Cmd)
+    {
+      return _Handlers[i].Handler;
+    }
+    if (_Handlers[i].Cmd == 0x0000)
+    {
+      Default = _Handlers[i].Handler;
+    }
+  }
+  return Default;
+}
+
+/*
+  GATEWAY_WRITE
+  Description: Forwards the oldest frame in the receive ring to Out (e.g. Serial at 500000 baud) as a binary gateway record and removes it from the ring.  An AF_INCOMING_MSG is written as:
+    ClusterID (2 bytes), SrcAddr (2 bytes), SrcEndpoint, DstEndpoint, LinkQuality, TransSeqNumber, Len, Data (Len bytes), CRC (2 bytes)
+  little endian, where CRC is the CRC-16/CCITT-FALSE of the record.  The record is COBS encoded (no 0x00 bytes) and ends with 0x00, so the host can find the next record after a lost byte.  The record is encoded as it is written, with Data read straight from the ring: neither the frame nor the record is copied and ReceivedBytes is not used.
+  Returns the number of bytes written, 0 if the ring is empty or the frame was not an AF_INCOMING_MSG (it is discarded and counted by GATEWAY_SKIPPED()).  Call until RX_AVAILABLE() is 0.
+*/
+uint8_t CC2530::GATEWAY_WRITE(Print &Out)
+{
+  const uint8_t *Frame = PEEK_FRAME();
+  if (Frame == 0)
+  {
+    return 0;
+  }
+  AfIncomingMsg Msg(Frame);
+  if (!Msg)
+  {
+    POP_FRAME();
+    if (_GatewaySkipped < 0xFFFF)
+    {
+      _GatewaySkipped++;
+    }
+    return 0;
+  }
+  Segment Data = Msg.Payload();
+  uint8_t Head[9];                                                    // ClusterID, SrcAddr, SrcEndpoint, DstEndpoint, LinkQuality, TransSeqNumber, Len
+  memcpy(Head, &Frame[5], 6);
+  Head[6] = Msg.LinkQuality();
+  Head[7] = Msg.TransSeqNumber();
+  Head[8] = Data.Len;
+  uint16_t Crc = _CRC16(Data.Data, Data.Len, _CRC16(Head, sizeof(Head)));
+  uint8_t Tail[2] = {lowByte(Crc), highByte(Crc)};
+  const Segment Record[3] = {{Head, sizeof(Head), false}, Data, {Tail, sizeof(Tail), false}};
+  uint8_t Length = sizeof(Head) + Data.Len + sizeof(Tail);
+
+  // COBS: each run of non-zero bytes is preceded by its length + 1, in place of the zero that ends it.  A record is shorter than 254 bytes, so a run never needs splitting.
+  uint8_t Written = 0;
+  uint8_t Start = 0;
+  for (uint8_t i = 0; i <= Length; i++)
+  {
+    if (i == Length || _SG_BYTE(Record, i) == 0x00)
+    {
+      Out.write((uint8_t) (i - Start + 1));
+      for (uint8_t k = Start; k < i; k++)
+      {
+        Out.write(_SG_BYTE(Record, k));
+      }
+      Written += i - Start + 1;
+      Start = i + 1;
+    }
+  }
+  Out.write((uint8_t) 0x00);
+  POP_FRAME();                                                        // Data was read from the ring
+  return Written + 1;
+}
+
+/*
+  GATEWAY_SKIPPED
+  Description: Returns the number of frames GATEWAY_WRITE() discarded because they were not an AF_INCOMING_MSG, saturating at 65535
+*/
+uint16_t CC2530::GATEWAY_SKIPPED()
+{
+  return _GatewaySkipped;
+}
+
+/*
+  CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) of Len bytes, continuing from Crc
+*/
+uint16_t CC2530::_CRC16(const uint8_t *Data, uint8_t Len, uint16_t Crc)
+{
+  for (uint8_t i = 0; i < Len; i++)
+  {
+    Crc ^= (uint16_t) Data[i] << 8;
+    for (uint8_t Bit = 0; Bit < 8; Bit++)
+    {
+      Crc = (Crc & 0x8000) ? (Crc << 1) ^ 0x1021 : Crc << 1;
+    }
+  }
+  return Crc;
+}
+
+/*
+  Receive Ring Statistics
+  RX_AVAILABLE    Frames waiting in the receive ring
+  RX_HIGH_WATER   Most bytes of the receive ring ever in use
+  RX_DROPPED      Frames discarded because the receive ring was full
+  RX_OVERRUNS     Frames discarded (or SRSPs truncated) because they were longer than ReceivedBytes
+  RX_ERRORS       Frames discarded because their FCS did not match (UART transport only)
+  RX_UNHANDLED    Frames discarded by DISPATCH() because they had no handler (SetDISPATCH_DISCARD() only)
+*/
+uint8_t CC2530::RX_AVAILABLE()
+{
+  return _RxCount;
+}
+
+uint8_t CC2530::RX_HIGH_WATER()
+{
+  return _RxHighWater;
+}
+
+uint16_t CC2530::RX_DROPPED()
+{
+  return _RxDropped;
+}
+
+uint16_t CC2530::RX_OVERRUNS()
+{
+  return _RxOverruns;
+}
+
+uint16_t CC2530::RX_UNHANDLED()
+{
+  return _RxUnhandled;
+}
+
+uint16_t CC2530::RX_ERRORS()
+{
+#if CC2530_UART
+  return _RxErrors;
+#else
+  return 0;
+#endif
+}
+
+/*
+  Trace
+  TRACE_COUNT     Events held in the trace ring (the oldest are overwritten when it is full)
+  TRACE_READ      Copies event Index (0 is the oldest) to Event.  Returns false when Index is out of range
+  TRACE_DUMP      Prints every event as text, oldest first
+  TRACE_WRITE     Writes every event as 11 raw bytes, oldest first, for decoding offline (see TraceEvent)
+  TRACE_CLEAR     Empties the trace ring
+  Without CC2530_TRACE the ring is always empty.
+*/
+uint8_t CC2530::TRACE_COUNT()
+{
+#if CC2530_TRACE
+  return _TraceCount;
+#else
+  return 0;
+#endif
+}
+
+boolean CC2530::TRACE_READ(uint8_t Index, TraceEvent &Event)
+{
+#if CC2530_TRACE
+  if (Index >= _TraceCount)
+  {
+    return 0;
+  }
+  uint16_t Slot = _TraceHead + CC2530_TRACE_SIZE - _TraceCount + Index;
+  Event = _Trace[Slot % CC2530_TRACE_SIZE];
+  return 1;
+#else
+  (void) Index;
+  (void) Event;
+  return 0;
+#endif
+}
+
+void CC2530::TRACE_DUMP(Print &Out)
+{
+  TraceEvent Event;
+  for (uint8_t i = 0; TRACE_READ(i, Event); i++)
+  {
+    Out.print(Event.Time);
+    switch (Event.Type)
+    {
+      case TRACE_SREQ: Out.print(F(" SREQ 0x")); break;
+      case TRACE_SRSP: Out.print(F(" SRSP 0x")); break;
+      case TRACE_AREQ: Out.print(F(" AREQ 0x")); break;
+      case TRACE_TIMEOUT: Out.print(F(" TIMEOUT 0x")); break;
+      case TRACE_DROPPED: Out.print(F(" DROPPED 0x")); break;
+      default: Out.print(F(" OVERRUN 0x")); break;
+    }
+    Out.print(cmd_conv(Event.Cmd0, Event.Cmd1), HEX);
+    Out.print(F(" len "));
+    Out.print(Event.Len);
+    Out.print(F(" status "));
+    Out.print(Event.Status, HEX);
+    Out.print(F(" wait "));
+    Out.println(Event.Wait);
+  }
+}
+
+void CC2530::TRACE_WRITE(Print &Out)
+{
+  TraceEvent Event;
+  for (uint8_t i = 0; TRACE_READ(i, Event); i++)
+  {
+    uint8_t Record[11] = {(uint8_t) Event.Time, (uint8_t) (Event.Time >> 8), (uint8_t) (Event.Time >> 16), (uint8_t) (Event.Time >> 24), lowByte(Event.Wait), highByte(Event.Wait), Event.Type, Event.Cmd0, Event.Cmd1, Event.Len, Event.Status};
+    Out.write(Record, sizeof(Record));
+  }
+}
+
+void CC2530::TRACE_CLEAR()
+{
+#if CC2530_TRACE
+  _TraceHead = 0;
+  _TraceCount = 0;
+#endif
+}
+
+/*
+  Record a trace event, overwriting the oldest when the ring is full.  Since is the CC2530_TRACE_CLOCK() at the start of the step.
+*/
+void CC2530::_TRACE(uint8_t Type, uint8_t Cmd0, uint8_t Cmd1, uint8_t Len, uint8_t Status, unsigned long Since)
+{
+#if CC2530_TRACE
+  unsigned long Now = micros();
+  unsigned long Wait = Now - Since;
+  TraceEvent &Event = _Trace[_TraceHead];
+  Event.Time = Now;
+  Event.Wait = Wait > 0xFFFF ? 0xFFFF : Wait;
+  Event.Type = Type;
+  Event.Cmd0 = Cmd0;
+  Event.Cmd1 = Cmd1;
+  Event.Len = Len;
+  Event.Status = Status;
+  _TraceHead = (_TraceHead + 1) % CC2530_TRACE_SIZE;
+  if (_TraceCount < CC2530_TRACE_SIZE)
+  {
+    _TraceCount++;
+  }
+#else
+  (void) Type; (void) Cmd0; (void) Cmd1; (void) Len; (void) Status; (void) Since;
+#endif
+}
+
+/*
+  Reserve Size contiguous bytes at the head of the receive ring.  When the end of the ring is too short the remainder is marked unused and the frame starts at the beginning.  Returns 0 when the ring is full.
+*/
+uint8_t *CC2530::_RX_PUSH(uint8_t Size)
+{
+  if (_RxUsed == CC2530_RX_RING_SIZE)
+  {
+    return 0;
+  }
+  if (_RxHead >= _RxTail)                                             // Free space is [Head, End) and [0, Tail)
+  {
+    uint8_t ToEnd = CC2530_RX_RING_SIZE - _RxHead;
+    if (Size > ToEnd)
+    {
+      if (Size > _RxTail)
+      {
+        return 0;
+      }
+      _Ring[_RxHead] = 0xFF;                                          // Wrap marker
+      _RxUsed += ToEnd;
+      _RxHead = 0;
+    }
+  }
+  else if (Size > _RxTail - _RxHead)                                  // Free space is [Head, Tail)
+  {
+    return 0;
+  }
+
+  uint8_t *Frame = &_Ring[_RxHead];
+  _RxHead += Size;
+  if (_RxHead == CC2530_RX_RING_SIZE)
+  {
+    _RxHead = 0;
+  }
+  _RxUsed += Size;
+  _RxCount++;
+  if (_RxUsed > _RxHighWater)
+  {
+    _RxHighWater = _RxUsed;
+  }
+  return Frame;
+}
+
+/*
+  Move the oldest frame to the head of the receive ring.  Popping it frees at least its size at the tail, so the push always fits.
+*/
+void CC2530::_RX_REQUEUE()
+{
+  uint8_t Frame[NumBytes];
+  const uint8_t *Oldest = PEEK_FRAME();
+  uint8_t Size = Oldest[0] + 3;
+  memcpy(Frame, Oldest, Size);
+  boolean New = NewData, Af = AFDataIncoming;
+  POP_FRAME();
+  memcpy(_RX_PUSH(Size), Frame, Size);
+  NewData = New;
+  AFDataIncoming = Af;
+}
+
+/*
+  Step the tail over a wrap marker
+*/
+void CC2530::_RX_SKIP_WRAP()
+{
+  if (_Ring[_RxTail] == 0xFF)
+  {
+    _RxUsed -= CC2530_RX_RING_SIZE - _RxTail;
+    _RxTail = 0;
+  }
+}
+
+/*
+  Account for a frame received into the ring (Len, Cmd0, Cmd1, Data): flags, AF_DATA_CONFIRM tracking, the ZDO state, the LinkQuality average for TX_POWER_BEGIN() and the device table
+*/
+void CC2530::_RX_FRAME(const uint8_t *Frame)
+{
+  _RxReceived++;
+  NewData = true;
+  if (Frame[1] == 0x44 && Frame[2] == 0x81)
+  {
+    AFDataIncoming = true;
+  }
+  AfDataConfirm Confirm(Frame);
+  if (Confirm)
+  {
+    _AF_CONFIRM(Confirm.Status(), Confirm.TransId());
+  }
+  ZdoStateChangeInd StateChange(Frame);
+  if (StateChange)
+  {
+    _ZdoState = StateChange.State();
+  }
+  if (_ScanEnergy != 0)
+  {
+    _SCAN_NOTIFY(Frame);
+  }
+  AfIncomingMsg Msg(Frame);
+  if (_TxAdapt && Msg)
+  {
+    _TxLqiAvg = _TxLqiAvg == 0 ? Msg.LinkQuality() << 3 : _TxLqiAvg - (_TxLqiAvg >> 3) + Msg.LinkQuality();
+  }
+#if CC2530_DEVICES
+  _DEVICE_FRAME(Frame);
+#endif
+}
+
+#if CC2530_UART
+/*
+  Read every byte waiting on the UART.  A frame is collected in _UartFrame until its FCS has arrived, so a partial frame is never seen by the application, then handed to _UART_FRAME().  Bytes outside a frame are skipped until the next SOF.  Frames are length delimited, so data bytes equal to the SOF need no escaping.  Returns true when the SRSP of the pending request is in ReceivedBytes.
+*/
+boolean CC2530::_UART_RECEIVE()
+{
+  int Byte;
+  while ((Byte = _Uart->read()) >= 0)
+  {
+    if (_UartPos == 0)
+    {
+      if (Byte == 0xFE)                                               // SOF
+      {
+        _UartPos = 1;
+        _UartRxFcs = 0;
+      }
+      continue;
+    }
+    uint16_t Index = _UartPos - 1;                                    // Len, Cmd0, Cmd1, Data, then FCS
+    if (Index == 0 || Index < _UartFrame[0] + 3)
+    {
+      if (Index < NumBytes)
+      {
+        _UartFrame[Index] = Byte;
+      }
+      _UartRxFcs ^= Byte;
+      _UartPos++;
+    }
+    else
+    {
+      _UartPos = 0;
+      _UART_FRAME(Byte == _UartRxFcs);
+    }
+  }
+  return _UartSrsp != 0;
+}
+
+/*
+  Act on the frame in _UartFrame: the SRSP of the pending request is copied to ReceivedBytes for TICK(), an AREQ is queued in the receive ring as POLL() does over SPI
+*/
+void CC2530::_UART_FRAME(boolean FcsOk)
+{
+  uint8_t Len = _UartFrame[0];
+  uint8_t Cmd0 = _UartFrame[1];
+  uint8_t Cmd1 = _UartFrame[2];
+  boolean Fits = Len <= NumBytes - 3;
+  if (!FcsOk)
+  {
+    _RxErrors++;
+    DEBUG_SERIAL.println(F("UART FCS ERROR"));
+    return;
+  }
+
+  if ((Cmd0 & 0xE0) == 0x60)                                          // SRSP
+  {
+    if (_SreqResult == SREQ_PENDING)                                  // Otherwise the request has timed out
+    {
+      memcpy(ReceivedBytes, _UartFrame, Fits ? Len + 3 : NumBytes);
+      ReceivedBytes[0] = Fits ? Len : NumBytes - 3;
+      _UartSrsp = Fits ? 1 : 2;
+      if (!Fits)
+      {
+        _RxOverruns++;
+      }
+    }
+    return;
+  }
+
+  uint8_t *Frame = 0;
+  if (!Fits)
+  {
+    _RxOverruns++;
+    CC2530_TRACE_EVENT(TRACE_OVERRUN, Cmd0, Cmd1, Len, 0, CC2530_TRACE_CLOCK());
+  }
+  else if ((Frame = _RX_PUSH(Len + 3)) == 0)
+  {
+    _RxDropped++;
+    CC2530_TRACE_EVENT(TRACE_DROPPED, Cmd0, Cmd1, Len, 0, CC2530_TRACE_CLOCK());
+    if (Cmd0 == 0x44 && Cmd1 == 0x80 && Len >= 3)                     // The confirm is still tracked when the ring is full
+    {
+      _AF_CONFIRM(_UartFrame[3], _UartFrame[5]);
+    }
+  }
+  if (Frame == 0)
+  {
+    DEBUG_SERIAL.println(F("2530 AREQ"));
+    DEBUG_SERIAL.print(F("CMD: 0x"));
+    DEBUG_SERIAL.println(cmd_conv(Cmd0, Cmd1), HEX);
+    DEBUG_SERIAL.println(F("Dropped"));
+    DEBUG_SERIAL.println(F(""));
+    return;
+  }
+  memcpy(Frame, _UartFrame, Len + 3);
+  _RX_FRAME(Frame);
+  CC2530_TRACE_EVENT(TRACE_AREQ, Cmd0, Cmd1, Len, 0, CC2530_TRACE_CLOCK());
+  _PRINT_FRAME(Frame);
+}
+#endif
+
+/*
+  Recieve Callback
+  Description: Polls for up to 500 milliseconds until a new frame is received.  The frame is left in the receive ring.
+*/
+void CC2530::RECV_CALLBACK()
+{
+  uint16_t Received = _RxReceived;
+  unsigned long time_now = millis();
+  unsigned long Elapsed;
+  while ((Elapsed = millis() - time_now) < 500)
+  {
+    if (!WAIT_SRDY(500 - Elapsed))
+    {
+      break;
+    }
+    _POLL();
+    if (_RxReceived != Received)
+    {
+      break;
+    }
+  }
+}
+
+/*
+  ZDO_STATE
+  Description: Returns the device state from the last ZDO_STATE_CHANGE_IND (0x06 end device, 0x07 router, 0x09 coordinator), 0 until one is received after a reset
+*/
+uint8_t CC2530::ZDO_STATE()
+{
+  return _ZdoState;
+}
+
+/*
+  WAIT_SRDY
+  Description: Waits up to Timeout milliseconds for the E18-MS1 to assert SRDY, i.e. to have an AREQ queued for POLL().  Returns true when SRDY is low.  With SetSRDY_INTERRUPT() the application processor sleeps (see SetSLEEP_MODE()) until SRDY changes instead of polling it.
+*/
+boolean CC2530::WAIT_SRDY(unsigned long Timeout)
+{
+  unsigned long time_now = millis();
+  while (!_AREQ_WAITING())
+  {
+    if (millis() - time_now >= Timeout)
+    {
+      return false;
+    }
+    _SLEEP(true);
+  }
+  return true;
+}
+
+/*
+  SRDY_ISR
+  Description: Call from the pin change interrupt vector of the SRDY pin, see SetSRDY_INTERRUPT()
+*/
+void CC2530::SRDY_ISR()
+{
+  _SrdyEvent = true;
+}
+
+/*
+  Sleep until the next interrupt unless SRDY has changed since the last call.  Deep uses the SLEEP_MODE setting, otherwise SLEEP_MODE_IDLE.  Does nothing without SRDY_INTERRUPT.
+*/
+void CC2530::_SLEEP(boolean Deep)
+{
+#if defined(ARDUINO_ARCH_AVR)
+  if (!_SrdyInterrupt)
+  {
+    return;
+  }
+  cli();
+  if (!_SrdyEvent)
+  {
+    set_sleep_mode(Deep ? _SleepMode : SLEEP_MODE_IDLE);
+    sleep_enable();
+    sei();                                                            // The instruction after sei() runs before a pending interrupt, so an SRDY edge cannot be lost before sleep_cpu()
+    sleep_cpu();
+    sleep_disable();
+  }
+  _SrdyEvent = false;
+  sei();
+#else
+  (void) Deep;
+#endif
+}
+
+/*
+  Link Quality
+  Description: Print the short address and link quality from an AF_DATA_INCOMING message.  The link quality is from the last hop.
+*/
+void CC2530::LINK_QUALITY()
+{
+  AfIncomingMsg Msg(ReceivedBytes);
+  uint16_t ShortAddr = Msg.SrcAddr();
+  uint8_t LQI = Msg.LinkQuality();
+
+  DEBUG_SERIAL.print(F("Short Address: "));
+  DEBUG_SERIAL.print(ShortAddr, HEX);
+  DEBUG_SERIAL.print(F(" "));
+  DEBUG_SERIAL.print(F("LQI: "));
+  DEBUG_SERIAL.println(LQI, DEC);
+}
+
+/*
+  Device Table
+  DEVICE_FIND       Returns the device with this short address, or 0 if it is not in the table
+  DEVICE_FIND_IEEE  Returns the device with this IEEE address (least significant byte first), or 0 if it has not announced itself
+  DEVICE_AT         Returns device Index (0 to DEVICE_COUNT() - 1), to go through the table.  Entries move when a device is removed
+  DEVICE_COUNT      Number of devices in the table
+  The table is filled by POLL() from the frames it receives.  When it is full the device seen least recently makes room for a new one.  Without CC2530_DEVICES the table is always empty.
+*/
+const CC2530::Device *CC2530::DEVICE_FIND(uint16_t ShortAddr)
+{
+#if CC2530_DEVICES
+  uint8_t Entry = _DEVICE_FIND(ShortAddr);
+  return Entry == 0xFF ? 0 : &_Devices[Entry];
+#else
+  (void) ShortAddr;
+  return 0;
+#endif
+}
+
+const CC2530::Device *CC2530::DEVICE_FIND_IEEE(const uint8_t IEEEAddr[8])
+{
+#if CC2530_DEVICES
+  uint8_t Entry = _DEVICE_FIND_IEEE(IEEEAddr);
+  return Entry == 0xFF ? 0 : &_Devices[Entry];
+#else
+  (void) IEEEAddr;
+  return 0;
+#endif
+}
+
+const CC2530::Device *CC2530::DEVICE_AT(uint8_t Index)
+{
+#if CC2530_DEVICES
+  return Index < _DevCount ? &_Devices[Index] : 0;
+#else
+  (void) Index;
+  return 0;
+#endif
+}
+
+uint8_t CC2530::DEVICE_COUNT()
+{
+#if CC2530_DEVICES
+  return _DevCount;
+#else
+  return 0;
+#endif
+}
+
+#if CC2530_DEVICES
+/*
+  Update the device table from a received frame (Len, Cmd0, Cmd1, Data)
+*/
+void CC2530::_DEVICE_FRAME(const uint8_t *Frame)
+{
+  AfIncomingMsg Msg(Frame);
+  ZdoEndDeviceAnnceInd Annce(Frame);
+  ZdoLeaveInd Leave(Frame);
+  if (Msg)
+  {
+    uint16_t ShortAddr = Msg.SrcAddr();
+    uint8_t Entry = _DEVICE_FIND(ShortAddr);
+    if (Entry == 0xFF)
+    {
+      Entry = _DEVICE_ADD(ShortAddr);
+    }
+    Device &Dev = _Devices[Entry];
+    if (Dev.Messages > 0)
+    {
+      uint8_t Skipped = Msg.TransSeqNumber() - Dev.Seq - 1;           // 0xFF for a repeated frame
+      if (Skipped < 0x80)
+      {
+        Dev.Gaps += Skipped;
+      }
+      Dev.LQI = (3 * Dev.LQI + Msg.LinkQuality() + 2) / 4;
+    }
+    else
+    {
+      Dev.LQI = Msg.LinkQuality();
+    }
+    Dev.Seq = Msg.TransSeqNumber();
+    if (Dev.Messages < 0xFFFF)
+    {
+      Dev.Messages++;
+    }
+    Dev.LastSeen = millis();
+  }
+  else if (Annce)
+  {
+    _DEVICE_ANNOUNCE(Annce.NwkAddr(), Annce.IEEEAddr());
+  }
+  else if (Leave && Leave.Rejoin() == 0x00)
+  {
+    uint8_t Entry = _DEVICE_FIND_IEEE(Leave.ExtAddr());
+    if (Entry == 0xFF)
+    {
+      Entry = _DEVICE_FIND(Leave.SrcAddr());
+    }
+    if (Entry != 0xFF)
+    {
+      _DEVICE_REMOVE(Entry);
+    }
+  }
+}
+
+/*
+  A device joined or rejoined with ShortAddr.  A device known by its IEEE address under another short address takes the new one.  A device taking over the short address of another starts with cleared statistics.
+*/
+void CC2530::_DEVICE_ANNOUNCE(uint16_t ShortAddr, const uint8_t IEEEAddr[8])
+{
+  uint8_t Entry = _DEVICE_FIND_IEEE(IEEEAddr);
+  uint8_t Other = _DEVICE_FIND(ShortAddr);
+  if (Entry == 0xFF)
+  {
+    Entry = Other == 0xFF ? _DEVICE_ADD(ShortAddr) : Other;
+    if (_IEEE_KNOWN(_Devices[Entry].IEEEAddr))                        // The short address was reused by another device
+    {
+      _DEVICE_UNINDEX(Entry, true);
+      Device &Dev = _Devices[Entry];
+      Dev.LQI = 0;                                                    // Its statistics are not the new device's
+      Dev.Seq = 0;
+      Dev.Messages = 0;
+      Dev.Gaps = 0;
+    }
+    memcpy(_Devices[Entry].IEEEAddr, IEEEAddr, 8);
+    _DEVICE_INDEX(Entry, true);
+  }
+  else if (_Devices[Entry].ShortAddr != ShortAddr)
+  {
+    if (Other != 0xFF)
+    {
+      _DEVICE_REMOVE(Other);                                          // The entry may move into the removed one
+      Entry = _DEVICE_FIND_IEEE(IEEEAddr);
+    }
+    _DEVICE_UNINDEX(Entry, false);
+    _Devices[Entry].ShortAddr = ShortAddr;
+    _DEVICE_INDEX(Entry, false);
+  }
+  _Devices[Entry].LastSeen = millis();
+}
+
+/*
+  Find a device by short or IEEE address.  Returns its entry, or 0xFF.
+*/
+uint8_t CC2530::_DEVICE_FIND(uint16_t ShortAddr)
+{
+  for (uint8_t h = _HASH_SHORT(ShortAddr); _DevByShort[h] != 0; h = h + 1 < CC2530_DEVICE_HASH ? h + 1 : 0)
+  {
+    if (_Devices[_DevByShort[h] - 1].ShortAddr == ShortAddr)
+    {
+      return _DevByShort[h] - 1;
+    }
+  }
+  return 0xFF;
+}
+
+uint8_t CC2530::_DEVICE_FIND_IEEE(const uint8_t IEEEAddr[8])
+{
+  for (uint8_t h = _HASH_IEEE(IEEEAddr); _DevByIEEE[h] != 0; h = h + 1 < CC2530_DEVICE_HASH ? h + 1 : 0)
+  {
+    if (memcmp(_Devices[_DevByIEEE[h] - 1].IEEEAddr, IEEEAddr, 8) == 0)
+    {
+      return _DevByIEEE[h] - 1;
+    }
+  }
+  return 0xFF;
+}
+
+/*
+  Add a device with an unknown IEEE address, removing the device seen least recently when the table is full.  Returns its entry.
+*/
+uint8_t CC2530::_DEVICE_ADD(uint16_t ShortAddr)
+{
+  if (_DevCount == CC2530_DEVICES)
+  {
+    unsigned long Now = millis();
+    uint8_t Oldest = 0;
+    for (uint8_t i = 1; i < _DevCount; i++)
+    {
+      if (Now - _Devices[i].LastSeen > Now - _Devices[Oldest].LastSeen)
+      {
+        Oldest = i;
+      }
+    }
+    _DEVICE_REMOVE(Oldest);
+  }
+  uint8_t Entry = _DevCount++;
+  memset(&_Devices[Entry], 0, sizeof(Device));
+  _Devices[Entry].ShortAddr = ShortAddr;
+  _Devices[Entry].LastSeen = millis();
+  _DEVICE_INDEX(Entry, false);
+  return Entry;
+}
+
+/*
+  Remove a device.  The last entry moves into its place.
+*/
+void CC2530::_DEVICE_REMOVE(uint8_t Entry)
+{
+  _DEVICE_UNINDEX(Entry, false);
+  if (_IEEE_KNOWN(_Devices[Entry].IEEEAddr))
+  {
+    _DEVICE_UNINDEX(Entry, true);
+  }
+  uint8_t Last = --_DevCount;
+  if (Entry == Last)
+  {
+    return;
+  }
+  _DEVICE_UNINDEX(Last, false);
+  if (_IEEE_KNOWN(_Devices[Last].IEEEAddr))
+  {
+    _DEVICE_UNINDEX(Last, true);
+    _Devices[Entry] = _Devices[Last];
+    _DEVICE_INDEX(Entry, true);
+  }
+  else
+  {
+    _Devices[Entry] = _Devices[Last];
+  }
+  _DEVICE_INDEX(Entry, false);
+}
+
+/*
+  Insert an entry into the short (IEEE false) or IEEE address hash.  The hashes are never more than half full.
+*/
+void CC2530::_DEVICE_INDEX(uint8_t Entry, boolean IEEE)
+{
+  uint8_t *Hash = IEEE ? _DevByIEEE : _DevByShort;
+  uint8_t h = _DEVICE_HASH(Entry, IEEE);
+  while (Hash[h] != 0)
+  {
+    h = h + 1 < CC2530_DEVICE_HASH ? h + 1 : 0;
+  }
+  Hash[h] = Entry + 1;
+}
+
+/*
+  Remove an entry from a hash.  The entries after it in the same run are shifted back so every lookup still ends at an empty slot.
+*/
+void CC2530::_DEVICE_UNINDEX(uint8_t Entry, boolean IEEE)
+{
+  uint8_t *Hash = IEEE ? _DevByIEEE : _DevByShort;
+  uint8_t Hole = _DEVICE_HASH(Entry, IEEE);
+  while (Hash[Hole] != Entry + 1)
+  {
+    if (Hash[Hole] == 0)
+    {
+      return;
+    }
+    Hole = Hole + 1 < CC2530_DEVICE_HASH ? Hole + 1 : 0;
+  }
+  for (uint8_t h = Hole + 1 < CC2530_DEVICE_HASH ? Hole + 1 : 0; Hash[h] != 0; h = h + 1 < CC2530_DEVICE_HASH ? h + 1 : 0)
+  {
+    uint8_t Home = _DEVICE_HASH(Hash[h] - 1, IEEE);
+    boolean Stays = Hole <= h ? (Hole < Home && Home <= h) : (Hole < Home || Home <= h); // Home lies cyclically in (Hole, h]
+    if (!Stays)
+    {
+      Hash[Hole] = Hash[h];
+      Hole = h;
+    }
+  }
+  Hash[Hole] = 0;
+}
+
+uint8_t CC2530::_DEVICE_HASH(uint8_t Entry, boolean IEEE)
+{
+  return IEEE ? _HASH_IEEE(_Devices[Entry].IEEEAddr) : _HASH_SHORT(_Devices[Entry].ShortAddr);
+}
+
+uint8_t CC2530::_HASH_SHORT(uint16_t ShortAddr)
+{
+  return (uint16_t) (ShortAddr * 0x9E37u) % CC2530_DEVICE_HASH;       // Short addresses are random, the multiply spreads sequential ones
+}
+
+uint8_t CC2530::_HASH_IEEE(const uint8_t IEEEAddr[8])
+{
+  uint32_t Hash = 2166136261UL;                                       // FNV-1a, every byte changes all the bits, so devices of one vendor (same OUI, sequential serials) spread
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    Hash = (Hash ^ IEEEAddr[i]) * 16777619UL;
+  }
+  return (Hash ^ Hash >> 16) % CC2530_DEVICE_HASH;
+}
+
+boolean CC2530::_IEEE_KNOWN(const uint8_t IEEEAddr[8])
+{
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    if (IEEEAddr[i] != 0)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif
+
+/*
+  Hardware Reset 2530
+  Description: Reset the E18-MS1 using the reset pin and wait until it has started (SYS_RESET_IND).  Returns the reset reason, or 0xFF on timeout.
+*/
+uint8_t CC2530::HARD_RESET_REQ()
+{
+  DEBUG_SERIAL.println("");
+  DEBUG_SERIAL.println(F("HARDWARE RESET"));
+  pinMode(_RES, OUTPUT);
+  digitalWrite(_RES, LOW);
+  delay(100);
+  pinMode(_RES, INPUT_PULLUP);                                      // Wake on RESET
+  DEBUG_SERIAL.println("");
+  return _WAIT_RESET_IND();
+}
+
+/*
+  SYS_RESET_REQ
+  Description: Reset the E18-MS1 using software through an internal watchdog reset and wait until it has started (SYS_RESET_IND).  Returns the reset reason, or 0xFF on timeout.
+*/
+uint8_t CC2530::SYS_RESET_REQ()
+{
+  DEBUG_SERIAL.println("");
+  DEBUG_SERIAL.println(F("SYS_RESET_REQ"));
+  WRITE_DATA_P(SysResetFrame); // SYS_RESET_REQ
+  return _WAIT_RESET_IND();
+}
+
+/*
+  SYS_RESET_IND
+  Description: Copies the SYS_RESET_IND the E18-MS1 sent after the last reset (POWER_UP(), HARD_RESET_REQ() or SYS_RESET_REQ()) into Ind.  Returns false if it was not received.
+*/
+boolean CC2530::SYS_RESET_IND(ResetInd &Ind)
+{
+  Ind = _ResetInd;
+  return _ResetInd.Reason != 0xFF;
+}
+
+/*
+  Wait for the SYS_RESET_IND sent by the E18-MS1 when it has started after a reset, for at most the reset timeout.  Frames queued before it belong to the E18-MS1 before the reset and are discarded.  Returns the reset reason, or 0xFF on timeout.
+*/
+uint8_t CC2530::_WAIT_RESET_IND()
+{
+  _ResetInd.Reason = 0xFF;
+  _ZdoState = 0x00;
+  unsigned long time_now = millis();
+  unsigned long Elapsed;
+  while ((Elapsed = millis() - time_now) < _ResetTimeout)
+  {
+    if (!WAIT_SRDY(_ResetTimeout - Elapsed))                          // SRDY stays high until the E18-MS1 has started
+    {
+      break;
+    }
+    _POLL();
+    while (READ_FRAME(ReceivedBytes))
+    {
+      if (ReceivedBytes[1] == 0x41 && ReceivedBytes[2] == 0x80 && ReceivedBytes[0] >= sizeof(_ResetInd)) // A short SYS_RESET_IND is skipped
+      {
+        memcpy(&_ResetInd, &ReceivedBytes[3], sizeof(_ResetInd));   // Reason, TransportRev, ProductId, MajorRel, MinorRel, HwRev
+        DEBUG_SERIAL.print(F("SYS_RESET_IND Reason 0x"));
+        DEBUG_SERIAL.print(_ResetInd.Reason, HEX);
+        DEBUG_SERIAL.print(F(" Version "));
+        DEBUG_SERIAL.print(_ResetInd.MajorRel);
+        DEBUG_SERIAL.print(F("."));
+        DEBUG_SERIAL.println(_ResetInd.MinorRel);
+        return _ResetInd.Reason;
+      }
+    }
+  }
+  DEBUG_SERIAL.println(F("SYS_RESET_IND TIMEOUT"));
+  return 0xFF;
+}
+
+/*
+  Write Data to the E18-MS1
+  Description: Write data to the E18-MS1 and wait for the synchronous response.  Returns the SreqResult of the request.
+*/
+uint8_t CC2530::WRITE_DATA(uint8_t *Data)
+{
+  DEBUG_SERIAL.println(F(""));
+  DEBUG_SERIAL.print(F("0x"));
+  DEBUG_SERIAL.println(Data[3],HEX);
+
+  return SREQ_WAIT(SREQ(Data));
+}
+
+/*
+  Write a Frame from flash to the E18-MS1
+  Description: As WRITE_DATA() for a frame kept in flash (PROGMEM).  DataLen bytes from Data in RAM are sent after the constant part of the frame, see SREQ_P().  Returns the SreqResult of the request.
+*/
+uint8_t CC2530::WRITE_DATA_P(const uint8_t *Frame, const uint8_t *Data, uint8_t DataLen)
+{
+  DEBUG_SERIAL.println(F(""));
+  DEBUG_SERIAL.print(F("0x"));
+  DEBUG_SERIAL.println(cmd_conv(pgm_read_byte(&Frame[1]), pgm_read_byte(&Frame[2])), HEX);
+
+  return SREQ_WAIT(SREQ_P(Frame, Data, DataLen));
+}
+
+/*
+  SREQ
+  Description: Starts a synchronous request without waiting for the synchronous response.  Asserts MRDY, waits (bounded by the SREQ timeout) for the E18-MS1 to assert SRDY, then sends the frame.  Returns a handle for SREQ_RESULT() and SREQ_WAIT(), or 0 if another request is still pending.
+  The SRSP is collected by TICK() once the E18-MS1 releases SRDY, so the application processor can do other work (or sleep) while the response is prepared.
+  An AREQ frame (Cmd0 type 0x40, e.g. SYS_RESET_REQ) completes as soon as the E18-MS1 has received it.
+*/
+uint8_t CC2530::SREQ(const uint8_t *Data)
+{
+  if (_SreqResult == SREQ_PENDING)
+  {
+    return 0;
+  }
+  if (!_SREQ_SELECT(Data[1], Data[2]))
+  {
+    uint8_t Handle = _SREQ_SENT(Data[1], Data[2]);
+    _SREQ_END(SREQ_TIMEOUT);
+    return Handle;
+  }
+
+  CC2530_TRACE_EVENT(TRACE_SREQ, Data[1], Data[2], Data[0], 0, _TraceSreq);
+  _WRITE(Data, Data[0]+3);
+  return _SREQ_SENT(Data[1], Data[2]);
+}
+
+/*
+  SREQ_P
+  Description: As SREQ() for a frame kept in flash (PROGMEM).  The Len byte of the frame counts the whole data field.  The constant part (Len + 3 - DataLen bytes) is streamed from flash, then the DataLen bytes from Data in RAM, so only the mutable fields of a frame need SRAM.
+*/
+uint8_t CC2530::SREQ_P(const uint8_t *Frame, const uint8_t *Data, uint8_t DataLen)
+{
+  if (_SreqResult == SREQ_PENDING)
+  {
+    return 0;
+  }
+  uint8_t Len = pgm_read_byte(&Frame[0]);
+  uint8_t Cmd0 = pgm_read_byte(&Frame[1]);
+  uint8_t Cmd1 = pgm_read_byte(&Frame[2]);
+  if (!_SREQ_SELECT(Cmd0, Cmd1))
+  {
+    uint8_t Handle = _SREQ_SENT(Cmd0, Cmd1);
+    _SREQ_END(SREQ_TIMEOUT);
+    return Handle;
+  }
+
+  CC2530_TRACE_EVENT(TRACE_SREQ, Cmd0, Cmd1, Len, 0, _TraceSreq);
+  _WRITE_P(Frame, Len + 3 - DataLen);
+  _WRITE(Data, DataLen);
+  return _SREQ_SENT(Cmd0, Cmd1);
+}
+
+/*
+  AF_DATA_REQUEST_SG
+  Description: Sends a message whose payload is gathered from Count segments (e.g. ZCL header, attribute records and strings in flash).  The payload length is summed once for the frame header and each segment is streamed straight to SPI, so the payload is never assembled in RAM.  Returns the payload length, or 0 if the request failed or the payload does not fit in a frame.
+*/
+uint8_t CC2530::AF_DATA_REQUEST_SG(uint8_t ShortAddr0, uint8_t ShortAddr1, const Segment *Segments, uint8_t Count)
+{
+  uint16_t Length = _SG_LENGTH(Segments, Count);
+  if (Length > 0xFF - 10 || !_AF_DATA_REQUEST_START(ShortAddr0, ShortAddr1, _Cfg.AFDataReq[0], _Cfg.AFDataReq[1], _Cfg.AFDataReq[2], _Cfg.AFDataReq[3], Length))
+  {
+    return 0;
+  }
+  _WRITE_SG(Segments, Count);
+
+  if (_AF_DATA_REQUEST_END(0x01) != SREQ_COMPLETE)
+  {
+    return 0;
+  }
+  return Length;
+}
+
+/*
+  Start an AF_DATA_REQUEST for a Length byte payload with the given endpoints and cluster, the next TransID and Options and Radius from SetAF_DATA_REQUEST().  Selects the E18-MS1 and sends the 13 byte header, the caller sends the payload and ends the request with _AF_DATA_REQUEST_END().
+*/
+boolean CC2530::_AF_DATA_REQUEST_START(uint8_t ShortAddr0, uint8_t ShortAddr1, uint8_t DesEP, uint8_t SourceEP, uint8_t ClusterID0, uint8_t ClusterID1, uint8_t Length)
+{
+  uint8_t Data[13] = {(uint8_t) (Length + 10), 0x24, 0x01, ShortAddr1, ShortAddr0};
+  memcpy(&Data[5], _Cfg.AFDataReq, sizeof(_Cfg.AFDataReq)); // DesEP, SourceEP, ClusterID, TransID, Options, Radius
+  Data[5] = DesEP;
+  Data[6] = SourceEP;
+  Data[7] = ClusterID0;
+  Data[8] = ClusterID1;
+  Data[9] = ++_AfTransID;
+  Data[12] = Length;
+  DEBUG_SERIAL.println(F("AF_DATA_REQUEST SREQ"));
+  // SREQ
+  if (!_SREQ_SELECT(Data[1], Data[2]))
+  {
+    return 0;
+  }
+  CC2530_TRACE_EVENT(TRACE_SREQ, Data[1], Data[2], Data[0], 0, _TraceSreq);
+  _WRITE(Data, sizeof(Data));
+  return 1;
+}
+
+/*
+  Set ZCL_ATTRIBUTES
+  Description: Sets the application's ZCL attribute table (in flash, see ZclAttribute).  At most CC2530_ZCL_ATTRIBUTES entries are used.  Clears every changed and read flag and every reporting configuration.
+*/
+void CC2530::SetZCL_ATTRIBUTES(const ZclAttribute *Table, uint8_t Count)
+{
+  _ZclTable = Table;
+  _ZclCount = Count < CC2530_ZCL_ATTRIBUTES ? Count : CC2530_ZCL_ATTRIBUTES;
+  memset(_ZclDirty, 0, sizeof(_ZclDirty));
+  memset(_ZclRead, 0, sizeof(_ZclRead));
+  for (uint8_t i = 0; i < CC2530_ZCL_REPORTING; i++)
+  {
+    _ZclReporting[i].Index = 0xFF;
+  }
+}
+
+/*
+  ZCL_CHANGED
+  Description: Marks a reportable attribute as changed so the next ZCL_REPORT() sends it.  Call after updating the attribute's value.  Returns false if the attribute is not in the table or not ZCL_REPORTABLE.
+*/
+boolean CC2530::ZCL_CHANGED(uint16_t ClusterID, uint16_t AttrID)
+{
+  ZclAttribute Attr;
+  uint8_t i = _ZCL_FIND(ClusterID, AttrID, Attr);
+  if (i == 0xFF || !(Attr.Flags & ZCL_REPORTABLE))
+  {
+    return 0;
+  }
+  _ZclDirty[i >> 3] |= 1 << (i & 7);
+  return 1;
+}
+
+/*
+  ZCL_REPORT
+  Description: Sends a ZCL Report Attributes command to ShortAddr (default the coordinator) for every cluster with changed attributes.  All changed attributes of a cluster are packed into one AF_DATA_REQUEST (split only past CC2530_ZCL_PAYLOAD bytes), each frame with the next ZCL sequence number.  The endpoints, options and radius are the SetAF_DATA_REQUEST() values, the cluster comes from the table.
+  Returns the number of frames sent.  Attributes are only marked as reported once their frame is accepted by the E18-MS1, so a failed report is sent again by the next call.  An attribute whose record alone exceeds CC2530_ZCL_PAYLOAD is never sent and its change is cleared.
+*/
+uint8_t CC2530::ZCL_REPORT(uint16_t ShortAddr)
+{
+  uint8_t Frames = 0;
+  ZclAttribute First, Attr;
+  for (uint8_t i = 0; _ZCL_ENTRY(i, First); i++)
+  {
+    if (!(_ZclDirty[i >> 3] & (1 << (i & 7))))
+    {
+      continue;
+    }
+
+    // Changed attributes of this cluster from entry i up to Last that fit in one frame
+    uint16_t Length = 3;
+    uint8_t Last = i;
+    for (uint8_t j = i; _ZCL_ENTRY(j, Attr); j++)
+    {
+      if (Attr.ClusterID != First.ClusterID || !(_ZclDirty[j >> 3] & (1 << (j & 7))))
+      {
+        continue;
+      }
+      uint16_t Record = 3 + (Attr.DataType == 0x42) + Attr.Size;
+      if (3 + Record > CC2530_ZCL_PAYLOAD)                            // Never fits, not reported
+      {
+        _ZclDirty[j >> 3] &= ~(1 << (j & 7));
+        DEBUG_SERIAL.println(F("ZCL attribute too large to report"));
+        continue;
+      }
+      if (Length + Record > CC2530_ZCL_PAYLOAD)
+      {
+        break;
+      }
+      Length += Record;
+      Last = j;
+    }
+    if (Length == 3)
+    {
+      continue;
+    }
+
+    if (!_AF_DATA_REQUEST_START(highByte(ShortAddr), lowByte(ShortAddr), _Cfg.AFDataReq[0], _Cfg.AFDataReq[1], lowByte(First.ClusterID), highByte(First.ClusterID), Length))
+    {
+      return Frames;
+    }
+    uint8_t ZCLHeader[3] = {0x18, _ZclSeq, 0x0A}; // Server to client, disable default response.  Report Attributes
+    _WRITE(ZCLHeader, sizeof(ZCLHeader));
+    for (uint8_t j = i; j <= Last; j++)
+    {
+      _ZCL_ENTRY(j, Attr);
+      if (Attr.ClusterID == First.ClusterID && (_ZclDirty[j >> 3] & (1 << (j & 7))))
+      {
+        _ZCL_WRITE_RECORD(Attr);
+      }
+    }
+    if (_AF_DATA_REQUEST_END(0x01) != SREQ_COMPLETE)
+    {
+      return Frames;
+    }
+
+    _ZclSeq++;
+    Frames++;
+    for (uint8_t j = i; j <= Last; j++)
+    {
+      _ZCL_ENTRY(j, Attr);
+      if (Attr.ClusterID == First.ClusterID && (_ZclDirty[j >> 3] & (1 << (j & 7))))
+      {
+        ZclReporting *Rep = _ZCL_REPORTING(j);
+        if (Rep != 0)
+        {
+          Rep->Last = _ZCL_VALUE(Attr);                               // Reference for the reportable change
+          Rep->Since = _ZclNow;
+        }
+        _ZclDirty[j >> 3] &= ~(1 << (j & 7));
+      }
+    }
+  }
+  return Frames;
+}
+
+/*
+  ZCL_READ_ATTRIBUTES
+  Description: Answers the ZCL Read Attributes command in ReceivedBytes (after AF_INCOMING_MSG() returned true) from the attribute table.  Every attribute ID in the command is looked up and all records, UNSUPPORTED_ATTRIBUTE (0x86) for IDs not in the table, are sent back to the requesting device and endpoint in one Read Attributes Response (up to CC2530_ZCL_PAYLOAD bytes).  Options and Radius are the SetAF_DATA_REQUEST() values.
+  Returns true if the frame was a Read Attributes command for a cluster in the table and the response was sent, false to leave the frame to the sketch.
+*/
+boolean CC2530::ZCL_READ_ATTRIBUTES()
+{
+  if (ReceivedBytes[1] != 0x44 || ReceivedBytes[2] != 0x81)
+  {
+    return 0;
+  }
+  const uint8_t *Zcl = &ReceivedBytes[20];
+  uint8_t Len = ReceivedBytes[19] < NumBytes - 20 ? ReceivedBytes[19] : NumBytes - 20;
+  uint8_t Header = (Zcl[0] & 0x04) ? 5 : 3; // A manufacturer specific frame carries the manufacturer code
+  if (Len < Header || (Zcl[0] & 0x0B) != 0x00 || Zcl[Header - 1] != 0x00) // Global command, client to server, Read Attributes
+  {
+    return 0;
+  }
+  uint16_t ClusterID = ReceivedBytes[5] | ReceivedBytes[6] << 8;
+  ZclAttribute Attr;
+  uint8_t i = 0;
+  while (_ZCL_ENTRY(i, Attr) && Attr.ClusterID != ClusterID)
+  {
+    i++;
+  }
+  if (i == _ZclCount)
+  {
+    return 0;
+  }
+
+  // Attribute IDs from Header to End are answered
+  uint16_t Length = Header;
+  uint8_t End = Header;
+  for (; End + 1 < Len; End += 2)
+  {
+    uint16_t Record = _ZCL_FIND(ClusterID, Zcl[End] | Zcl[End + 1] << 8, Attr) == 0xFF ? 3 : 4 + (Attr.DataType == 0x42) + Attr.Size;
+    if (Length + Record > CC2530_ZCL_PAYLOAD)
+    {
+      break;
+    }
+    Length += Record;
+  }
+
+  // The request is read out of ReceivedBytes before SREQ_WAIT() receives the SRSP into it
+  if (!_AF_DATA_REQUEST_START(ReceivedBytes[8], ReceivedBytes[7], ReceivedBytes[9], ReceivedBytes[10], ReceivedBytes[5], ReceivedBytes[6], Length))
+  {
+    return 0;
+  }
+  uint8_t ZCLHeader[5];
+  memcpy(ZCLHeader, Zcl, Header);                                     // [Manufacturer code], sequence number
+  ZCLHeader[0] = 0x18 | (Zcl[0] & 0x04);                              // Server to client, disable default response
+  ZCLHeader[Header - 1] = 0x01;                                       // Read Attributes Response
+  _WRITE(ZCLHeader, Header);
+  for (uint8_t n = Header; n < End; n += 2)
+  {
+    uint8_t Index = _ZCL_FIND(ClusterID, Zcl[n] | Zcl[n + 1] << 8, Attr);
+    uint8_t Record[5] = {Zcl[n], Zcl[n + 1], 0x86, Attr.DataType, Attr.Size}; // AttrID, Status, DataType, string length
+    if (Index == 0xFF)
+    {
+      _WRITE(Record, 3);
+      continue;
+    }
+    Record[2] = 0x00;
+    _WRITE(Record, Attr.DataType == 0x42 ? 5 : 4);
+    if (Attr.Flags & ZCL_FLASH)
+    {
+      _WRITE_P((const uint8_t*) Attr.Value, Attr.Size);
+    }
+    else
+    {
+      _WRITE((const uint8_t*) Attr.Value, Attr.Size);
+    }
+    _ZclRead[Index >> 3] |= 1 << (Index & 7);
+  }
+  return _AF_DATA_REQUEST_END(0x01) == SREQ_COMPLETE;
+}
+
+/*
+  ZCL_INTERVIEWED
+  Description: Returns true once every attribute of ClusterID in the table has been answered by ZCL_READ_ATTRIBUTES(), e.g. the Basic cluster attributes the coordinator reads while interviewing the device, so the sketch can stop waiting for the interview early.
+*/
+boolean CC2530::ZCL_INTERVIEWED(uint16_t ClusterID)
+{
+  ZclAttribute Attr;
+  boolean Found = 0;
+  for (uint8_t i = 0; _ZCL_ENTRY(i, Attr); i++)
+  {
+    if (Attr.ClusterID != ClusterID)
+    {
+      continue;
+    }
+    if (!(_ZclRead[i >> 3] & (1 << (i & 7))))
+    {
+      return 0;
+    }
+    Found = 1;
+  }
+  return Found;
+}
+
+/*
+  Set ZCL_REPORTING
+  Description: Sets the reporting configuration of a reportable attribute in the table, as a Configure Reporting command from the coordinator would.  MinInterval and MaxInterval are in seconds of the clock passed to ZCL_DUE(), MaxInterval 0 reports on change only and 0xFFFF stops reporting the attribute.  Change is the reportable change, for a single precision float (0x39) the bits of a float, 0 reports any change.
+  Call after SetZCL_ATTRIBUTES().  Ignored for attributes not in the table, not ZCL_REPORTABLE or kept in flash, of a type without a reportable change this library compares (semi or double precision, integers wider than 32 bits), or when CC2530_ZCL_REPORTING attributes are already configured.
+*/
+void CC2530::SetZCL_REPORTING(uint16_t ClusterID, uint16_t AttrID, uint16_t MinInterval, uint16_t MaxInterval, uint32_t Change)
+{
+  ZclAttribute Attr;
+  uint8_t i = _ZCL_FIND(ClusterID, AttrID, Attr);
+  if (i != 0xFF)
+  {
+    _ZCL_CONFIGURE(i, Attr, MinInterval, MaxInterval, Change);
+  }
+}
+
+/*
+  ZCL_CONFIGURE_REPORTING
+  Description: Applies the ZCL Configure Reporting command in ReceivedBytes (after AF_INCOMING_MSG() returned true) to the attribute table and sends the Configure Reporting Response to the requesting device and endpoint.  Each configured attribute is marked as changed so its current value is reported.  Records that fail are answered with their status: UNSUPPORTED_ATTRIBUTE (0x86), UNREPORTABLE_ATTRIBUTE (0x8C), INVALID_DATA_TYPE (0x8D) or INSUFFICIENT_SPACE (0x89).
+  Returns true if the frame was a Configure Reporting command and the response was sent, false to leave the frame to the sketch.
+*/
+boolean CC2530::ZCL_CONFIGURE_REPORTING()
+{
+  if (ReceivedBytes[1] != 0x44 || ReceivedBytes[2] != 0x81)
+  {
+    return 0;
+  }
+  const uint8_t *Zcl = &ReceivedBytes[20];
+  uint8_t Len = ReceivedBytes[19] < NumBytes - 20 ? ReceivedBytes[19] : NumBytes - 20;
+  uint8_t Header = (Zcl[0] & 0x04) ? 5 : 3;
+  if (Len < Header || (Zcl[0] & 0x0B) != 0x00 || Zcl[Header - 1] != 0x06) // Global command, client to server, Configure Reporting
+  {
+    return 0;
+  }
+  uint16_t ClusterID = ReceivedBytes[5] | ReceivedBytes[6] << 8;
+  ZclAttribute Attr;
+
+  // Configure each record: Direction, AttrID, then DataType, MinInterval, MaxInterval and Change (analog types only), or the Timeout of reports received
+  uint8_t Response[5 + 4 * 8];                                        // Header and a status record for each record of the largest command
+  memcpy(Response, Zcl, Header);
+  Response[0] = 0x18 | (Zcl[0] & 0x04);                               // Server to client, disable default response
+  Response[Header - 1] = 0x07;                                        // Configure Reporting Response
+  uint8_t Length = Header;
+  for (uint8_t n = Header; n + 5 <= Len;)
+  {
+    uint8_t Status = 0x86;                                            // This device does not receive reports
+    uint8_t Next = n + 5;
+    if (Zcl[n] == 0x00)
+    {
+      uint8_t ChangeSize = _ZCL_ANALOG_SIZE(Zcl[n + 3]);
+      Next = n + 8 + ChangeSize;
+      if (Next > Len)
+      {
+        break;
+      }
+      uint32_t Change = 0;
+      for (uint8_t k = ChangeSize < 4 ? ChangeSize : 4; k > 0; k--)
+      {
+        Change = Change << 8 | Zcl[n + 7 + k];
+      }
+      uint8_t Index = _ZCL_FIND(ClusterID, Zcl[n + 1] | Zcl[n + 2] << 8, Attr);
+      if (Index != 0xFF)
+      {
+        Status = Attr.DataType != Zcl[n + 3] ? 0x8D : _ZCL_CONFIGURE(Index, Attr, Zcl[n + 4] | Zcl[n + 5] << 8, Zcl[n + 6] | Zcl[n + 7] << 8, Change);
+      }
+    }
+    if (Status != 0x00 && Length <= sizeof(Response) - 4)
+    {
+      Response[Length++] = Status;
+      Response[Length++] = Zcl[n];                                    // Direction, AttrID
+      Response[Length++] = Zcl[n + 1];
+      Response[Length++] = Zcl[n + 2];
+    }
+    n = Next;
+  }
+  if (Length == Header)
+  {
+    Response[Length++] = 0x00;                                        // Every record configured
+  }
+
+  if (!_AF_DATA_REQUEST_START(ReceivedBytes[8], ReceivedBytes[7], ReceivedBytes[9], ReceivedBytes[10], ReceivedBytes[5], ReceivedBytes[6], Length))
+  {
+    return 0;
+  }
+  _WRITE(Response, Length);
+  return _AF_DATA_REQUEST_END(0x01) == SREQ_COMPLETE;
+}
+
+/*
+  ZCL_DUE
+  Description: Marks the reportable attributes that are due to be reported at time Now (seconds, e.g. the time slept, see ZCL Reporting Configuration) as changed, and returns how many changed attributes the next ZCL_REPORT() will send.  When it returns 0 the sketch can go back to sleep without using the radio.
+*/
+uint8_t CC2530::ZCL_DUE(uint32_t Now)
+{
+  _ZclNow = Now;
+  uint8_t Due = 0;
+  ZclAttribute Attr;
+  for (uint8_t i = 0; _ZCL_ENTRY(i, Attr); i++)
+  {
+    if (!(Attr.Flags & ZCL_REPORTABLE))
+    {
+      continue;
+    }
+    ZclReporting *Rep = _ZCL_REPORTING(i);
+    if (Rep == 0)
+    {
+      _ZclDirty[i >> 3] |= 1 << (i & 7);
+    }
+    else if (Rep->MaxInterval != 0xFFFF)
+    {
+      uint32_t Elapsed = Now - Rep->Since;
+      if ((Rep->MaxInterval != 0 && Elapsed >= Rep->MaxInterval) || (_ZCL_CHANGED_BY(Attr.DataType, _ZCL_VALUE(Attr), Rep->Last, Rep->Change) && Elapsed >= Rep->MinInterval))
+      {
+        _ZclDirty[i >> 3] |= 1 << (i & 7);
+      }
+    }
+    if (_ZclDirty[i >> 3] & (1 << (i & 7)))
+    {
+      Due++;
+    }
+  }
+  return Due;
+}
+
+/*
+  Set the reporting configuration of attribute Index.  Returns the ZCL status.
+*/
+uint8_t CC2530::_ZCL_CONFIGURE(uint8_t Index, const ZclAttribute &Attr, uint16_t MinInterval, uint16_t MaxInterval, uint32_t Change)
+{
+  if (!(Attr.Flags & ZCL_REPORTABLE) || (Attr.Flags & ZCL_FLASH))
+  {
+    return 0x8C;
+  }
+  if (Attr.DataType == 0x38 || _ZCL_ANALOG_SIZE(Attr.DataType) > 4)   // Semi and double precision, integers wider than 32 bits: no reportable change
+  {
+    return 0x8D;
+  }
+  ZclReporting *Rep = _ZCL_REPORTING(Index);
+  if (Rep == 0 && (Rep = _ZCL_REPORTING(0xFF)) == 0)
+  {
+    return 0x89;
+  }
+  Rep->Index = Index;
+  Rep->MinInterval = MinInterval;
+  Rep->MaxInterval = MaxInterval;
+  Rep->Change = Change;
+  Rep->Last = _ZCL_VALUE(Attr);
+  Rep->Since = _ZclNow;
+  if (MaxInterval != 0xFFFF)
+  {
+    _ZclDirty[Index >> 3] |= 1 << (Index & 7);
+  }
+  return 0x00;
+}
+
+/*
+  Reporting configuration of attribute Index, or the first free entry for 0xFF.  Returns 0 if there is none.
+*/
+CC2530::ZclReporting *CC2530::_ZCL_REPORTING(uint8_t Index)
+{
+  for (uint8_t i = 0; i < CC2530_ZCL_REPORTING; i++)
+  {
+    if (_ZclReporting[i].Index == Index)
+    {
+      return &_ZclReporting[i];
+    }
+  }
+  return 0;
+}
+
+/*
+  The first 4 bytes of an attribute value in RAM, sign extended for the signed integer types
+*/
+uint32_t CC2530::_ZCL_VALUE(const ZclAttribute &Attr)
+{
+  uint32_t Value = 0;
+  uint8_t Size = Attr.Size < 4 ? Attr.Size : 4;
+  for (uint8_t k = Size; k > 0; k--)
+  {
+    Value = Value << 8 | ((const uint8_t*) Attr.Value)[k - 1];
+  }
+  if (Attr.DataType >= 0x28 && Attr.DataType <= 0x2A && Size < 4 && (Value & (1UL << (Size * 8 - 1))))
+  {
+    Value |= 0xFFFFFFFFUL << (Size * 8);
+  }
+  return Value;
+}
+
+/*
+  Whether Value has changed from Last (both from _ZCL_VALUE()) by at least Change and by more than nothing, compared as the DataType they hold: an unsigned or signed integer up to 32 bits, a single precision float (Change too), or any change of a discrete type
+*/
+boolean CC2530::_ZCL_CHANGED_BY(uint8_t DataType, uint32_t Value, uint32_t Last, uint32_t Change)
+{
+  if (Value == Last)
+  {
+    return 0;
+  }
+  uint8_t Size = _ZCL_ANALOG_SIZE(DataType);
+  if (Size == 0 || Size > 4 || DataType == 0x38)                     // Discrete: any change.  _ZCL_CONFIGURE() refuses the analog types in here
+  {
+    return 1;
+  }
+  if (DataType == 0x39)
+  {
+    float V, L, C;
+    memcpy(&V, &Value, 4);
+    memcpy(&L, &Last, 4);
+    memcpy(&C, &Change, 4);
+    return V != L && (V > L ? V - L : L - V) >= C;                      // False for NaN
+  }
+  uint32_t Delta;
+  if (DataType >= 0x28 && DataType <= 0x2B)                          // Signed
+  {
+    Delta = (int32_t) Value > (int32_t) Last ? Value - Last : Last - Value;
+  }
+  else                                                                // Unsigned and times
+  {
+    Delta = Value > Last ? Value - Last : Last - Value;
+  }
+  return Delta >= Change;
+}
+
+/*
+  Size of the reportable change field of a Configure Reporting record: the size of an analog data type, 0 for a discrete one
+*/
+uint8_t CC2530::_ZCL_ANALOG_SIZE(uint8_t DataType)
+{
+  if (DataType >= 0x20 && DataType <= 0x2F)                          // Unsigned and signed integers
+  {
+    return (DataType & 0x07) + 1;
+  }
+  if (DataType >= 0x38 && DataType <= 0x3A)                          // Semi, single and double precision
+  {
+    return 2 << (DataType - 0x38);
+  }
+  if (DataType >= 0xE0 && DataType <= 0xE2)                          // Time of day, date, UTC time
+  {
+    return 4;
+  }
+  return 0;
+}
+
+/*
+  Copy attribute Index of the table out of flash.  Returns false past the end of the table.
+*/
+boolean CC2530::_ZCL_ENTRY(uint8_t Index, ZclAttribute &Attr)
+{
+  if (Index >= _ZclCount)
+  {
+    return 0;
+  }
+  memcpy_P(&Attr, &_ZclTable[Index], sizeof(ZclAttribute));
+  return 1;
+}
+
+/*
+  Find an attribute in the table.  Returns its index, or 0xFF if it is not in the table.
+*/
+uint8_t CC2530::_ZCL_FIND(uint16_t ClusterID, uint16_t AttrID, ZclAttribute &Attr)
+{
+  for (uint8_t i = 0; _ZCL_ENTRY(i, Attr); i++)
+  {
+    if (Attr.ClusterID == ClusterID && Attr.AttrID == AttrID)
+    {
+      return i;
+    }
+  }
+  return 0xFF;
+}
+
+/*
+  Send an attribute record: AttrID, DataType, then the value (a character string with its length byte)
+*/
+void CC2530::_ZCL_WRITE_RECORD(const ZclAttribute &Attr)
+{
+  uint8_t Record[4] = {lowByte(Attr.AttrID), highByte(Attr.AttrID), Attr.DataType, Attr.Size};
+  _WRITE(Record, Attr.DataType == 0x42 ? 4 : 3);
+  if (Attr.Flags & ZCL_FLASH)
+  {
+    _WRITE_P((const uint8_t*) Attr.Value, Attr.Size);
+  }
+  else
+  {
+    _WRITE((const uint8_t*) Attr.Value, Attr.Size);
+  }
+}
+
+/*
+  AF_DATA_REQUEST_EXT_SG
+  Description: As AF_DATA_REQUEST_SG() for AF_DATA_REQUEST_EXT, see AF_DATA_REQUEST_EXT()
+*/
+uint8_t CC2530::AF_DATA_REQUEST_EXT_SG(uint8_t AddrMode, const uint8_t IEEEAddr[8], const Segment *Segments, uint8_t Count)
+{
+  uint16_t Length = _SG_LENGTH(Segments, Count);
+  if (Length > 0xFF - 20)
+  {
+    return 0;
+  }
+  uint8_t Data[23] = {(uint8_t) (Length + 20), 0x24, 0x02, AddrMode}; // Use destination mode 0x00 to lookup the address in the binding table
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    Data[4 + i] = IEEEAddr[7 - i];
+  }
+  memcpy(&Data[12], _Cfg.AFDataReqExt, sizeof(_Cfg.AFDataReqExt)); // DesEP, DstPanId, SourceEP, ClusterID, TransID, Options, Radius
+  Data[18] = ++_AfTransID;
+  Data[21] = Length;
+  Data[22] = 0x00;
+  DEBUG_SERIAL.println(F("AF_DATA_REQUEST_EXT SREQ"));
+  // SREQ
+  if (!_SREQ_SELECT(Data[1], Data[2]))
+  {
+    return 0;
+  }
+  CC2530_TRACE_EVENT(TRACE_SREQ, Data[1], Data[2], Data[0], 0, _TraceSreq);
+  _WRITE(Data, sizeof(Data));
+  _WRITE_SG(Segments, Count);
+
+  if (_AF_DATA_REQUEST_END(0x02) != SREQ_COMPLETE)
+  {
+    return 0;
+  }
+  return Length;
+}
+
+/*
+  End an AF_DATA_REQUEST (Cmd1 0x01) or AF_DATA_REQUEST_EXT (0x02) whose payload has been sent.  Waits for the SRSP and tracks the TransID until its AF_DATA_CONFIRM.  Returns the SreqResult.
+*/
+uint8_t CC2530::_AF_DATA_REQUEST_END(uint8_t Cmd1)
+{
+  uint8_t Result = SREQ_WAIT(_SREQ_SENT(0x24, Cmd1));
+  if (Result != SREQ_COMPLETE || SREQ_STATUS() != 0x00)              // Not accepted, no AF_DATA_CONFIRM will follow.  Nothing was sent, so the TX power is left alone
+  {
+    if (_AfResult < AF_FAILED)
+    {
+      _AfResult = AF_FAILED;
+    }
+    return Result;
+  }
+  if (_AfInFlight == CC2530_AF_PENDING)                               // Give up on the oldest
+  {
+    memmove(_AfPending, _AfPending + 1, CC2530_AF_PENDING - 1);
+    _AfInFlight--;
+    _AfResult = AF_TIMEOUT;
+    _TxFailed = true;                                                 // Unconfirmed, as if AF_DATA_CONFIRM_WAIT() had timed out
+    _TxGood = 0;
+  }
+  _AfPending[_AfInFlight++] = _AfTransID;
+  return Result;
+}
+
+/*
+  Match an AF_DATA_CONFIRM to its request.  Confirms for requests no longer tracked are ignored.
+*/
+void CC2530::_AF_CONFIRM(uint8_t Status, uint8_t TransID)
+{
+  for (uint8_t i = 0; i < _AfInFlight; i++)
+  {
+    if (_AfPending[i] == TransID)
+    {
+      memmove(&_AfPending[i], &_AfPending[i + 1], _AfInFlight - i - 1);
+      _AfInFlight--;
+      if (Status != 0x00 && _AfResult < AF_FAILED)
+      {
+        _AfResult = AF_FAILED;
+      }
+      if (Status != 0x00)
+      {
+        _TxFailed = true;
+        _TxGood = 0;
+      }
+      else if (_TxGood < 0xFF)
+      {
+        _TxGood++;
+      }
+      return;
+    }
+  }
+}
+
+/*
+  AF_TRANS_ID
+  Description: Returns the TransID of the last AF_DATA_REQUEST or AF_DATA_REQUEST_EXT.  The library numbers every request, so each AF_DATA_CONFIRM (0x4480: Status, Endpoint, TransID) can be matched to its request.
+*/
+uint8_t CC2530::AF_TRANS_ID()
+{
+  return _AfTransID;
+}
+
+/*
+  AF_IN_FLIGHT
+  Description: Returns the number of accepted requests still waiting for their AF_DATA_CONFIRM.  Confirms are matched by POLL() as they are received.
+*/
+uint8_t CC2530::AF_IN_FLIGHT()
+{
+  return _AfInFlight;
+}
+
+/*
+  AF_DATA_CONFIRM_WAIT
+  Description: Polls until every request sent since the last call has its AF_DATA_CONFIRM, or Timeout milliseconds have passed, and returns as soon as the last confirm arrives.  With SetSRDY_INTERRUPT() the application processor sleeps in between.
+  Returns AF_CONFIRMED, AF_FAILED if a request was rejected or confirmed with an error, or AF_TIMEOUT if a confirm did not arrive.  Requests still unconfirmed are no longer tracked.
+*/
+uint8_t CC2530::AF_DATA_CONFIRM_WAIT(unsigned long Timeout)
+{
+  unsigned long time_now = millis();
+  unsigned long Elapsed;
+  while (_AfInFlight > 0 && (Elapsed = millis() - time_now) < Timeout)
+  {
+    WAIT_SRDY(Timeout - Elapsed);
+    _POLL();                                                          // Other frames wait in the receive ring for the next POLL()
+  }
+  if (_AfInFlight > 0)
+  {
+    _AfInFlight = 0;
+    _AfResult = AF_TIMEOUT;
+    _TxFailed = true;
+    _TxGood = 0;
+  }
+  uint8_t Result = _AfResult;
+  _AfResult = AF_CONFIRMED;
+  _TX_POWER_ADAPT();                                                  // SYS_SET_TX_POWER is an SREQ, so not sent from POLL()
+  return Result;
+}
+
+/*
+  AF_DATA_CONFIRM_CLEAR
+  Description: Clears the result the next AF_DATA_CONFIRM_WAIT() returns back to AF_CONFIRMED, e.g. after a request that was rejected.  Requests waiting for their AF_DATA_CONFIRM stay tracked.
+*/
+void CC2530::AF_DATA_CONFIRM_CLEAR()
+{
+  _AfResult = AF_CONFIRMED;
+}
+
+/*
+  TX_POWER_BEGIN
+  Description: Starts adapting the transmit power between Min and Max dBm (-22 to 4 on the E18-MS1) from the confirms seen by AF_DATA_CONFIRM_WAIT(), and sends the level kept at Addr in EEPROM by the last run with SYS_SET_TX_POWER.  Without a stored level in range, or on processors without avr/eeprom.h, it starts at Max.
+  Lqi is the link margin (0 to 255) that must remain after a step down, judged from the LinkQuality of the frames received.  A device that receives none (e.g. a sleeping end device with polling off) steps down on its confirms alone.  Returns the level sent.
+*/
+int8_t CC2530::TX_POWER_BEGIN(uint16_t Addr, int8_t Min, int8_t Max, uint8_t Lqi)
+{
+  _TxAdapt = true;
+  _TxMin = Min;
+  _TxMax = Max;
+  _TxLqi = Lqi;
+  _TxAddr = Addr;
+  _TxGood = 0;
+  _TxHold = CC2530_TX_POWER_HOLD;
+  _TxFailed = false;
+  int8_t Level = Max;
+#if defined(ARDUINO_ARCH_AVR)
+  uint8_t Stored[2];
+  eeprom_read_block(Stored, (const void*) (uintptr_t) Addr, 2);
+  if (Stored[1] == (uint8_t) ~Stored[0] && (int8_t) Stored[0] >= Min && (int8_t) Stored[0] <= Max)
+  {
+    Level = (int8_t) Stored[0];
+  }
+#endif
+  _TxStored = Level;
+  _Cfg.TxPower = (uint8_t) Level;
+  WRITE_DATA_P(TxPowerFrame, &_Cfg.TxPower, 1);                       // SYS_SET_TX_POWER
+  return Level;
+}
+
+/*
+  TX_POWER
+  Description: Returns the transmit power in dBm last sent with SYS_SET_TX_POWER by the library
+*/
+int8_t CC2530::TX_POWER()
+{
+  return (int8_t) _Cfg.TxPower;
+}
+
+/*
+  TX_POWER_LQI
+  Description: Returns the average LinkQuality of the AF_INCOMING_MSGs received since TX_POWER_BEGIN(), 0 before the first
+*/
+uint8_t CC2530::TX_POWER_LQI()
+{
+  return _TxLqiAvg >> 3;
+}
+
+/*
+  Step the transmit power up after a failed or missing confirm, or down after _TxHold confirms in a row while the link margin at the lower level stays at least _TxLqi.  The CC2530 LinkQuality rises by about 3 per dB of received power.  Without a LinkQuality average the confirms alone decide, and each failure doubles _TxHold so a marginal link is probed less and less often.
+  A level is settled once it has been kept for CC2530_TX_POWER_SETTLE confirms in a row.  It is then written to EEPROM, so the steps on the way and the probes below it wear nothing, and every settle halves _TxHold back towards CC2530_TX_POWER_HOLD, so a burst of failures does not slow the step down for the rest of the run.
+*/
+void CC2530::_TX_POWER_ADAPT()
+{
+  if (!_TxAdapt)
+  {
+    return;
+  }
+  int Level = (int8_t) _Cfg.TxPower;
+  if (_TxFailed)
+  {
+    Level += CC2530_TX_POWER_UP;
+    if (_TxHold < 128)
+    {
+      _TxHold *= 2;
+    }
+  }
+  else
+  {
+    if (_TxGood >= CC2530_TX_POWER_SETTLE)                            // Settled: keep the level and relax the hold
+    {
+      if (Level != _TxStored)
+      {
+        _TX_POWER_STORE(Level);
+      }
+      if (_TxHold > CC2530_TX_POWER_HOLD)
+      {
+        _TxHold /= 2;
+        _TxGood = 0;
+      }
+    }
+    if (_TxGood >= _TxHold && (_TxLqiAvg == 0 || (int) (_TxLqiAvg >> 3) - (_TxMax - (Level - 1)) * 3 >= _TxLqi))
+    {
+      Level--;
+    }
+  }
+  _TxFailed = false;
+  if (Level > _TxMax)
+  {
+    Level = _TxMax;
+  }
+  if (Level < _TxMin)
+  {
+    Level = _TxMin;
+  }
+  if (Level != (int8_t) _Cfg.TxPower)
+  {
+    _TxGood = 0;
+    _Cfg.TxPower = (uint8_t) Level;
+    WRITE_DATA_P(TxPowerFrame, &_Cfg.TxPower, 1);                     // SYS_SET_TX_POWER
+  }
+}
+
+/*
+  Keep Level in EEPROM with its complement
+*/
+void CC2530::_TX_POWER_STORE(int8_t Level)
+{
+  _TxStored = Level;
+#if defined(ARDUINO_ARCH_AVR)
+  uint8_t Stored[2] = {(uint8_t) Level, (uint8_t) ~Level};
+  eeprom_update_block(Stored, (void*) (uintptr_t) _TxAddr, 2);
+#endif
+}
+
+/*
+  LOG_BEGIN
+  Description: Uses Size bytes of EEPROM from address Start for the store and forward log (LogRecord slots) and finds the queue left by the last run.  The newest record is the one whose next slot does not hold the following sequence number, and the queued records are the consecutive LOG_QUEUED records that end at it.
+  Returns the number of queued records.  The log is not available (0 slots) on processors without avr/eeprom.h.
+*/
+uint16_t CC2530::LOG_BEGIN(uint16_t Start, uint16_t Size)
+{
+  _LogStart = Start;
+  _LogHead = 0;
+  _LogCount = 0;
+  _LogSeq = 0;
+#if defined(ARDUINO_ARCH_AVR)
+  _LogSlots = Size / sizeof(LogRecord);
+#else
+  _LogSlots = 0;
+#endif
+  LogRecord Rec, Next;
+  for (uint16_t Slot = 0; Slot < _LogSlots; Slot++)
+  {
+    _LOG_READ(Slot, 0, &Rec, offsetof(LogRecord, Time));
+    if (Rec.Status == LOG_ERASED)
+    {
+      continue;
+    }
+    uint16_t After = Slot + 1 < _LogSlots ? Slot + 1 : 0;
+    _LOG_READ(After, 0, &Next, offsetof(LogRecord, Time));
+    if (Next.Status == LOG_ERASED || Next.Seq != (uint16_t) (Rec.Seq + 1))
+    {
+      _LogHead = After;                                               // Slot holds the newest record
+      _LogSeq = Rec.Seq + 1;
+      break;
+    }
+  }
+
+  uint16_t Slot = _LOG_PREV(_LogHead);
+  uint16_t Seq = _LogSeq - 1;
+  while (_LogCount < _LogSlots)
+  {
+    _LOG_READ(Slot, 0, &Rec, offsetof(LogRecord, Time));
+    if (Rec.Status != LOG_QUEUED || Rec.Seq != Seq)
+    {
+      break;
+    }
+    _LogCount++;
+    Slot = _LOG_PREV(Slot);
+    Seq--;
+  }
+  return _LogCount;
 }
 
 /*
-  Set parameters for AF_DATA_REQUEST_EXT
-  Description: Set the parameters for sending a AF_DATA_REQUEST_EXT
-  Valid Values: Refer to Z-Stack ZNP Interface Specification
-  Default Values:
-  DesEP       0x01
-  PanID0      0xA1
-  PanID1      0x00
-  SourceEP    0x01
-  ClusterID0  0xB0
-  ClusterID1  0xFE
-  TransID     0x01
-  Options     0x00
-  Radius      0x04
+  LOG_APPEND
+  Description: Queues a reading of CC2530_LOG_DATA bytes at Data with its timestamp, e.g. after AF_DATA_CONFIRM_WAIT() failed.  When the log is full the oldest queued record is overwritten.  Only the bytes that differ are written (3.4 ms each on the Atmega328P).
+  Returns false if LOG_BEGIN() has not been called.
 */
-void CC2530::SetAF_DATA_REQUEST_EXT(uint8_t DesEP, uint8_t PanID0, uint8_t PanID1, uint8_t SourceEP, uint8_t ClusterID0, uint8_t ClusterID1, uint8_t TransID, uint8_t Options, uint8_t Radius)
+boolean CC2530::LOG_APPEND(uint32_t Time, const void *Data)
 {
-  _AFDataReqExtCfg[0] = DesEP;
-  _AFDataReqExtCfg[1] = PanID0;
-  _AFDataReqExtCfg[2] = PanID1;
-  _AFDataReqExtCfg[3] = SourceEP;
-  _AFDataReqExtCfg[4] = ClusterID0;
-  _AFDataReqExtCfg[5] = ClusterID1;
-  _AFDataReqExtCfg[6] = TransID;
-  _AFDataReqExtCfg[7] = Options;
-  _AFDataReqExtCfg[8] = Radius;
+  if (_LogSlots == 0)
+  {
+    return 0;
+  }
+  LogRecord Rec;
+  Rec.Seq = _LogSeq++;
+  Rec.Status = LOG_QUEUED;
+  Rec.Time = Time;
+  memcpy(Rec.Data, Data, CC2530_LOG_DATA);
+  _LOG_WRITE(_LogHead, 0, &Rec, sizeof(Rec));
+  _LogHead = _LogHead + 1 < _LogSlots ? _LogHead + 1 : 0;
+  if (_LogCount < _LogSlots)
+  {
+    _LogCount++;
+  }
+  return 1;
 }
 
 /*
-  Set TX_POWER
-  Description: Set the radio transmit power in dBm
-  Valid Values: 0x00 to 0x04
-  Default Value: 0x04
+  LOG_COUNT
+  Description: Returns the number of readings queued in the log
 */
-void CC2530::SetTX_POWER(uint8_t Val)
+uint16_t CC2530::LOG_COUNT()
 {
-  _TXPower[3] = Val;
+  return _LogCount;
 }
 
 /*
-  POWER_UP
-  Description: Powers up the E18-MS1 by setting reset pin high
+  LOG_DRAIN
+  Description: Sends the queued readings, oldest first, to the coordinator on ClusterID with as many records per AF_DATA_REQUEST as fit in CC2530_ZCL_PAYLOAD bytes (9 by default), see Store and Forward for the frame.  Now is the current time on the clock used for LOG_APPEND().  The endpoints, options and radius are the SetAF_DATA_REQUEST() values.
+  Each frame waits up to Timeout milliseconds for its AF_DATA_CONFIRM and its records are only removed once it is confirmed, so call it after the sketch's own AF_DATA_CONFIRM_WAIT().  Returns the number of readings delivered, stopping at the first frame that is not confirmed.
 */
-void CC2530::POWER_UP()
+uint16_t CC2530::LOG_DRAIN(uint16_t ClusterID, uint32_t Now, unsigned long Timeout)
 {
-  pinMode(_RES, INPUT_PULLUP); // Wake on RESET
-  digitalWrite(_SS_MRDY, HIGH);
-  delay(4000); // Need Delay after reset for CC2530 to startup
+  const uint8_t Record = sizeof(uint32_t) + CC2530_LOG_DATA;
+  uint8_t Frame[CC2530_ZCL_PAYLOAD];
+  uint16_t Sent = 0;
+  while (_LogCount > 0)
+  {
+    uint8_t Count = (CC2530_ZCL_PAYLOAD - 5) / Record;
+    if (_LogCount < Count)
+    {
+      Count = _LogCount;
+    }
+    Frame[0] = Now;
+    Frame[1] = Now >> 8;
+    Frame[2] = Now >> 16;
+    Frame[3] = Now >> 24;
+    Frame[4] = Count;
+    uint16_t Slot = _LogHead >= _LogCount ? _LogHead - _LogCount : _LogHead + _LogSlots - _LogCount; // Oldest queued record
+    for (uint8_t i = 0; i < Count; i++)
+    {
+      _LOG_READ(Slot, offsetof(LogRecord, Time), &Frame[5 + i * Record], Record); // Time and Data, little endian as stored
+      Slot = Slot + 1 < _LogSlots ? Slot + 1 : 0;
+    }
+
+    uint8_t Length = 5 + Count * Record;
+    if (!_AF_DATA_REQUEST_START(0x00, 0x00, _Cfg.AFDataReq[0], _Cfg.AFDataReq[1], lowByte(ClusterID), highByte(ClusterID), Length))
+    {
+      return Sent;
+    }
+    _WRITE(Frame, Length);
+    if (_AF_DATA_REQUEST_END(0x01) != SREQ_COMPLETE)
+    {
+      AF_DATA_CONFIRM_CLEAR();                                        // Clears AF_FAILED of the rejected request, the sketch's requests stay tracked
+      return Sent;
+    }
+    if (AF_DATA_CONFIRM_WAIT(Timeout) != AF_CONFIRMED)
+    {
+      return Sent;
+    }
 
-  RECV_CALLBACK();
+    uint8_t Status = LOG_SENT;                                        // Marks every older record as sent too
+    _LOG_WRITE(_LOG_PREV(Slot), offsetof(LogRecord, Status), &Status, 1);
+    _LogCount -= Count;
+    Sent += Count;
+  }
+  return Sent;
 }
 
 /*
-  Commission the E18-MS1
-  Description: Clears the network state and configuration parameters then writes the new configuration parameters to non volatile memory.  This function should only be run once when joining a network.
+  Read or update Len bytes at Offset in log slot Slot
 */
-void CC2530::COMMISSION()
+void CC2530::_LOG_READ(uint16_t Slot, uint8_t Offset, void *Buf, uint8_t Len)
 {
-  WRITE_DATA(_NVStartUpClear); // ZCD_NV_STARTUP_OPTION_CLEAR
-
-  // RESET
-  SYS_RESET_REQ();
+#if defined(ARDUINO_ARCH_AVR)
+  eeprom_read_block(Buf, (const void*) (uintptr_t) (_LogStart + Slot * sizeof(LogRecord) + Offset), Len);
+#endif
+}
 
-  WRITE_DATA(_NVStartUpKeep); // ZCD_NV_STARTUP_OPTION_KEEP
-  WRITE_DATA(_LogicalType); // ZCD_NV_LogicalType
-  WRITE_DATA(_PanID); // ZCD_NV_PanID
-  WRITE_DATA(_Channel); // ZCD_NV_CHANLIST
-  WRITE_DATA(_PollRate); // ZCD_NV_POLL_RATE
-  WRITE_DATA(_QueuedPollRate); // ZCD_NV_QUEUED_POLL_RATE
-  WRITE_DATA(_ResponsePollRate); // ZCD_NV_RESPONSE_POLL_RATE
-  WRITE_DATA(_RejoinPollRate); // ZCD_NV_REJOIN_POLL_RATE
-  WRITE_DATA(_PollFailRetries); // ZCD_NV_POLL_FAILURE_RETRIES
-  WRITE_DATA(_CallBack); // ZCD_NV_ZDO_DIRECT_CB
-  WRITE_DATA(_PreCFGKeyEnable); // ZCD_NV_PRECFGKEYEnable
-  WRITE_DATA(_PreCFGKey); // ZCD_NV_PRECFGKEY
-  WRITE_DATA(_TXPower); // SYS_SET_TX_POWER
+void CC2530::_LOG_WRITE(uint16_t Slot, uint8_t Offset, const void *Buf, uint8_t Len)
+{
+#if defined(ARDUINO_ARCH_AVR)
+  eeprom_update_block(Buf, (void*) (uintptr_t) (_LogStart + Slot * sizeof(LogRecord) + Offset), Len);
+#endif
+}
 
-  // IMPORTANT! RESET again to apply POLL settings.  All NV settings are saved on RESET.  If you don't RESET after setting POLL NV settings there will be a periodic POLL every few seconds.
-  SYS_RESET_REQ();
+uint16_t CC2530::_LOG_PREV(uint16_t Slot)
+{
+  return Slot > 0 ? Slot - 1 : _LogSlots - 1;
 }
 
 /*
-  POLL
-  Description: The application processor polls the E18-MS1 for queued data
+  TICK
+  Description: Advances the pending synchronous request.  Reads the SRSP into ReceivedBytes when SRDY goes high, or ends the request when the SREQ timeout expires.  Returns the SreqResult of the current request.
 */
-void CC2530::POLL()
+uint8_t CC2530::TICK()
 {
-  while (digitalRead(_SRDY) == LOW)                                   // If SRDY is low CC2530 has message to send
+  if (_SreqResult != SREQ_PENDING)
   {
-    DEBUG_SERIAL.println(F("POLL"));
-    digitalWrite(_SS_MRDY, LOW);                                      // Detect SRDY is low then make MRDY low
-    SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
-    SPI.transfer(0x00);                                               // POLL message: Send three zero's to CC2530 (Length = 0, Cmd0 = 0 & Cmd1 = 0)
-    SPI.transfer(0x00);
-    SPI.transfer(0x00);
-
-    while (digitalRead(_SRDY) == LOW) {};                             // Wait for SRDY to go high (CC2530 has AREQ frame to send, and will set SRDY high when ready to send)
-
-    uint8_t Len = SPI.transfer(0x00);
-    uint8_t Cmd0 = SPI.transfer(0x00);
-    uint8_t Cmd1 = SPI.transfer(0x00);
+    return _SreqResult;
+  }
 
-    if (Len > 0)
+  if (_SRSP_READY())                                                  // SRSP ready (or AREQ received)
+  {
+    if ((_SreqCmd0 & 0xE0) == 0x40)
     {
+      _SreqStatus = 0x00;
+      _SREQ_END(SREQ_COMPLETE);
+      return _SreqResult;
+    }
 
-      ReceivedBytes[0] = Len;
-      ReceivedBytes[1] = Cmd0;
-      ReceivedBytes[2] = Cmd1;
-
-      for (int i = 0; i < Len; i++)
-      {
-        ReceivedBytes[i+3] = SPI.transfer(0x00);
-      }
-      NewData = true;
-      if (Cmd0 == 0x44 && Cmd1 == 0x81)
-      {
-        AFDataIncoming = true;
-      }
-      DEBUG_SERIAL.println(F("2530 AREQ"));                                 // Recieve AREQ message from CC2530
-      DEBUG_SERIAL.print(F("Data length: "));
-      DEBUG_SERIAL.println(Len, HEX);
-      DEBUG_SERIAL.print(F("CMD: 0x"));
-      DEBUG_SERIAL.println(cmd_conv(Cmd0, Cmd1), HEX);                      // Bit shift Cmd0 and Cmd1 to put in correct order.
-      DEBUG_SERIAL.print(F("Data: "));
-      for (int i = 0; i < Len; i++)
-      {
-        DEBUG_SERIAL.print(ReceivedBytes[i+3], HEX);
-        DEBUG_SERIAL.print(F(" "));
-      }
-      DEBUG_SERIAL.println(F(""));
-      DEBUG_SERIAL.println(F(""));
+    boolean Fits = SRSP();
+    _SreqResult = SREQ_BUS_ERROR;
+    if (Fits && ReceivedBytes[1] == (_SreqCmd0 | 0x40) && ReceivedBytes[2] == _SreqCmd1)  // SRSP Cmd0 = SREQ Cmd0 with type 0x60, same Cmd1
+    {
+      _SreqResult = SREQ_COMPLETE;
+      _SreqStatus = ReceivedBytes[0] > 0 ? ReceivedBytes[3] : 0x00;
     }
+    CC2530_TRACE_EVENT(TRACE_SRSP, ReceivedBytes[1], ReceivedBytes[2], ReceivedBytes[0], _SreqResult == SREQ_COMPLETE ? _SreqStatus : _SreqResult, _TraceSreq);
+    return _SreqResult;
+  }
+
+  if (millis() - _SreqStart >= _SreqTimeout)
+  {
+    _SREQ_END(SREQ_TIMEOUT);
+    CC2530_TRACE_EVENT(TRACE_TIMEOUT, _SreqCmd0, _SreqCmd1, 0, SREQ_TIMEOUT, _TraceSreq);
+    DEBUG_SERIAL.println(F("SREQ TIMEOUT"));
   }
-  SPI.endTransaction();
-  digitalWrite(_SS_MRDY, HIGH);                                       // At the end of a POLL set MRDY = HIGH.  SRDY will also remain HIGH, until the CC2530 has another queued message to send.
+  return _SreqResult;
 }
 
 /*
-  SRSP
-  Description: Synchronous response data from the E18-MS1 in response to a synchronous request by the application processor
+  SREQ_RESULT
+  Description: Returns the SreqResult of a request handle without advancing it.  Only the most recent request is held, earlier handles return SREQ_NONE.
 */
-void CC2530::SRSP()
+uint8_t CC2530::SREQ_RESULT(uint8_t Handle)
 {
-  DEBUG_SERIAL.println(F("SRSP"));
-
-  uint8_t Len = SPI.transfer(0x00);
-  uint8_t Cmd0 = SPI.transfer(0x00);
-  uint8_t Cmd1 = SPI.transfer(0x00);
-
-  if (Len > 0)
+  if (Handle == 0 || Handle != _SreqHandle)
   {
+    return SREQ_NONE;
+  }
+  return _SreqResult;
+}
 
-    ReceivedBytes[0] = Len;
-    ReceivedBytes[1] = Cmd0;
-    ReceivedBytes[2] = Cmd1;
+/*
+  SREQ_STATUS
+  Description: The status byte (first data byte) of the last completed SRSP.  0xFF if the last request did not complete.
+*/
+uint8_t CC2530::SREQ_STATUS()
+{
+  return _SreqStatus;
+}
 
-    for (int i = 0; i < Len; i++)
-    {
-      ReceivedBytes[i+3] = SPI.transfer(0x00);
-    }
-    DEBUG_SERIAL.println(F("2530 AREQ"));                                   // Recieve AREQ message from CC2530
-    DEBUG_SERIAL.print(F("Data length: "));
-    DEBUG_SERIAL.println(Len, HEX);
-    DEBUG_SERIAL.print(F("CMD: 0x"));
-    DEBUG_SERIAL.println(cmd_conv(Cmd0, Cmd1), HEX);                        // Bit shift Cmd0 and Cmd1 to put in correct order.
-    DEBUG_SERIAL.print(F("Data: "));
-    for (int i = 0; i < Len; i++)
+/*
+  SREQ_WAIT
+  Description: Blocks until the request completes, times out or fails.  Returns the SreqResult.
+*/
+uint8_t CC2530::SREQ_WAIT(uint8_t Handle)
+{
+  while (SREQ_RESULT(Handle) == SREQ_PENDING)
+  {
+    if (TICK() == SREQ_PENDING)
     {
-      DEBUG_SERIAL.print(ReceivedBytes[i+3], HEX);
-      DEBUG_SERIAL.print(F(" "));
+      _SLEEP(false);                                                  // Sleep until SRDY rises (SRSP ready) or the next millis() tick
     }
-    DEBUG_SERIAL.println(F(""));
-    DEBUG_SERIAL.println(F(""));
   }
-  SPI.endTransaction();
-  digitalWrite(_SS_MRDY, HIGH);                                       // At the end of a POLL set MRDY = HIGH.  SRDY will also remain HIGH, until the CC2530 has another queued message to send.
+  return SREQ_RESULT(Handle);
 }
 
 /*
-  Empty the Receive Buffer
+  SREQ_BUSY
+  Description: Returns true while a synchronous request is waiting for its response.
 */
-void CC2530::EMPTY_BUFFER()
+boolean CC2530::SREQ_BUSY()
 {
-  for (uint8_t n = 0; n < NumBytes; n++)
-  {
-    ReceivedBytes[n] = 0;
-  }
+  return _SreqResult == SREQ_PENDING;
 }
 
 /*
-  NEW_DATA
-  Description: Function returns true when an NewData is received for processing in the main sketch
+  Assert MRDY and wait for SRDY, bounded by the SREQ timeout.  Cmd0 and Cmd1 identify the request in the trace.
 */
-boolean CC2530::NEW_DATA()
+boolean CC2530::_SREQ_SELECT(uint8_t Cmd0, uint8_t Cmd1)
 {
-  if (NewData == true)
+#if !CC2530_TRACE
+  (void) Cmd0; (void) Cmd1;                                           // Only traced
+#endif
+#if CC2530_UART
+  if (_Uart)                                                          // No handshake: start the frame with its SOF
   {
-    NewData = false;
-    return 1;
+#if CC2530_TRACE
+    _TraceSreq = CC2530_TRACE_CLOCK();
+#endif
+    _Uart->write((uint8_t) 0xFE);
+    _UartTxFcs = 0;
+    return true;
   }
-  return 0;
+#endif
+  _MRDY(LOW);
+  unsigned long time_now = millis();
+#if CC2530_TRACE
+  _TraceSreq = CC2530_TRACE_CLOCK();
+#endif
+  while (_SRDY_HIGH())
+  {
+    if (millis() - time_now >= _SreqTimeout)
+    {
+      _MRDY(HIGH);
+      CC2530_TRACE_EVENT(TRACE_TIMEOUT, Cmd0, Cmd1, 0, SREQ_TIMEOUT, _TraceSreq);
+      DEBUG_SERIAL.println(F("SREQ TIMEOUT"));
+      return false;
+    }
+  }
+  SPI.beginTransaction(SPISettings(_SpiClock, MSBFIRST, SPI_MODE0));
+  return true;
 }
 
 /*
-  AF_INCOMING_MSG
-  Description: Function returns true when an AF_INCOMING_MSG is received for processing in the main sketch
+  Send Len bytes from Buf in one block.  On AVR the next byte is loaded while the current one shifts out, so the bus runs back to back instead of paying the SPI.transfer() call overhead for every byte.
 */
-boolean CC2530::AF_INCOMING_MSG()
+void CC2530::_WRITE(const uint8_t *Buf, uint8_t Len)
 {
-  if (AFDataIncoming == true)
+  if (Len == 0)
   {
-    AFDataIncoming = false;
-    return 1;
+    return;
   }
-  return 0;
+#if CC2530_UART
+  if (_Uart)
+  {
+    for (uint8_t i = 0; i < Len; i++)
+    {
+      _UartTxFcs ^= Buf[i];
+    }
+    _Uart->write(Buf, Len);
+    return;
+  }
+#endif
+#if defined(__AVR__)
+  SPDR = *Buf++;
+  while (--Len)
+  {
+    uint8_t Next = *Buf++;
+    while (!(SPSR & _BV(SPIF)));
+    SPDR = Next;
+  }
+  while (!(SPSR & _BV(SPIF)));
+  (void) SPDR;
+#else
+  uint8_t Chunk[16];                                                  // SPI.transfer(buf, n) overwrites the buffer with the received bytes
+  while (Len > 0)
+  {
+    uint8_t n = Len < sizeof(Chunk) ? Len : sizeof(Chunk);
+    memcpy(Chunk, Buf, n);
+    SPI.transfer(Chunk, n);
+    Buf += n;
+    Len -= n;
+  }
+#endif
 }
 
 /*
-  Recieve Callback
+  Send Len bytes from Buf in flash (PROGMEM) in one block, as _WRITE()
 */
-void CC2530::RECV_CALLBACK()
+void CC2530::_WRITE_P(const uint8_t *Buf, uint8_t Len)
 {
-  unsigned long time_now = millis();
-  while (millis() - time_now < 500)
+  if (Len == 0)
+  {
+    return;
+  }
+#if CC2530_UART
+  if (_Uart)
   {
-    POLL();
-    if (NewData == true)
+    while (Len--)
     {
-      NewData = false;
-      break;
+      uint8_t Byte = pgm_read_byte(Buf++);
+      _UartTxFcs ^= Byte;
+      _Uart->write(Byte);
     }
+    return;
+  }
+#endif
+#if defined(__AVR__)
+  SPDR = pgm_read_byte(Buf++);
+  while (--Len)
+  {
+    uint8_t Next = pgm_read_byte(Buf++);
+    while (!(SPSR & _BV(SPIF)));
+    SPDR = Next;
+  }
+  while (!(SPSR & _BV(SPIF)));
+  (void) SPDR;
+#else
+  uint8_t Chunk[16];
+  while (Len > 0)
+  {
+    uint8_t n = Len < sizeof(Chunk) ? Len : sizeof(Chunk);
+    memcpy_P(Chunk, Buf, n);
+    SPI.transfer(Chunk, n);
+    Buf += n;
+    Len -= n;
   }
+#endif
 }
 
 /*
-  Link Quality
-  Description: Print the short address and link quality from an AF_DATA_INCOMING message.  The link quality is from the last hop.
+  Send each segment in turn from RAM or flash
 */
-void CC2530::LINK_QUALITY()
+void CC2530::_WRITE_SG(const Segment *Segments, uint8_t Count)
 {
-  uint8_t Len = ReceivedBytes[0];
-  uint8_t ShortAddr0 = ReceivedBytes[Len];
-  uint8_t ShortAddr1 = ReceivedBytes[(Len + 1)];
-  uint8_t LQI = ReceivedBytes[12];
+  for (uint8_t i = 0; i < Count; i++)
+  {
+    if (Segments[i].Flash)
+    {
+      _WRITE_P(Segments[i].Data, Segments[i].Len);
+    }
+    else
+    {
+      _WRITE(Segments[i].Data, Segments[i].Len);
+    }
+  }
+}
 
-  DEBUG_SERIAL.print(F("Short Address: "));
-  DEBUG_SERIAL.print(ShortAddr0, HEX);
-  DEBUG_SERIAL.print(F(" "));
-  DEBUG_SERIAL.print(ShortAddr1, HEX);
-  DEBUG_SERIAL.print(F(" "));
-  DEBUG_SERIAL.print(F("LQI: "));
-  DEBUG_SERIAL.println(LQI, DEC);
+uint16_t CC2530::_SG_LENGTH(const Segment *Segments, uint8_t Count)
+{
+  uint16_t Length = 0;
+  for (uint8_t i = 0; i < Count; i++)
+  {
+    Length += Segments[i].Len;
+  }
+  return Length;
 }
 
 /*
-  Hardware Reset 2530
-  Description: Reset the E18-MS1 using the reset pin
+  Byte i of the payload gathered from Segments.  i must be less than their total length.
 */
-void CC2530::HARD_RESET_REQ()
+uint8_t CC2530::_SG_BYTE(const Segment *Segments, uint8_t i)
 {
-  DEBUG_SERIAL.println("");
-  DEBUG_SERIAL.println(F("HARDWARE RESET"));
-  pinMode(_RES, OUTPUT);
-  digitalWrite(_RES, LOW);
-  delay(100);
-  pinMode(_RES, INPUT_PULLUP);                                      // Wake on RESET
-  DEBUG_SERIAL.println("");
-  delay(4000);
-  RECV_CALLBACK();
+  while (i >= Segments->Len)
+  {
+    i -= Segments->Len;
+    Segments++;
+  }
+  return Segments->Flash ? pgm_read_byte(&Segments->Data[i]) : Segments->Data[i];
 }
 
 /*
-  SYS_RESET_REQ
-  Description: Reset the E18-MS1 using software through an internal watchdog reset.
+  Receive Len bytes into Buf in one block, clocking out zeros.  On AVR the next byte is started before the received one is stored.
 */
-void CC2530::SYS_RESET_REQ()
+void CC2530::_SPI_READ(uint8_t *Buf, uint8_t Len)
 {
-  DEBUG_SERIAL.println("");
-  DEBUG_SERIAL.println(F("SYS_RESET_REQ"));
-  WRITE_DATA(_SYS_Reset); // SYS_RESET_REQ
-  delay(4000);
-  RECV_CALLBACK();
+  if (Len == 0)
+  {
+    return;
+  }
+#if defined(__AVR__)
+  SPDR = 0x00;
+  while (--Len)
+  {
+    while (!(SPSR & _BV(SPIF)));
+    uint8_t In = SPDR;
+    SPDR = 0x00;
+    *Buf++ = In;
+  }
+  while (!(SPSR & _BV(SPIF)));
+  *Buf = SPDR;
+#else
+  memset(Buf, 0x00, Len);
+  SPI.transfer(Buf, Len);
+#endif
 }
 
 /*
-  Write Data to the E18-MS1
-  Description: Write data to the E18-MS1
+  Record a sent frame as the pending request and return its handle.  Over UART the frame is ended with its FCS.
 */
-void CC2530::WRITE_DATA(uint8_t *Data)
+uint8_t CC2530::_SREQ_SENT(uint8_t Cmd0, uint8_t Cmd1)
 {
-  DEBUG_SERIAL.println(F(""));
-  DEBUG_SERIAL.print(F("0x"));
-  DEBUG_SERIAL.println(Data[3],HEX);
-
-  uint8_t Len = Data[0]+3;
-
-  // SREQ
-  digitalWrite(_SS_MRDY, LOW);
-  while (digitalRead(_SRDY) == HIGH) {};
-  SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
-
-  for (int i = 0; i < Len; i++)
+#if CC2530_UART
+  if (_Uart)
   {
-    SPI.transfer(Data[i]);
+    _Uart->write(_UartTxFcs);
+    _UartSrsp = 0;
   }
+#endif
+  _SreqHandle++;
+  if (_SreqHandle == 0)
+  {
+    _SreqHandle = 1;
+  }
+  _SreqCmd0 = Cmd0;
+  _SreqCmd1 = Cmd1;
+  _SreqStatus = 0xFF;
+  _SreqResult = SREQ_PENDING;
+  _SreqStart = millis();
+#if CC2530_TRACE
+  _TraceSreq = CC2530_TRACE_CLOCK();
+#endif
+  return _SreqHandle;
+}
 
-  while (digitalRead(_SRDY) == LOW) {};
-
-  SRSP();
+/*
+  End the pending request without reading a response
+*/
+void CC2530::_SREQ_END(uint8_t Result)
+{
+#if CC2530_UART
+  if (_Uart)
+  {
+    _SreqResult = Result;
+    return;
+  }
+#endif
+  if (_SreqResult == SREQ_PENDING)
+  {
+    SPI.endTransaction();
+    _MRDY(HIGH);
+  }
+  _SreqResult = Result;
 }
 
 /*
@@ -641,18 +3370,31 @@ void CC2530::WRITE_DATA(uint8_t *Data)
 */
 void CC2530::ZB_GET_SHORT_ADDRESS(uint8_t ShortAddr[2])
 {
-  WRITE_DATA(_ZBGetShortAddr);
+  WRITE_DATA_P(ZBGetShortAddrFrame);
   ShortAddr[0] = ReceivedBytes[4];
   ShortAddr[1] = ReceivedBytes[5];
 }
 
+/*
+  UTIL_GET_DEVICE_INFO
+  Description: Reads the device information of the E18-MS1 into ReceivedBytes: Status, IEEEAddr (8 bytes), ShortAddr (2 bytes), DeviceType, DeviceState, NumAssocDevices and their addresses.  Returns the DeviceState, or 0xFF if the E18-MS1 did not respond.
+*/
+uint8_t CC2530::UTIL_GET_DEVICE_INFO()
+{
+  if (WRITE_DATA_P(UtilGetDeviceInfoFrame) != SREQ_COMPLETE || ReceivedBytes[0] < 14)
+  {
+    return 0xFF;
+  }
+  return ReceivedBytes[15];
+}
+
 /*
   Get IEEE Address of the E18-MS1
   Description: Obtain the IEEE address (8 bytes) of the local E18-MS1
 */
 void CC2530::ZB_GET_IEEE_ADDRESS(uint8_t IEEEAddr[8])
 {
-  WRITE_DATA(_ZBGetIEEEAddr);
+  WRITE_DATA_P(ZBGetIEEEAddrFrame);
   IEEEAddr[0] = ReceivedBytes[4];
   IEEEAddr[1] = ReceivedBytes[5];
   IEEEAddr[2] = ReceivedBytes[6];
@@ -674,20 +3416,106 @@ void CC2530::ZDO_MGMT_PERMIT_JOIN_REQ(bool PermitJoin)
   if (PermitJoin == true)
   {
     DEBUG_SERIAL.println(F("ZDO_MGMT_PERMIT_JOIN_REQ TRUE"));
-    WRITE_DATA(_PermitJoinTrue);
+    WRITE_DATA_P(PermitJoinTrueFrame);
   }
   else if (PermitJoin == false)
   {
     DEBUG_SERIAL.println(F("ZDO_MGMT_PERMIT_JOIN_REQ FASLE"));
-    WRITE_DATA(_PermitJoinFalse);
+    WRITE_DATA_P(PermitJoinFalseFrame);
+  }
+}
+
+/*
+  ENERGY_SCAN
+  Description: Measures the energy on the channels in ChannelMask (bit n for channel n) with a ZDO_MGMT_NWK_UPDATE_REQ to the coordinator, and returns the quietest of them (11 to 26), or 0 if the scan was refused or no result arrived within Timeout milliseconds.  Energy[Channel - 11] is set to the energy detected on each scanned channel, higher is busier, and 0xFF for the channels not scanned.
+  The coordinator must be running (ZDO_STARTUP_FROM_APP()).  Each channel is listened to for (2^ScanDuration + 1) * 15.36 ms (ScanDuration 0 to 5), 138 ms with the default of 3, so a scan of all 16 channels takes 2.2 seconds.  The ZDO_MGMT_NWK_UPDATE_NOTIFY stays in the receive ring for the application.
+  To commission a coordinator on the quietest channel, form the network on the allowed channels, scan them, then commission again on the result:
+    mycc2530.SetCHANLIST_MASK(Allowed);
+    mycc2530.COMMISSION();
+    mycc2530.AF_REGISTER(0x01);
+    mycc2530.ZDO_STARTUP_FROM_APP();
+    uint8_t Channel = mycc2530.ENERGY_SCAN(Allowed, Energy);
+    if (Channel)
+    {
+      mycc2530.SetCHANLIST(Channel);
+      mycc2530.COMMISSION_UPDATE();                                 // Clears the network state, so the network is formed again
+      mycc2530.AF_REGISTER(0x01);
+      mycc2530.ZDO_STARTUP_FROM_APP();
+    }
+*/
+uint8_t CC2530::ENERGY_SCAN(uint32_t ChannelMask, uint8_t Energy[16], uint8_t ScanDuration, unsigned long Timeout)
+{
+  memset(Energy, 0xFF, 16);
+  ChannelMask &= 0x07FFF800;
+  if (ChannelMask == 0 || ScanDuration > 5)
+  {
+    return 0;
+  }
+  DEBUG_SERIAL.println(F("ZDO_MGMT_NWK_UPDATE_REQ energy scan"));
+  uint8_t Data[8] = {(uint8_t) ChannelMask, (uint8_t) (ChannelMask >> 8), (uint8_t) (ChannelMask >> 16), (uint8_t) (ChannelMask >> 24), ScanDuration, 0x01, 0x00, 0x00};
+  if (SREQ_WAIT(SREQ_P(NwkUpdateFrame, Data, sizeof(Data))) != SREQ_COMPLETE || _SreqStatus != 0x00)
+  {
+    return 0;
+  }
+
+  _ScanEnergy = Energy;                                               // Filled by POLL() from the ZDO_MGMT_NWK_UPDATE_NOTIFY
+  unsigned long time_now = millis();
+  unsigned long Elapsed;
+  while (_ScanEnergy != 0 && (Elapsed = millis() - time_now) < Timeout)
+  {
+    WAIT_SRDY(Timeout - Elapsed);
+    _POLL();
+  }
+  if (_ScanEnergy != 0)
+  {
+    _ScanEnergy = 0;                                                  // A late notify must not write to Energy
+    return 0;
+  }
+
+  uint8_t Quietest = 0;
+  for (uint8_t Channel = 11; Channel <= 26; Channel++)
+  {
+    if ((ChannelMask & ((uint32_t) 1 << Channel)) && (Quietest == 0 || Energy[Channel - 11] < Energy[Quietest - 11]))
+    {
+      Quietest = Channel;
+    }
   }
+  DEBUG_SERIAL.print(F("Quietest channel: "));
+  DEBUG_SERIAL.println(Quietest);
+  return Quietest;
+}
+
+/*
+  Copy the energies of a ZDO_MGMT_NWK_UPDATE_NOTIFY into the Energy[] of the waiting ENERGY_SCAN(), one per scanned channel
+*/
+void CC2530::_SCAN_NOTIFY(const uint8_t *Frame)
+{
+  ZdoMgmtNwkUpdateNotify Notify(Frame);
+  if (!Notify)
+  {
+    return;
+  }
+  if (Notify.Status() == 0x00)
+  {
+    Segment Values = Notify.EnergyValues();
+    uint32_t Scanned = Notify.ScannedChannels();
+    uint8_t i = 0;
+    for (uint8_t Channel = 11; Channel <= 26 && i < Values.Len; Channel++)
+    {
+      if (Scanned & ((uint32_t) 1 << Channel))
+      {
+        _ScanEnergy[Channel - 11] = Values.Data[i++];
+      }
+    }
+  }
+  _ScanEnergy = 0;
 }
 
 /*
   ZDO_MGMT_LEAVE_REQ
   Description: Sent from the Coordinator to make a device leave the network
 */
-void CC2530::ZDO_MGMT_LEAVE_REQ(uint8_t DstAddr[2], uint8_t IEEEAddr[8])
+uint8_t CC2530::ZDO_MGMT_LEAVE_REQ(uint8_t DstAddr[2], uint8_t IEEEAddr[8])
 {
   uint8_t Len = 0x0B;
   uint8_t Cmd0 = 0x25;
@@ -695,20 +3523,10 @@ void CC2530::ZDO_MGMT_LEAVE_REQ(uint8_t DstAddr[2], uint8_t IEEEAddr[8])
   uint8_t Rejoin = 0x00;
 
   // Make array
-  uint8_t LeaveReq[24] = {Len, Cmd0, Cmd1, DstAddr[0], DstAddr[1], IEEEAddr[0], IEEEAddr[1], IEEEAddr[2], IEEEAddr[3], IEEEAddr[4], IEEEAddr[5], IEEEAddr[6], IEEEAddr[7], Rejoin};
+  uint8_t LeaveReq[14] = {Len, Cmd0, Cmd1, DstAddr[0], DstAddr[1], IEEEAddr[0], IEEEAddr[1], IEEEAddr[2], IEEEAddr[3], IEEEAddr[4], IEEEAddr[5], IEEEAddr[6], IEEEAddr[7], Rejoin};
 
   DEBUG_SERIAL.println(F("ZDO_MGMT_LEAVE_REQ"));
-  // SREQ
-  digitalWrite(_SS_MRDY, LOW);
-  while (digitalRead(_SRDY) == HIGH) {};
-  SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
-  for (int i = 0; i < sizeof(LeaveReq); i++)
-  {
-    SPI.transfer(LeaveReq[i]);
-  }
-  while (digitalRead(_SRDY) == LOW) {};
-
-  SRSP();
+  return SREQ_WAIT(SREQ(LeaveReq));
 }
 
 /*
@@ -719,7 +3537,7 @@ void CC2530::ZDO_MGMT_LEAVE_REQ(uint8_t DstAddr[2], uint8_t IEEEAddr[8])
   2. Send a ZDO_END_DEVICE_BIND_REQ(uint8_t EndPoint) on the Coordinator within the default 8 seconds Binding time.
   3. Send a AF_DATA_REQUEST_EXT (const T& Value) to destination mode 0x00 and it will automatically lookup the address in the binding table
 */
-void CC2530::ZDO_END_DEVICE_BIND_REQ (uint8_t EndPoint)
+uint8_t CC2530::ZDO_END_DEVICE_BIND_REQ (uint8_t EndPoint)
 {
   uint8_t Len = 0x15;
   uint8_t Cmd0 = 0x25;
@@ -744,17 +3562,7 @@ void CC2530::ZDO_END_DEVICE_BIND_REQ (uint8_t EndPoint)
   uint8_t ZDOEndDeviceBind[24] = {Len, Cmd0, Cmd1, DstAddr0, DstAddr1, ShortAddr[0], ShortAddr[1], IEEEAddr[0], IEEEAddr[1], IEEEAddr[2], IEEEAddr[3], IEEEAddr[4], IEEEAddr[5], IEEEAddr[6], IEEEAddr[7], Endpoint, ProfileID0, ProfileID1, AppNumInClusters, InCluster0, InCluster1, AppNumOutClusters, OutCluster0, OutCluster1};
 
   DEBUG_SERIAL.println(F("ZDO_END_DEVICE_BIND_REQ"));
-  // SREQ
-  digitalWrite(_SS_MRDY, LOW);
-  while (digitalRead(_SRDY) == HIGH) {};
-  SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
-  for (int i = 0; i < sizeof(ZDOEndDeviceBind); i++)
-  {
-    SPI.transfer(ZDOEndDeviceBind[i]);
-  }
-  while (digitalRead(_SRDY) == LOW) {};
-
-  SRSP();
+  return SREQ_WAIT(SREQ(ZDOEndDeviceBind));
 }
 
 /*
@@ -764,11 +3572,8 @@ void CC2530::ZDO_END_DEVICE_BIND_REQ (uint8_t EndPoint)
 void CC2530::ZDO_NODE_DESC_REQ(uint8_t DstAddr[2], uint8_t NWKAddrOfInterest[2])
 {
   DEBUG_SERIAL.println(F("ZDO_NODE_DESC_REQ"));
-  _NodeDesc[3] = DstAddr[0];
-  _NodeDesc[4] = DstAddr[1];
-  _NodeDesc[5] = NWKAddrOfInterest[0];
-  _NodeDesc[6] = NWKAddrOfInterest[1];
-  WRITE_DATA(_NodeDesc);
+  uint8_t Data[4] = {DstAddr[0], DstAddr[1], NWKAddrOfInterest[0], NWKAddrOfInterest[1]};
+  WRITE_DATA_P(NodeDescFrame, Data, sizeof(Data));
 }
 
 /*
@@ -794,8 +3599,8 @@ void CC2530::ZDO_NODE_DESC_REQ(uint8_t DstAddr[2], uint8_t NWKAddrOfInterest[2])
 void CC2530::SYS_GPIO_SET_DIR(uint8_t Val)  // Configures the direction of the GPIO pins as Outputs.
 {
   DEBUG_SERIAL.println(F("SYS_GPIO_Set_Dir SREQ"));
-  _GPIOSetDir[4] = Val;
-  WRITE_DATA(_GPIOSetDir);
+  uint8_t Data[2] = {0x00, Val};
+  WRITE_DATA_P(GPIOFrame, Data, sizeof(Data));
 }
 
 /*
@@ -805,8 +3610,8 @@ void CC2530::SYS_GPIO_SET_DIR(uint8_t Val)  // Configures the direction of the G
 void CC2530::SYS_GPIO_SET_INPUT_MODE(uint8_t Val)  // Configures the direction of the GPIO pins as Inputs.
 {
   DEBUG_SERIAL.println(F("SYS_GPIO_Set_INPUT_MODE SREQ"));
-  _GPIOSetInput[4] = Val;
-  WRITE_DATA(_GPIOSetInput);
+  uint8_t Data[2] = {0x01, Val};
+  WRITE_DATA_P(GPIOFrame, Data, sizeof(Data));
 }
 
 /*
@@ -816,8 +3621,8 @@ void CC2530::SYS_GPIO_SET_INPUT_MODE(uint8_t Val)  // Configures the direction o
 void CC2530::SYS_GPIO_SET(uint8_t Val) // Writes a 1 (Output High)
 {
   DEBUG_SERIAL.println(F("SYS_GPIO_Set SREQ"));
-  _GPIOSet[4] = Val;
-  WRITE_DATA(_GPIOSet);
+  uint8_t Data[2] = {0x02, Val};
+  WRITE_DATA_P(GPIOFrame, Data, sizeof(Data));
 }
 
 /*
@@ -827,8 +3632,8 @@ void CC2530::SYS_GPIO_SET(uint8_t Val) // Writes a 1 (Output High)
 void CC2530::SYS_GPIO_CLEAR(uint8_t Val) // Writes a 0 (Output Low)
 {
   DEBUG_SERIAL.println(F("SYS_GPIO_Clear SREQ"));
-  _GPIOClear[4] = Val;
-  WRITE_DATA(_GPIOClear);
+  uint8_t Data[2] = {0x03, Val};
+  WRITE_DATA_P(GPIOFrame, Data, sizeof(Data));
 }
 
 /*
@@ -838,15 +3643,15 @@ void CC2530::SYS_GPIO_CLEAR(uint8_t Val) // Writes a 0 (Output Low)
 void CC2530::SYS_GPIO_READ(uint8_t Val) // Reads the GPIO pins
 {
   DEBUG_SERIAL.println(F("SYS_GPIO_Read SREQ"));
-  _GPIORead[4] = Val;
-  WRITE_DATA(_GPIORead);
+  uint8_t Data[2] = {0x05, Val};
+  WRITE_DATA_P(GPIOFrame, Data, sizeof(Data));
 }
 
 /*
   AF_REGISTER
   Description: Register an applications endpoint description.  Multiple endpoints can be registered.  The profile ID and Cluster ID's are left as default because a proprietary profile is used in this application.
 */
-void CC2530::AF_REGISTER(uint8_t EndPoint)
+uint8_t CC2530::AF_REGISTER(uint8_t EndPoint)
 {
   uint8_t Len = 0x0D; // total length after Cmd1 excl. XOR
   uint8_t Cmd0 = 0x24;
@@ -870,63 +3675,57 @@ void CC2530::AF_REGISTER(uint8_t EndPoint)
   uint8_t AFRegister[16] = {Len, Cmd0, Cmd1, AppEndPoint, AppProfileID0, AppProfileID1, DeviceID0, DeviceID1, DeviceVer, LatencyReq, AppNumInClusters, InCluster0, InCluster1, AppNumOutClusters, OutCluster0, OutCluster1};
 
   DEBUG_SERIAL.println(F("AF_REGISTER SREQ"));
-  // SREQ
-  digitalWrite(_SS_MRDY, LOW);
-  while (digitalRead(_SRDY) == HIGH) {};
-  SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
-  for (int i = 0; i < sizeof(AFRegister); i++)
-  {
-    SPI.transfer(AFRegister[i]);
-  }
-  while (digitalRead(_SRDY) == LOW) {};
+  return SREQ_WAIT(SREQ(AFRegister));
+}
 
-  SRSP();
+/*
+  AF_REGISTER_P
+  Description: Registers the endpoint described by an AF_REGISTER frame kept in flash (PROGMEM), such as AfEndpoint<...>::Frame.  Returns the SreqResult, the status of the SRSP is in SREQ_STATUS().
+*/
+uint8_t CC2530::AF_REGISTER_P(const uint8_t *Frame)
+{
+  DEBUG_SERIAL.println(F("AF_REGISTER SREQ"));
+  return SREQ_WAIT(SREQ_P(Frame));
 }
 
 /*
   ZDO_STARTUP_FROM_APP
-  Description: Starts the device in the network
+  Description: Starts the device in the network.  Frames received meanwhile go to their handlers (ON_AREQ()), the rest are discarded
 */
 void CC2530::ZDO_STARTUP_FROM_APP()
 {
   DEBUG_SERIAL.println(F("ZDO_STARTUP_FROM_APP SREQ"));
-  WRITE_DATA(_ZDOStartUpFromApp); // ZDO_STARTUP_FROM_APP
+  _ZdoState = 0x00;
+  WRITE_DATA_P(ZDOStartUpFromAppFrame); // ZDO_STARTUP_FROM_APP
 
   unsigned long time_now = millis();
-  while (millis() - time_now < 60000)
+  unsigned long Elapsed;
+  while ((Elapsed = millis() - time_now) < 60000)
   {
-    POLL();
+    WAIT_SRDY(60000 - Elapsed);                                       // Sleeps until a state change is queued with SetSRDY_INTERRUPT()
+    POLL();                                                           // Tracks ZDO_STATE_CHANGE_IND in _ZdoState
 
-    if (NewData == true)
-    {
-      uint8_t Cmd0 = ReceivedBytes[1];
-      uint8_t Cmd1 = ReceivedBytes[2];
-      uint8_t State = ReceivedBytes[3];
+    while (NEW_DATA());                                               // Frames without a handler received during startup are consumed here
 
-      if (Cmd0 == 0x45 && Cmd1 == 0xC0)
-      {
-        if (State == 0x06)
-        {
-          DEBUG_SERIAL.println(F("Started as End Device"));
-          break;
-        }
-        else if (State == 0x07)
-        {
-          DEBUG_SERIAL.println(F("Started as Router"));
-          break;
-        }
-        else if (State == 0x09)
-        {
-          DEBUG_SERIAL.println(F("Started as Coordinator"));
-          break;
-        }
-        else if (State == 0x10)
-        {
-          DEBUG_SERIAL.println(F("Lost parent"));
-          break;
-        }
-      }
-      NewData = false;
+    if (_ZdoState == 0x06)
+    {
+      DEBUG_SERIAL.println(F("Started as End Device"));
+      return;
+    }
+    else if (_ZdoState == 0x07)
+    {
+      DEBUG_SERIAL.println(F("Started as Router"));
+      return;
+    }
+    else if (_ZdoState == 0x09)
+    {
+      DEBUG_SERIAL.println(F("Started as Coordinator"));
+      return;
+    }
+    else if (_ZdoState == 0x10)
+    {
+      DEBUG_SERIAL.println(F("Lost parent"));
+      return;
     }
   }
-}
+}
\ No newline at end of file
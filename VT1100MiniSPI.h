@@ -53,14 +53,140 @@
     #include "WProgram.h"
   #endif
 	#include "SPI.h"
+  #if defined(ARDUINO_ARCH_AVR)
+    #include <avr/eeprom.h>
+    #include <avr/sleep.h>
+  #endif
 
   /*
     Debug Mode
-    Turn debugging off in Library to save program space.
+    Turn debugging off in Library to save program space.  Frames are printed after MRDY is released, so debug output does not stretch the SPI transaction.
   */
-  #define DEBUG true //set to true for debug output, false for no debug output
+  #ifndef DEBUG
+    #define DEBUG true //set to true for debug output, false for no debug output
+  #endif
   #define DEBUG_SERIAL if(DEBUG)Serial
 
+  /*
+    Trace
+    Set CC2530_TRACE to 1 to record a compact binary event (TraceEvent) for every SREQ, SRSP, AREQ, timeout and discarded frame into a RAM ring of CC2530_TRACE_SIZE events.  Recording costs a micros() call and an 11 byte copy, with no Serial output.  Read the ring with TRACE_READ(), print it with TRACE_DUMP() or write it raw with TRACE_WRITE() for offline decoding.
+    With CC2530_TRACE at 0 (default) the ring and every trace point are compiled out.
+  */
+  #ifndef CC2530_TRACE
+    #define CC2530_TRACE 0
+  #endif
+  #ifndef CC2530_TRACE_SIZE
+    #define CC2530_TRACE_SIZE 16
+  #endif
+  #if CC2530_TRACE_SIZE > 255
+    #error CC2530_TRACE_SIZE must not exceed 255
+  #endif
+  #if CC2530_TRACE
+    #define CC2530_TRACE_CLOCK() micros()
+    #define CC2530_TRACE_EVENT(Type, Cmd0, Cmd1, Len, Status, Since) _TRACE(Type, Cmd0, Cmd1, Len, Status, Since)
+  #else
+    #define CC2530_TRACE_CLOCK() 0
+    #define CC2530_TRACE_EVENT(Type, Cmd0, Cmd1, Len, Status, Since)
+  #endif
+
+  /*
+    Receive Ring
+    Capacity in bytes of the AREQ receive ring that POLL() drains into.  Frames are stored as received (Len, Cmd0, Cmd1, Data), so each frame uses Len + 3 bytes.  Maximum 255.
+  */
+  #ifndef CC2530_RX_RING_SIZE
+    #define CC2530_RX_RING_SIZE 128
+  #endif
+  #if CC2530_RX_RING_SIZE > 255
+    #error CC2530_RX_RING_SIZE must not exceed 255
+  #endif
+
+  /*
+    ZCL
+    CC2530_ZCL_ATTRIBUTES is the largest attribute table SetZCL_ATTRIBUTES() accepts (one dirty bit of RAM each).  CC2530_ZCL_PAYLOAD is the largest Report Attributes payload ZCL_REPORT() sends in one AF_DATA_REQUEST, a cluster with more changed attributes is split over several frames.
+    CC2530_ZCL_REPORTING is the number of attributes that can have a reporting configuration (17 bytes of RAM each).
+  */
+  #ifndef CC2530_ZCL_ATTRIBUTES
+    #define CC2530_ZCL_ATTRIBUTES 16
+  #endif
+  #if CC2530_ZCL_ATTRIBUTES > 255
+    #error CC2530_ZCL_ATTRIBUTES must not exceed 255
+  #endif
+  #ifndef CC2530_ZCL_PAYLOAD
+    #define CC2530_ZCL_PAYLOAD 80
+  #endif
+  #if CC2530_ZCL_PAYLOAD > 245
+    #error CC2530_ZCL_PAYLOAD must not exceed 245 (an AF_DATA_REQUEST of 255 bytes)
+  #endif
+  #ifndef CC2530_ZCL_REPORTING
+    #define CC2530_ZCL_REPORTING 4
+  #endif
+
+  /*
+    AF Confirms
+    The number of AF_DATA_REQUESTs whose AF_DATA_CONFIRM is tracked at once (one byte of RAM each).  Sending more before they are confirmed gives up on the oldest.
+  */
+  #ifndef CC2530_AF_PENDING
+    #define CC2530_AF_PENDING 4
+  #endif
+
+  /*
+    Handlers
+    CC2530_HANDLERS is the number of handlers ON_AREQ() can register by command (4 bytes of RAM each on the Atmega328P), CC2530_AF_HANDLERS the number ON_AF_INCOMING_MSG() can register by endpoint and cluster (5 bytes each).
+  */
+  #ifndef CC2530_HANDLERS
+    #define CC2530_HANDLERS 4
+  #endif
+  #ifndef CC2530_AF_HANDLERS
+    #define CC2530_AF_HANDLERS 4
+  #endif
+  #if CC2530_HANDLERS > 255 || CC2530_AF_HANDLERS > 255
+    #error CC2530_HANDLERS and CC2530_AF_HANDLERS must not exceed 255
+  #endif
+
+  /*
+    Device Table
+    Set CC2530_DEVICES to the number of devices a coordinator or router keeps track of (up to 127, 20 bytes of RAM each and 2 bytes for the address hashes).  POLL() adds the source of every AF_INCOMING_MSG and ZDO_END_DEVICE_ANNCE_IND and removes devices that leave (ZDO_LEAVE_IND).  Look a device up by short or IEEE address with DEVICE_FIND() and DEVICE_FIND_IEEE() in constant time.
+    With CC2530_DEVICES at 0 (default) the table is compiled out.
+  */
+  #ifndef CC2530_DEVICES
+    #define CC2530_DEVICES 0
+  #endif
+  #if CC2530_DEVICES > 127
+    #error CC2530_DEVICES must not exceed 127
+  #endif
+  #define CC2530_DEVICE_HASH (2 * CC2530_DEVICES)
+
+  /*
+    Store and Forward
+    CC2530_LOG_DATA is the size of the reading kept in each EEPROM record by LOG_APPEND().  A record adds a 4 byte timestamp, a 2 byte sequence number and a status byte, 11 bytes by default (93 records in the 1 KB of the Atmega328P).
+  */
+  #ifndef CC2530_LOG_DATA
+    #define CC2530_LOG_DATA 4
+  #endif
+
+  /*
+    Adaptive TX Power
+    After TX_POWER_BEGIN(), CC2530_TX_POWER_HOLD confirmed AF_DATA_REQUESTs in a row with enough link margin lower the transmit power by 1 dBm, and a failed or missing AF_DATA_CONFIRM raises it by CC2530_TX_POWER_UP dBm at once and doubles the hold.  A level that has held for CC2530_TX_POWER_SETTLE confirms in a row is kept in EEPROM and halves the hold.
+  */
+  #ifndef CC2530_TX_POWER_HOLD
+    #define CC2530_TX_POWER_HOLD 8
+  #endif
+  #ifndef CC2530_TX_POWER_UP
+    #define CC2530_TX_POWER_UP 3
+  #endif
+  #ifndef CC2530_TX_POWER_SETTLE
+    #define CC2530_TX_POWER_SETTLE 32
+  #endif
+
+  /*
+    Transport
+    Set CC2530_UART to 1 to add the CC2530(Stream &Port) constructor, which drives the E18-MS1 in UART ZNP mode (Z-Stack ZNP Interface Specification, section 5) from a serial port instead of SPI.  Frames are sent and received as SOF (0xFE), Len, Cmd0, Cmd1, Data, FCS (XOR of Len to the last data byte), with no MRDY/SRDY handshake: an SRSP is recognised by its Cmd0 type (0x60) among the AREQs.  The rest of the API works the same over both transports.  Adds a NumBytes buffer for the frame being received.
+    With CC2530_UART at 0 (default) only SPI is compiled.
+  */
+  #ifndef CC2530_UART
+    #define CC2530_UART 0
+  #endif
+
   /*
     Class
     CC2530
@@ -72,41 +198,166 @@
     /*
       Global Variables
     */
-		const uint8_t NumBytes = 64;
+		static const uint8_t NumBytes = 64;
 		uint8_t ReceivedBytes[64];
-    boolean NewData = false;
-    boolean AFDataIncoming = false; // New AF_DATA_INOMING message
+    boolean NewData = false; // Frames waiting in the receive ring
+    boolean AFDataIncoming = false; // New AF_DATA_INOMING message since the receive ring was last empty
+
+    /*
+      SREQ Results
+      Returned by SREQ_RESULT(), TICK() and SREQ_WAIT() for a request handle
+    */
+    enum SreqResult
+    {
+      SREQ_NONE = 0,      // No request with this handle (never issued or superseded)
+      SREQ_PENDING,       // SREQ sent, waiting for the SRSP
+      SREQ_COMPLETE,      // SRSP received, status byte from SREQ_STATUS()
+      SREQ_TIMEOUT,       // SRDY did not respond within the SREQ timeout
+      SREQ_BUS_ERROR      // SRSP did not match the request (wrong command or RPC error)
+    };
+
+    /*
+      AF Confirm Results
+      Returned by AF_DATA_CONFIRM_WAIT() for the AF_DATA_REQUESTs sent since it last returned
+    */
+    enum AfConfirm
+    {
+      AF_CONFIRMED = 0,   // Every request was confirmed with status success
+      AF_FAILED,          // A request was rejected or confirmed with an error status (e.g. 0xCD no route, 0xE9 no MAC ACK)
+      AF_TIMEOUT          // A request was not confirmed in time
+    };
+
+    /*
+      Trace Events
+      Wait is the time in microseconds since the start of the step, saturating at 65535:
+      TRACE_SREQ      MRDY asserted until SRDY went low (handshake)
+      TRACE_SRSP      SREQ sent until the SRSP was read.  Status is the SRSP status byte, Len the SRSP length
+      TRACE_AREQ      POLL sent until SRDY went high.  Cmd0, Cmd1 and Len of the received frame
+      TRACE_TIMEOUT   Request start until it was given up.  Cmd0 and Cmd1 of the request, Status the SreqResult
+      TRACE_DROPPED   AREQ discarded because the receive ring was full
+      TRACE_OVERRUN   AREQ discarded (or SRSP truncated) because it was longer than ReceivedBytes
+      TRACE_WRITE() writes each event as 11 bytes: Time (4 bytes, little endian), Wait (2 bytes, little endian), Type, Cmd0, Cmd1, Len, Status.
+    */
+    enum TraceType
+    {
+      TRACE_SREQ = 1,
+      TRACE_SRSP,
+      TRACE_AREQ,
+      TRACE_TIMEOUT,
+      TRACE_DROPPED,
+      TRACE_OVERRUN
+    };
+
+    struct TraceEvent
+    {
+      uint32_t Time;      // micros() when the event was recorded
+      uint16_t Wait;
+      uint8_t Type;
+      uint8_t Cmd0;
+      uint8_t Cmd1;
+      uint8_t Len;
+      uint8_t Status;
+    };
+
+    /*
+      SYS_RESET_IND
+      Sent by the E18-MS1 once it has started after a reset.  Reason: 0x00 power-up, 0x01 external, 0x02 watchdog.  The firmware version is MajorRel.MinorRel.
+    */
+    struct ResetInd
+    {
+      uint8_t Reason;
+      uint8_t TransportRev;
+      uint8_t ProductId;
+      uint8_t MajorRel;
+      uint8_t MinorRel;
+      uint8_t HwRev;
+    };
+
+    /*
+      Device
+      An entry of the device table (CC2530_DEVICES).  IEEEAddr is least significant byte first as in the ZNP frames, all zero until the device has announced itself.  Seq is the APS counter (TransSeqNumber) of its last AF_INCOMING_MSG, Gaps counts the APS counters skipped since: frames lost, or sent to other devices.
+    */
+    struct Device
+    {
+      uint16_t ShortAddr;
+      uint8_t IEEEAddr[8];
+      unsigned long LastSeen; // millis() of the last frame from the device
+      uint8_t LQI; // Rolling average link quality of the last hop
+      uint8_t Seq;
+      uint16_t Messages;
+      uint16_t Gaps;
+    };
 
     CC2530(uint8_t PIN_EN = 7, uint8_t PIN_SRDY = 8, uint8_t PIN_RES = 9, uint8_t PIN_SS_MRDY = 10, uint8_t PIN_MOSI = 11, uint8_t PIN_MISO = 12, uint8_t PIN_SCK = 13);
-    void POWER_UP();
+#if CC2530_UART
+    CC2530(Stream &Port, uint8_t PIN_EN = 7, uint8_t PIN_RES = 9);
+#endif
+    uint8_t POWER_UP();
+    uint8_t WARM_START();
     void COMMISSION();
-    void WRITE_DATA(uint8_t *Data);
-		void HARD_RESET_REQ();
-    void SYS_RESET_REQ();
+    uint8_t COMMISSION_UPDATE(boolean Reset = true);
+    uint8_t WRITE_DATA(uint8_t *Data);
+    uint8_t WRITE_DATA_P(const uint8_t *Frame, const uint8_t *Data = 0, uint8_t DataLen = 0);
+    uint8_t SREQ(const uint8_t *Data);
+    uint8_t SREQ_P(const uint8_t *Frame, const uint8_t *Data = 0, uint8_t DataLen = 0);
+    uint8_t TICK();
+    uint8_t SREQ_RESULT(uint8_t Handle);
+    uint8_t SREQ_STATUS();
+    uint8_t SREQ_WAIT(uint8_t Handle);
+    boolean SREQ_BUSY();
+		uint8_t HARD_RESET_REQ();
+    uint8_t SYS_RESET_REQ();
+    boolean SYS_RESET_IND(ResetInd &Ind);
 		void POLL();
 		void EMPTY_BUFFER();
-		void SRSP();
+		boolean SRSP();
 		boolean NEW_DATA();
     boolean AF_INCOMING_MSG();
+    const uint8_t *PEEK_FRAME();
+    boolean POP_FRAME();
+    boolean READ_FRAME(uint8_t *Buf);
+    uint8_t GATEWAY_WRITE(Print &Out);
+    uint16_t GATEWAY_SKIPPED();
+    uint8_t RX_AVAILABLE();
+    uint8_t RX_HIGH_WATER();
+    uint16_t RX_DROPPED();
+    uint16_t RX_OVERRUNS();
+    uint16_t RX_ERRORS();
+    uint16_t RX_UNHANDLED();
     void RECV_CALLBACK();
+    uint8_t ZDO_STATE();
+    boolean WAIT_SRDY(unsigned long Timeout);
+    static void SRDY_ISR();
+    uint8_t TRACE_COUNT();
+    boolean TRACE_READ(uint8_t Index, TraceEvent &Event);
+    void TRACE_DUMP(Print &Out);
+    void TRACE_WRITE(Print &Out);
+    void TRACE_CLEAR();
     void LINK_QUALITY();
+    const Device *DEVICE_FIND(uint16_t ShortAddr);
+    const Device *DEVICE_FIND_IEEE(const uint8_t IEEEAddr[8]);
+    const Device *DEVICE_AT(uint8_t Index);
+    uint8_t DEVICE_COUNT();
 		void SYS_GPIO_SET_DIR(uint8_t Val);
 		void SYS_GPIO_SET_INPUT_MODE(uint8_t Val);
 		void SYS_GPIO_SET(uint8_t Val);
 		void SYS_GPIO_CLEAR(uint8_t Val);
 		void SYS_GPIO_READ(uint8_t Val);
-		void AF_REGISTER(uint8_t EndPoint);
+		uint8_t AF_REGISTER(uint8_t EndPoint);
 		void ZDO_STARTUP_FROM_APP();
     void ZB_GET_SHORT_ADDRESS(uint8_t ShortAddr[2]);
     void ZB_GET_IEEE_ADDRESS(uint8_t IEEEAddr[8]);
+    uint8_t UTIL_GET_DEVICE_INFO();
     void ZDO_MGMT_PERMIT_JOIN_REQ(bool PermitJoin = true);
-    void ZDO_END_DEVICE_BIND_REQ(uint8_t EndPoint);
-    void ZDO_MGMT_LEAVE_REQ(uint8_t DstAddr[2], uint8_t IEEEAddr[8]);
+    uint8_t ZDO_END_DEVICE_BIND_REQ(uint8_t EndPoint);
+    uint8_t ZDO_MGMT_LEAVE_REQ(uint8_t DstAddr[2], uint8_t IEEEAddr[8]);
     void ZDO_NODE_DESC_REQ(uint8_t DstAddr[2], uint8_t NWKAddrOfInterest[2]);
+    uint8_t ENERGY_SCAN(uint32_t ChannelMask, uint8_t Energy[16], uint8_t ScanDuration = 3, unsigned long Timeout = 10000);
     uint16_t cmd_conv(uint8_t Cmd0, uint8_t Cmd1);
     void SetPANID(uint16_t Val = 0);
     void SetLOGICAL_TYPE(uint8_t Val = 0);
     void SetCHANLIST(uint8_t Val = 0);
+    void SetCHANLIST_MASK(uint32_t Mask);
     void SetZDO_DIRECT_CB(uint8_t Val = 0);
     void SetPOLL_RATE(uint16_t Val = 0);
     void SetQUEUED_POLL_RATE(uint16_t Val = 0);
@@ -117,48 +368,74 @@
     void SetPRECFGKEY(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0, uint8_t e = 0, uint8_t f = 0, uint8_t g = 0, uint8_t h = 0, uint8_t i = 0, uint8_t j = 0, uint8_t k = 0, uint8_t l = 0, uint8_t m = 0, uint8_t n = 0, uint8_t o = 0, uint8_t p = 0);
     void SetAF_DATA_REQUEST(uint8_t DesEP = 0, uint8_t SourceEP = 0, uint8_t ClusterID0 = 0, uint8_t ClusterID1 = 0, uint8_t TransID = 0, uint8_t Options = 0, uint8_t Radius = 0);
     void SetAF_DATA_REQUEST_EXT(uint8_t DesEP = 0, uint8_t PanID0 = 0, uint8_t PanID1 = 0, uint8_t SourceEP = 0, uint8_t ClusterID0 = 0, uint8_t ClusterID1 = 0, uint8_t TransID = 0, uint8_t Options = 0, uint8_t Radius = 0);
-    void SetTX_POWER(uint8_t Val = 0);
+    void SetTX_POWER(int8_t Val = 0);
+    void SetSREQ_TIMEOUT(uint16_t Val = 2000);
+    void SetRESET_TIMEOUT(uint16_t Val = 5000);
+    void SetSPI_CLOCK(uint32_t Val = 4000000);
+    void SetSRDY_INTERRUPT(boolean Val = true);
+    void SetSLEEP_MODE(uint8_t Val = 0);
+    void SetDISPATCH_DISCARD(boolean Val = true);
 
     /*
-      AF_DATA_REQUEST
-      Used by the Application processor to send a message
+      AF_REGISTER Endpoints
+      An endpoint described at compile time: EndPoint, ProfileID, DeviceID, the clusters it receives (In) and sends (Out), and DeviceVer.  The compiler lays out the whole AF_REGISTER frame, counts its Len and keeps it in flash:
+        typedef CC2530::AfEndpoint<0x01, 0x0104, 0x0302, CC2530::Clusters<0x0000, 0x0402, 0x0405> > SensorEndpoint; // Home Automation temperature sensor
+        mycc2530.AF_REGISTER<SensorEndpoint>();
+      Several endpoints are registered in one call, one AF_REGISTER SREQ each: AF_REGISTER<SensorEndpoint, LightEndpoint>().  Returns the SreqResult of the first request that did not complete, otherwise SREQ_COMPLETE with the status of the last one in SREQ_STATUS().
+      AF_REGISTER_P() registers one AF_REGISTER frame from flash, e.g. SensorEndpoint::Frame.
     */
-    template <typename T> unsigned int AF_DATA_REQUEST (uint8_t ShortAddr0, uint8_t ShortAddr1, const T& Value, uint8_t Length)
+    template <uint16_t... ClusterIDs> struct Clusters {};
+    template <uint8_t EndPoint, uint16_t ProfileID, uint16_t DeviceID, typename In, typename Out = Clusters<>, uint8_t DeviceVer = 0x01> struct AfEndpoint;
+
+    template <typename Endpoint, typename... More> uint8_t AF_REGISTER()
     {
-      uint8_t Len = Length + 10;
-      uint8_t Cmd0 = 0x24;
-      uint8_t Cmd1 = 0x01;
-      uint8_t DstAddr0 = ShortAddr1;
-      uint8_t DstAddr1 = ShortAddr0;
-      uint8_t DesEP = _AFDataReqCfg[0];
-      uint8_t SourceEP = _AFDataReqCfg[1];
-      uint8_t ClusterID0 = _AFDataReqCfg[2];
-      uint8_t ClusterID1 = _AFDataReqCfg[3];
-      uint8_t TransID = _AFDataReqCfg[4];
-      uint8_t Options = _AFDataReqCfg[5];
-      uint8_t Radius = _AFDataReqCfg[6];
-      uint8_t DataLen = Length;
-
-      // Make array
-      uint8_t Data[13] = {Len, Cmd0, Cmd1, DstAddr0, DstAddr1, DesEP, SourceEP, ClusterID0, ClusterID1, TransID, Options, Radius, DataLen};
-      DEBUG_SERIAL.println(F("AF_DATA_REQUEST SREQ"));
-      // SREQ
-      digitalWrite(_SS_MRDY, LOW);
-      while (digitalRead(_SRDY) == HIGH) {};
-      SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
-      for (int i = 0; i < sizeof(Data); i++)
+      const uint8_t *Frames[] = {Endpoint::Frame, More::Frame...};
+      uint8_t Result = SREQ_NONE;
+      for (uint8_t i = 0; i < sizeof(Frames) / sizeof(Frames[0]); i++)
       {
-        SPI.transfer(Data[i]);
+        Result = AF_REGISTER_P(Frames[i]);
+        if (Result != SREQ_COMPLETE)
+        {
+          break;
+        }
       }
+      return Result;
+    }
+    uint8_t AF_REGISTER_P(const uint8_t *Frame);
 
-      const uint8_t * p = (const uint8_t*) &Value; // Send Data as a stream of bytes
-      unsigned int i;
-      for (i = 0; i < Length; i++)
-      SPI.transfer(*p++);
+    /*
+      Handlers
+      POLL() hands every received frame, oldest first, to the handler registered for it and removes it from the receive ring:
+        void OnOff(CC2530 &Radio, const uint8_t *Frame) { ... }
+        mycc2530.ON_AF_INCOMING_MSG(0x01, 0x0006, OnOff);       // Endpoint 1, On/Off cluster
+        mycc2530.ON_AREQ(0x45C0, OnStateChange);                // ZDO_STATE_CHANGE_IND
+      An AF_INCOMING_MSG goes to the handler of its destination endpoint and cluster, if not to the ON_AREQ(0x4481) handler.  The ON_AREQ(0x0000) handler takes every frame no other handler does.  Frame is ReceivedBytes (Len, Cmd0, Cmd1, Data), so ZCL_READ_ATTRIBUTES(), COPY_PAYLOAD() etc. can be used in a handler.
+      Each frame is handled once and in the order received.  A frame without a handler does not hold back the frames after it: it stays in the ring, in the order received, for AF_INCOMING_MSG() or READ_FRAME().  A sketch that only uses handlers calls SetDISPATCH_DISCARD() to have those frames removed, so no catch-all handler is needed.  A null Handler removes the registration.  Returns false when the table (CC2530_HANDLERS or CC2530_AF_HANDLERS) is full.
+    */
+    typedef void (*FrameHandler)(CC2530 &Radio, const uint8_t *Frame);
+    boolean ON_AREQ(uint16_t Cmd, FrameHandler Handler);
+    boolean ON_AF_INCOMING_MSG(uint8_t EndPoint, uint16_t ClusterID, FrameHandler Handler);
+    uint8_t DISPATCH();
 
-      while (digitalRead(_SRDY) == LOW) {};
-      SRSP();
-      return i;
+    /*
+      Segment
+      One piece of an AF_DATA_REQUEST_SG() payload: Len bytes at Data, read from flash (PROGMEM) when Flash is true.
+    */
+    struct Segment
+    {
+      const uint8_t *Data;
+      uint8_t Len;
+      boolean Flash;
+    };
+
+    /*
+      AF_DATA_REQUEST
+      Used by the Application processor to send a message
+    */
+    template <typename T> unsigned int AF_DATA_REQUEST (uint8_t ShortAddr0, uint8_t ShortAddr1, const T& Value, uint8_t Length)
+    {
+      Segment Payload = {(const uint8_t*) &Value, Length, false}; // Send Value as a stream of bytes
+      return AF_DATA_REQUEST_SG(ShortAddr0, ShortAddr1, &Payload, 1);
     }
 
     /*
@@ -170,65 +447,325 @@
     */
     template <typename T> unsigned int AF_DATA_REQUEST_EXT (uint8_t AddrMode, const uint8_t IEEEAddr[8], const T& Value, uint8_t Length)
     {
-      uint8_t Len = Length + 20;
-      uint8_t Cmd0 = 0x24;
-      uint8_t Cmd1 = 0x02;
-      uint8_t DstAddrMode = AddrMode; // Use destination mode 0x00 to lookup the address in the binding table
-      uint8_t DstAddr0 = IEEEAddr[7];
-      uint8_t DstAddr1 = IEEEAddr[6];
-      uint8_t DstAddr2 = IEEEAddr[5];
-      uint8_t DstAddr3 = IEEEAddr[4];
-      uint8_t DstAddr4 = IEEEAddr[3];
-      uint8_t DstAddr5 = IEEEAddr[2];
-      uint8_t DstAddr6 = IEEEAddr[1];
-      uint8_t DstAddr7 = IEEEAddr[0];
-      uint8_t DesEP = _AFDataReqExtCfg[0];
-      uint8_t DstPanId0 = _AFDataReqExtCfg[1];
-      uint8_t DstPanId1 = _AFDataReqExtCfg[2];
-      uint8_t SourceEP = _AFDataReqExtCfg[3];
-      uint8_t ClusterID0 = _AFDataReqExtCfg[4];
-      uint8_t ClusterID1 = _AFDataReqExtCfg[5];
-      uint8_t TransID = _AFDataReqExtCfg[6];
-      uint8_t Options = _AFDataReqExtCfg[7];
-      uint8_t Radius = _AFDataReqExtCfg[8];
-      uint8_t DataLen0 = Length;
-      uint8_t DataLen1 = 0x00;
-
-      // Make array
-      uint8_t Data[23] = {Len, Cmd0, Cmd1, DstAddrMode, DstAddr0, DstAddr1, DstAddr2, DstAddr3, DstAddr4, DstAddr5, DstAddr6, DstAddr7, DesEP, DstPanId0, DstPanId1, SourceEP, ClusterID0, ClusterID1, TransID, Options, Radius, DataLen0, DataLen1};
-      DEBUG_SERIAL.println(F("AF_DATA_REQUEST_EXT SREQ"));
-      // SREQ
-      digitalWrite(_SS_MRDY, LOW);
-      while (digitalRead(_SRDY) == HIGH) {};
-      SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
-      for (int i = 0; i < sizeof(Data); i++)
-      {
-        SPI.transfer(Data[i]);
-      }
+      Segment Payload = {(const uint8_t*) &Value, Length, false};
+      return AF_DATA_REQUEST_EXT_SG(AddrMode, IEEEAddr, &Payload, 1);
+    }
 
-      const uint8_t * p = (const uint8_t*) &Value; // Send Data as a stream of bytes
-      unsigned int i;
-      for (i = 0; i < Length; i++)
-      SPI.transfer(*p++);
+    uint8_t AF_DATA_REQUEST_SG(uint8_t ShortAddr0, uint8_t ShortAddr1, const Segment *Segments, uint8_t Count);
+    uint8_t AF_DATA_REQUEST_EXT_SG(uint8_t AddrMode, const uint8_t IEEEAddr[8], const Segment *Segments, uint8_t Count);
+    uint8_t AF_TRANS_ID();
+    uint8_t AF_IN_FLIGHT();
+    uint8_t AF_DATA_CONFIRM_WAIT(unsigned long Timeout);
+    void AF_DATA_CONFIRM_CLEAR();
 
-      while (digitalRead(_SRDY) == LOW) {};
-      SRSP();
-      return i;
-    }
+    /*
+      ZCL Attributes
+      The application declares its attributes once in a table kept in flash and passes it to SetZCL_ATTRIBUTES():
+        int16_t Temperature;
+        const CC2530::ZclAttribute Attributes[] PROGMEM = {
+          {0x0402, 0x0000, 0x29, sizeof(Temperature), CC2530::ZCL_REPORTABLE, &Temperature}, // Temperature Measurement: MeasuredValue int16
+        };
+      Value points to Size bytes in RAM in ZCL (little endian) order, or in flash with ZCL_FLASH.  For a character string (0x42) Size is the string length.
+      Every attribute in the table is also answered by ZCL_READ_ATTRIBUTES(), e.g. the Basic cluster (0x0000) attributes read when the device is interviewed.
+    */
+    enum ZclFlags
+    {
+      ZCL_REPORTABLE = 0x01,  // Sent by ZCL_REPORT() after ZCL_CHANGED()
+      ZCL_FLASH = 0x02        // Value is in flash (PROGMEM)
+    };
+
+    struct ZclAttribute
+    {
+      uint16_t ClusterID;
+      uint16_t AttrID;
+      uint8_t DataType;
+      uint8_t Size;
+      uint8_t Flags;
+      const void *Value;
+    };
+
+    void SetZCL_ATTRIBUTES(const ZclAttribute *Table, uint8_t Count);
+    boolean ZCL_CHANGED(uint16_t ClusterID, uint16_t AttrID);
+    uint8_t ZCL_REPORT(uint16_t ShortAddr = 0x0000);
+    boolean ZCL_READ_ATTRIBUTES();
+    boolean ZCL_INTERVIEWED(uint16_t ClusterID = 0x0000);
+
+    /*
+      ZCL Reporting Configuration
+      A reportable attribute with a reporting configuration is only reported by ZCL_DUE() when it has changed by at least Change since its last report and MinInterval seconds have passed, or when MaxInterval seconds have passed.  Reportable attributes without one are due on every call.
+      The configuration is set by the coordinator's Configure Reporting command (ZCL_CONFIGURE_REPORTING()) or by SetZCL_REPORTING(), and kept in RAM.
+    */
+    void SetZCL_REPORTING(uint16_t ClusterID, uint16_t AttrID, uint16_t MinInterval, uint16_t MaxInterval, uint32_t Change = 0);
+    boolean ZCL_CONFIGURE_REPORTING();
+    uint8_t ZCL_DUE(uint32_t Now);
+
+    /*
+      Store and Forward
+      Readings that could not be delivered are queued in EEPROM by LOG_APPEND() and sent in batches by LOG_DRAIN() once the link is back:
+        mycc2530.LOG_BEGIN();                                    // setup(), finds the queue left by the last run
+        if (mycc2530.AF_DATA_CONFIRM_WAIT(500) == CC2530::AF_CONFIRMED)
+          mycc2530.LOG_DRAIN(0xFC00, Clock);                     // loop()
+        else
+          mycc2530.LOG_APPEND(Clock, Reading);
+      The log is a ring of records written in turn, so every cell is rewritten once per pass and no fixed cell holds the head or tail.  Each drained frame (AF_DATA_REQUEST payload) is: Now (4 bytes), Count, then Count records of Time (4 bytes) and CC2530_LOG_DATA bytes of reading, all little endian.  The receiver dates a record by Now - Time, so the timestamps only need a clock that runs while the device is up, e.g. seconds slept.
+    */
+    uint16_t LOG_BEGIN(uint16_t Start = 0, uint16_t Size = 1024);
+    boolean LOG_APPEND(uint32_t Time, const void *Data);
+    uint16_t LOG_COUNT();
+    uint16_t LOG_DRAIN(uint16_t ClusterID, uint32_t Now, unsigned long Timeout = 1000);
+
+    /*
+      Adaptive TX Power
+      The E18-MS1 forgets SYS_SET_TX_POWER on every reset, so TX_POWER_BEGIN() is called after POWER_UP().  It sends the level the last run settled on, kept in 2 bytes of EEPROM at Addr (Max the first time), and from then on AF_DATA_CONFIRM_WAIT() adjusts it between Min and Max dBm:
+        mycc2530.LOG_BEGIN(0, 1022);                             // setup(), leaves the last 2 bytes of EEPROM
+        mycc2530.POWER_UP();
+        mycc2530.TX_POWER_BEGIN(1022, -10, 4);
+      The link margin is the LinkQuality of the AF_INCOMING_MSGs received (averaged over about 8 frames) less about 3 per dB the level is below Max, i.e. what the parent would see of our frames if it sends at Max.  The level only steps down while that stays at least Lqi after the step.  A device that receives no AF_INCOMING_MSG, like a sleeping end device with polling off, steps down on its confirms alone, since each one means the parent acknowledged the frame.  Every failure doubles the confirms needed for the next step down (up to 128).  A level that has held for CC2530_TX_POWER_SETTLE confirms in a row is written to EEPROM and halves them again, back to CC2530_TX_POWER_HOLD.  SetTX_POWER() is overridden.
+    */
+    int8_t TX_POWER_BEGIN(uint16_t Addr, int8_t Min = -22, int8_t Max = 4, uint8_t Lqi = 96);
+    int8_t TX_POWER();
+    uint8_t TX_POWER_LQI();
+
+    /*
+      Frame Views
+      Read the fields of a received frame (Len, Cmd0, Cmd1, Data) where it lies: the Frame passed to a handler, PEEK_FRAME() or ReceivedBytes.  A view only holds a pointer to the frame, so it is valid as long as the frame is and nothing is copied:
+        CC2530::AfIncomingMsg Msg(Frame);
+        if (Msg && Msg.ClusterId() == 0x0006)
+          digitalWrite(LED, Msg.Payload().Data[2]);
+      A view of a frame with another command, or too short for its fields, is false and all its fields read 0.  Payload() is then empty, otherwise it never reaches past the end of the frame.  Payload() is a Segment, so it can be sent on with AF_DATA_REQUEST_SG().
+    */
+    class FrameView
+    {
+      public:
+        explicit operator bool() const { return _Frame != 0; }
+
+      protected:
+        FrameView(const uint8_t *Frame, uint8_t Cmd0, uint8_t Cmd1, uint8_t MinLen) : _Frame(Frame != 0 && Frame[1] == Cmd0 && Frame[2] == Cmd1 && Frame[0] >= MinLen ? Frame : 0) {}
+        uint8_t _U8(uint8_t i) const { return _Frame ? _Frame[i] : 0; }
+        uint16_t _U16(uint8_t i) const { return _Frame ? _Frame[i] | _Frame[i + 1] << 8 : 0; } // Little endian
+        const uint8_t *_PTR(uint8_t i) const { return _Frame ? &_Frame[i] : 0; }
+
+        const uint8_t *_Frame; // 0 when the frame did not match
+    };
+
+    // AF_INCOMING_MSG (0x4481): GroupId, ClusterId, SrcAddr, SrcEndpoint, DstEndpoint, WasBroadcast, LinkQuality, SecurityUse, Timestamp, TransSeqNumber, Len, Data
+    class AfIncomingMsg : public FrameView
+    {
+      public:
+        AfIncomingMsg(const uint8_t *Frame) : FrameView(Frame, 0x44, 0x81, 17)
+        {
+          if (_Frame && _Frame[19] > _Frame[0] - 17)                   // Len claims more Data than the frame holds
+          {
+            _Frame = 0;
+          }
+        }
+        uint16_t GroupId() const { return _U16(3); }
+        uint16_t ClusterId() const { return _U16(5); }
+        uint16_t SrcAddr() const { return _U16(7); }
+        uint8_t SrcEndpoint() const { return _U8(9); }
+        uint8_t DstEndpoint() const { return _U8(10); }
+        uint8_t WasBroadcast() const { return _U8(11); }
+        uint8_t LinkQuality() const { return _U8(12); }
+        uint8_t SecurityUse() const { return _U8(13); }
+        uint32_t Timestamp() const { return _U16(14) | (uint32_t) _U16(16) << 16; }
+        uint8_t TransSeqNumber() const { return _U8(18); }
+        Segment Payload() const { Segment Data = {_PTR(20), _U8(19), false}; return Data; }
+    };
+
+    // AF_DATA_CONFIRM (0x4480): Status, Endpoint, TransId
+    class AfDataConfirm : public FrameView
+    {
+      public:
+        AfDataConfirm(const uint8_t *Frame) : FrameView(Frame, 0x44, 0x80, 3) {}
+        uint8_t Status() const { return _U8(3); }
+        uint8_t Endpoint() const { return _U8(4); }
+        uint8_t TransId() const { return _U8(5); }
+    };
+
+    // ZDO_STATE_CHANGE_IND (0x45C0): State, 0x06 end device, 0x07 router, 0x09 coordinator
+    class ZdoStateChangeInd : public FrameView
+    {
+      public:
+        ZdoStateChangeInd(const uint8_t *Frame) : FrameView(Frame, 0x45, 0xC0, 1) {}
+        uint8_t State() const { return _U8(3); }
+    };
+
+    // ZDO_END_DEVICE_ANNCE_IND (0x45C1): SrcAddr, NwkAddr, IEEEAddr (8 bytes, least significant first), Capabilities
+    class ZdoEndDeviceAnnceInd : public FrameView
+    {
+      public:
+        ZdoEndDeviceAnnceInd(const uint8_t *Frame) : FrameView(Frame, 0x45, 0xC1, 13) {}
+        uint16_t SrcAddr() const { return _U16(3); }
+        uint16_t NwkAddr() const { return _U16(5); }
+        const uint8_t *IEEEAddr() const { return _PTR(7); }
+        uint8_t Capabilities() const { return _U8(15); }
+    };
+
+    // ZDO_LEAVE_IND (0x45C9): SrcAddr, ExtAddr (8 bytes, least significant first), Request, Remove, Rejoin
+    class ZdoLeaveInd : public FrameView
+    {
+      public:
+        ZdoLeaveInd(const uint8_t *Frame) : FrameView(Frame, 0x45, 0xC9, 13) {}
+        uint16_t SrcAddr() const { return _U16(3); }
+        const uint8_t *ExtAddr() const { return _PTR(5); }
+        uint8_t Request() const { return _U8(13); }
+        uint8_t Remove() const { return _U8(14); }
+        uint8_t Rejoin() const { return _U8(15); }
+    };
+
+    // ZDO_MGMT_NWK_UPDATE_NOTIFY (0x45B8): SrcAddr, Status, ScannedChannels (bit n for channel n), TotalTransmissions, TransmissionFailures, ListCount, EnergyValues (one per scanned channel, lowest channel first)
+    class ZdoMgmtNwkUpdateNotify : public FrameView
+    {
+      public:
+        ZdoMgmtNwkUpdateNotify(const uint8_t *Frame) : FrameView(Frame, 0x45, 0xB8, 12)
+        {
+          if (_Frame && _Frame[14] > _Frame[0] - 12)                   // ListCount claims more values than the frame holds
+          {
+            _Frame = 0;
+          }
+        }
+        uint16_t SrcAddr() const { return _U16(3); }
+        uint8_t Status() const { return _U8(5); }
+        uint32_t ScannedChannels() const { return _U16(6) | (uint32_t) _U16(8) << 16; }
+        uint16_t TotalTransmissions() const { return _U16(10); }
+        uint16_t TransmissionFailures() const { return _U16(12); }
+        Segment EnergyValues() const { Segment Data = {_PTR(15), _U8(14), false}; return Data; }
+    };
 
     /*
       COPY_PAYLOAD
-      Copies the payload from the AF_INCOMING_MSG to a variable
+      Copies the payload from the AF_INCOMING_MSG in ReceivedBytes to a variable, at most sizeof(Value) bytes.  Returns the number of bytes copied, 0 if ReceivedBytes is not an AF_INCOMING_MSG.
     */
     template <typename T> unsigned int COPY_PAYLOAD (T& Value)
     {
-      uint8_t *p;
-      p = ReceivedBytes;
-      memcpy(&Value, p + 20, ReceivedBytes[19]); // AFDataIncoming Data payload always starts at byte 20 in recieve buffer "ReceivedBytes"
+      Segment Payload = AfIncomingMsg(ReceivedBytes).Payload();
+      uint8_t Len = Payload.Len < sizeof(T) ? Payload.Len : sizeof(T);
+      if (Len > 0)
+      {
+        memcpy(&Value, Payload.Data, Len);
+      }
+      return Len;
     }
 
+    protected:
+
+#if defined(ARDUINO_ARCH_AVR)
+    typedef decltype(&PINB) PinRegister; // volatile uint8_t * on the AVR core
+    CC2530(uint8_t PIN_EN, uint8_t PIN_SRDY, uint8_t PIN_RES, uint8_t PIN_SS_MRDY, PinRegister SrdyIn, uint8_t SrdyMask, PinRegister MrdyOut, uint8_t MrdyMask);
+#endif
+
     private:
 
+    /*
+      SRDY and MRDY
+      The handshake reads the SRDY input register and sets the MRDY output latch directly through port registers and bit masks resolved when the class is constructed.  digitalRead() and digitalWrite() look the pin up in the core's flash tables on every call, several microseconds on the Atmega328P.
+    */
+    inline boolean _SRDY_HIGH()
+    {
+#if defined(ARDUINO_ARCH_AVR)
+      return (*_SrdyIn & _SrdyMask) != 0;
+#else
+      return digitalRead(_SRDY) == HIGH;
+#endif
+    }
+
+    inline void _MRDY(uint8_t Level)
+    {
+#if defined(ARDUINO_ARCH_AVR)
+      uint8_t Sreg = SREG;
+      cli(); // Read-modify-write of the port, an ISR may write other pins of the same port
+      if (Level)
+      {
+        *_MrdyOut |= _MrdyMask;
+      }
+      else
+      {
+        *_MrdyOut &= ~_MrdyMask;
+      }
+      SREG = Sreg;
+#else
+      digitalWrite(_SS_MRDY, Level);
+#endif
+    }
+
+    /*
+      The transport as seen by the frame layer: an AREQ is waiting to be received (SRDY low, or UART bytes waiting), or the SRSP of the pending request can be read (SRDY high after the SREQ, or an SRSP received by the UART).  An AREQ sent as a request (Cmd0 type 0x40) has no SRSP.
+    */
+    inline boolean _AREQ_WAITING()
+    {
+#if CC2530_UART
+      if (_Uart)
+      {
+        return _Uart->available() > 0;
+      }
+#endif
+      return !_SRDY_HIGH();
+    }
+
+    inline boolean _SRSP_READY()
+    {
+#if CC2530_UART
+      if (_Uart)
+      {
+        return (_SreqCmd0 & 0xE0) == 0x40 || _UART_RECEIVE();
+      }
+#endif
+      return _SRDY_HIGH();
+    }
+
+    void _PINS(uint8_t PIN_EN, uint8_t PIN_SRDY, uint8_t PIN_RES, uint8_t PIN_SS_MRDY);
+    void _POLL();
+    FrameHandler _HANDLER(const uint8_t *Frame);
+    void _SCAN_NOTIFY(const uint8_t *Frame);
+    boolean _SREQ_SELECT(uint8_t Cmd0, uint8_t Cmd1);
+    boolean _NV_MATCHES(const uint8_t *Frame, const uint8_t *Data);
+    uint8_t _SREQ_SENT(uint8_t Cmd0, uint8_t Cmd1);
+    void _SREQ_END(uint8_t Result);
+    void _WRITE(const uint8_t *Buf, uint8_t Len);
+    void _WRITE_P(const uint8_t *Buf, uint8_t Len);
+    void _SPI_READ(uint8_t *Buf, uint8_t Len);
+    void _WRITE_SG(const Segment *Segments, uint8_t Count);
+    uint8_t _AF_DATA_REQUEST_END(uint8_t Cmd1);
+    void _AF_CONFIRM(uint8_t Status, uint8_t TransID);
+    void _TX_POWER_ADAPT();
+    void _TX_POWER_STORE(int8_t Level);
+    boolean _AF_DATA_REQUEST_START(uint8_t ShortAddr0, uint8_t ShortAddr1, uint8_t DesEP, uint8_t SourceEP, uint8_t ClusterID0, uint8_t ClusterID1, uint8_t Length);
+    boolean _ZCL_ENTRY(uint8_t Index, ZclAttribute &Attr);
+    uint8_t _ZCL_FIND(uint16_t ClusterID, uint16_t AttrID, ZclAttribute &Attr);
+    uint8_t _ZCL_CONFIGURE(uint8_t Index, const ZclAttribute &Attr, uint16_t MinInterval, uint16_t MaxInterval, uint32_t Change);
+    uint32_t _ZCL_VALUE(const ZclAttribute &Attr);
+    static uint8_t _ZCL_ANALOG_SIZE(uint8_t DataType);
+    static boolean _ZCL_CHANGED_BY(uint8_t DataType, uint32_t Value, uint32_t Last, uint32_t Change);
+    void _ZCL_WRITE_RECORD(const ZclAttribute &Attr);
+    static uint16_t _SG_LENGTH(const Segment *Segments, uint8_t Count);
+    static uint8_t _SG_BYTE(const Segment *Segments, uint8_t i);
+    uint8_t *_RX_PUSH(uint8_t Size);
+    void _RX_REQUEUE();
+    void _RX_FRAME(const uint8_t *Frame);
+    boolean _UART_RECEIVE();
+    void _UART_FRAME(boolean FcsOk);
+    void _RX_SKIP_WRAP();
+    void _PRINT_FRAME(const uint8_t *Frame);
+    void _SLEEP(boolean Deep);
+    uint8_t _WAIT_RESET_IND();
+    void _LOG_READ(uint16_t Slot, uint8_t Offset, void *Buf, uint8_t Len);
+    void _LOG_WRITE(uint16_t Slot, uint8_t Offset, const void *Buf, uint8_t Len);
+    uint16_t _LOG_PREV(uint16_t Slot);
+    void _TRACE(uint8_t Type, uint8_t Cmd0, uint8_t Cmd1, uint8_t Len, uint8_t Status, unsigned long Since);
+    void _DEVICE_FRAME(const uint8_t *Frame);
+    void _DEVICE_ANNOUNCE(uint16_t ShortAddr, const uint8_t IEEEAddr[8]);
+    uint8_t _DEVICE_FIND(uint16_t ShortAddr);
+    uint8_t _DEVICE_FIND_IEEE(const uint8_t IEEEAddr[8]);
+    uint8_t _DEVICE_ADD(uint16_t ShortAddr);
+    void _DEVICE_REMOVE(uint8_t Entry);
+    void _DEVICE_INDEX(uint8_t Entry, boolean IEEE);
+    void _DEVICE_UNINDEX(uint8_t Entry, boolean IEEE);
+    uint8_t _DEVICE_HASH(uint8_t Entry, boolean IEEE);
+    static uint16_t _CRC16(const uint8_t *Data, uint8_t Len, uint16_t Crc = 0xFFFF);
+    static uint8_t _HASH_SHORT(uint16_t ShortAddr);
+    static uint8_t _HASH_IEEE(const uint8_t IEEEAddr[8]);
+    static boolean _IEEE_KNOWN(const uint8_t IEEEAddr[8]);
+
     uint8_t _EN;
     uint8_t _SRDY;
     uint8_t _RES;
@@ -236,35 +773,224 @@
     uint8_t _MOSI;
     uint8_t _MISO;
     uint8_t _SCK;
+#if defined(ARDUINO_ARCH_AVR)
+    PinRegister _SrdyIn;
+    PinRegister _MrdyOut;
+    uint8_t _SrdyMask;
+    uint8_t _MrdyMask;
+#endif
+
+    boolean _SrdyInterrupt = false;
+    uint8_t _SleepMode = 0; // SLEEP_MODE_IDLE
+    static volatile boolean _SrdyEvent; // Set by SRDY_ISR() on every SRDY edge
+    uint32_t _SpiClock = 2000000; // SPI bit rate, the CC2530 SPI slave supports up to 4 MHz
+    uint16_t _SreqTimeout = 2000; // Milliseconds to wait for SRDY before giving up on a request
+    uint16_t _ResetTimeout = 5000; // Milliseconds to wait for SYS_RESET_IND after a reset
+    ResetInd _ResetInd = {0xFF, 0, 0, 0, 0, 0}; // Last SYS_RESET_IND, Reason 0xFF if none since the last reset
+    uint8_t _SreqHandle = 0;
+    uint8_t _SreqResult = SREQ_NONE;
+    uint8_t _SreqStatus = 0xFF;
+    uint8_t _SreqCmd0 = 0;
+    uint8_t _SreqCmd1 = 0;
+    unsigned long _SreqStart = 0;
+
+    uint8_t _Ring[CC2530_RX_RING_SIZE]; // AREQ frames: Len, Cmd0, Cmd1, Data.  A Len of 0xFF marks unused space before the ring wraps.
+    uint8_t _RxHead = 0;
+    uint8_t _RxTail = 0;
+    uint8_t _RxUsed = 0;
+    uint8_t _RxCount = 0;
+    uint8_t _RxHighWater = 0;
+    uint16_t _RxReceived = 0;
+    uint16_t _RxDropped = 0;
+    uint16_t _RxOverruns = 0;
+    uint16_t _GatewaySkipped = 0; // Frames GATEWAY_WRITE() discarded
+    uint16_t _RxUnhandled = 0; // Frames DISPATCH() discarded
+
+#if CC2530_UART
+    Stream *_Uart = 0; // UART transport, 0 for SPI
+    uint8_t _UartFrame[NumBytes]; // Frame being received: Len, Cmd0, Cmd1, Data.  Only the first NumBytes bytes of a longer frame are kept.
+    uint16_t _UartPos = 0; // Bytes of the frame received since its SOF, 0 while waiting for a SOF
+    uint8_t _UartRxFcs = 0;
+    uint8_t _UartTxFcs = 0;
+    uint8_t _UartSrsp = 0; // SRSP of the pending request in ReceivedBytes: 1, or 2 if it was truncated
+    uint16_t _RxErrors = 0;
+#endif
+
+    uint8_t _ZdoState = 0x00; // From the last ZDO_STATE_CHANGE_IND
+
+    template <uint8_t... Bytes> struct _Bytes
+    {
+      static const uint8_t Frame[sizeof...(Bytes)];
+    };
+    template <typename Frame, uint16_t... ClusterIDs> struct _List;
+    template <typename Frame, uint16_t... ClusterIDs> struct _Pairs;
+
+    struct AreqHandler
+    {
+      uint16_t Cmd; // cmd_conv(Cmd0, Cmd1), 0x0000 for every other frame
+      FrameHandler Handler;
+    };
+
+    struct AfHandler
+    {
+      uint8_t EndPoint;
+      uint16_t ClusterID;
+      FrameHandler Handler;
+    };
+
+    AreqHandler _Handlers[CC2530_HANDLERS];
+    uint8_t _HandlerCount = 0;
+    AfHandler _AfHandlers[CC2530_AF_HANDLERS];
+    uint8_t _AfHandlerCount = 0;
+    boolean _Dispatching = false; // A handler is running: POLL() from a handler only receives
+    boolean _DispatchDiscard = false; // DISPATCH() removes frames without a handler
+
+    uint8_t *_ScanEnergy = 0; // Energy[] of the ENERGY_SCAN() waiting for its ZDO_MGMT_NWK_UPDATE_NOTIFY
+
+    uint8_t _AfTransID = 0; // TransID of the last AF_DATA_REQUEST
+    uint8_t _AfPending[CC2530_AF_PENDING]; // TransIDs waiting for their AF_DATA_CONFIRM, oldest first
+    uint8_t _AfInFlight = 0;
+    uint8_t _AfResult = AF_CONFIRMED; // Worst AfConfirm since AF_DATA_CONFIRM_WAIT() last returned
+
+    const ZclAttribute *_ZclTable = 0; // In flash
+    uint8_t _ZclCount = 0;
+    uint8_t _ZclSeq = 0; // ZCL transaction sequence number of the next frame the library sends
+    uint8_t _ZclDirty[(CC2530_ZCL_ATTRIBUTES + 7) / 8] = {0};
+    uint8_t _ZclRead[(CC2530_ZCL_ATTRIBUTES + 7) / 8] = {0}; // Attributes answered by ZCL_READ_ATTRIBUTES()
+
+    struct ZclReporting
+    {
+      uint8_t Index = 0xFF; // Attribute in the table, 0xFF for a free entry
+      uint16_t MinInterval; // Seconds
+      uint16_t MaxInterval; // Seconds, 0 to report on change only, 0xFFFF not reported
+      uint32_t Change; // Reportable change, 0 for any change
+      uint32_t Last; // Value last reported, sign extended
+      uint32_t Since; // ZCL_DUE() time of the last report
+    };
+    ZclReporting _ZclReporting[CC2530_ZCL_REPORTING];
+    uint32_t _ZclNow = 0; // Time passed to the last ZCL_DUE()
+    ZclReporting *_ZCL_REPORTING(uint8_t Index);
+
+    /*
+      Store and Forward Log
+      Status is LOG_QUEUED when a record is appended.  Only the newest record of a delivered batch is marked LOG_SENT: the queue is the run of consecutive queued records that ends at the newest one.
+    */
+    enum LogStatus
+    {
+      LOG_SENT = 0x00,
+      LOG_QUEUED = 0x01,
+      LOG_ERASED = 0xFF
+    };
+
+    struct LogRecord
+    {
+      uint16_t Seq;
+      uint8_t Status;
+      uint32_t Time;
+      uint8_t Data[CC2530_LOG_DATA];
+    };
+
+    uint16_t _LogStart = 0; // EEPROM address of slot 0
+    uint16_t _LogSlots = 0; // 0 until LOG_BEGIN()
+    uint16_t _LogHead = 0; // Slot the next record is written to
+    uint16_t _LogCount = 0; // Queued records, ending at the slot before _LogHead
+    uint16_t _LogSeq = 0; // Seq of the next record
 
-    uint8_t _SYS_Reset[4] = {0x01, 0x41, 0x00, 0x00};
-    uint8_t _TXPower[4] = {0x01, 0x21, 0x14, 0x04}; // Default 4dBm
-    uint8_t _NVStartUpKeep[6] = {0x03, 0x26, 0x05, 0x03, 0x01, 0x00}; // Keeps device specific and network parameters stored in non-volitile (NV) memory
-    uint8_t _NVStartUpClear[6] = {0x03, 0x26, 0x05, 0x03, 0x01, 0x03}; // Clears device specific and network parameters stored in non-volitile (NV) memory
-    uint8_t _PanID[7] = {0x04, 0x26, 0x05, 0x83, 0x02, 0xA1, 0x00}; // Default 0x00A1 PanId
-    uint8_t _Channel[9] = {0x06, 0x26, 0x05, 0x84, 0x04, 0x00, 0x08, 0x00, 0x00}; // Default Channel 11
-    uint8_t _LogicalType[6] = {0x03, 0x26, 0x05, 0x87, 0x01, 0x00}; // Default 0x00 Coordinator
-    uint8_t _CallBack[6] = {0x03, 0x26, 0x05, 0x8F, 0x01, 0x01}; // Default 0x01 True
-    uint8_t _PollRate[7] = {0x04, 0x26, 0x05, 0x35, 0x02, 0xD0, 0x07}; // Default 2000 milliseconds
-    uint8_t _QueuedPollRate[7] = {0x04, 0x26, 0x05, 0x25, 0x02, 0x64, 0x00}; // Default 100 milliseconds
-    uint8_t _ResponsePollRate[7] = {0x04, 0x26, 0x05, 0x26, 0x02, 0x64, 0x00}; // Default 100 milliseconds
-    uint8_t _RejoinPollRate[7] = {0x04, 0x26, 0x05, 0x27, 0x02, 0xB8, 0x01}; // Default 440 milliseconds, required for End device join using TC Link Key, mandatory packets when joining network
-    uint8_t _PollFailRetries[6] = {0x03, 0x26, 0x05, 0x29, 0x01, 0xFF}; // Default 0xFF 255 Retries
-    uint8_t _PreCFGKeyEnable[6] = {0x03, 0x26, 0x05, 0x63, 0x01, 0x01}; // Default 0x01 True
-    uint8_t _PreCFGKey[21] = {0x12, 0x26, 0x05, 0x62, 0x10, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}; // Default 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04
-    uint8_t _AFDataReqCfg[7] = {0x01, 0x01, 0xB0, 0xFE, 0x01, 0x00, 0x04};
-    uint8_t _AFDataReqExtCfg[9] = {0x01, _PanID[5], _PanID[6], 0x01, 0xB0, 0xFE, 0x01, 0x00, 0x04};
-    uint8_t _ZDOStartUpFromApp[5] = {0x02, 0x25, 0x40, 0x00, 0x00};
-    uint8_t _GPIOSetDir[6] = {0x02, 0x21, 0x0E, 0x00, 0x0F}; // Default 0x0F All GPIO's
-    uint8_t _GPIOSetInput[6] = {0x02, 0x21, 0x0E, 0x01, 0x0F}; // Default 0x0F All GPIO's
-    uint8_t _GPIOSet[6] = {0x02, 0x21, 0x0E, 0x02, 0x0F}; // Default 0x0F All GPIO's
-    uint8_t _GPIOClear[6] = {0x02, 0x21, 0x0E, 0x03, 0x0F}; // Default 0x0F All GPIO's
-    uint8_t _GPIORead[6] = {0x02, 0x21, 0x0E, 0x05, 0x0F}; // Default 0x0F All GPIO's
-    uint8_t _NodeDesc[7] = {0x04, 0x25, 0x02, 0x00, 0x00, 0x00, 0x00};
-    uint8_t _ZBGetShortAddr[4] = {0x01, 0x26, 0x06, 0x02};
-    uint8_t _ZBGetIEEEAddr[4] = {0x01, 0x26, 0x06, 0x01};
-    uint8_t _PermitJoinTrue[7] = {0x04, 0x25, 0x36, 0x00, 0x00, 0xFF, 0x00};
-    uint8_t _PermitJoinFalse[7] = {0x04, 0x25, 0x36, 0x00, 0x00, 0x00, 0x00};
+    boolean _TxAdapt = false; // TX_POWER_BEGIN() has been called
+    int8_t _TxMin = 0;
+    int8_t _TxMax = 0;
+    uint8_t _TxLqi = 0; // Link margin required to step down
+    uint16_t _TxAddr = 0; // EEPROM address of the level and its complement
+    uint16_t _TxLqiAvg = 0; // 8 x average LinkQuality of the AF_INCOMING_MSGs, 0 before the first
+    uint8_t _TxGood = 0; // AF_DATA_CONFIRMs with status success in a row at the current level
+    uint8_t _TxHold = CC2530_TX_POWER_HOLD; // Confirms in a row before a step down, doubled by each failure and halved by each settle
+    int8_t _TxStored = 0; // Level in EEPROM
+    boolean _TxFailed = false; // A confirm failed or timed out since the last adjustment
+
+#if CC2530_DEVICES
+    Device _Devices[CC2530_DEVICES];
+    uint8_t _DevCount = 0;
+    uint8_t _DevByShort[CC2530_DEVICE_HASH] = {0}; // Linear probing hash of _Devices by ShortAddr: entry + 1, 0 for an empty slot
+    uint8_t _DevByIEEE[CC2530_DEVICE_HASH] = {0}; // By IEEEAddr, devices that have announced themselves
+#endif
+
+#if CC2530_TRACE
+    TraceEvent _Trace[CC2530_TRACE_SIZE];
+    uint8_t _TraceHead = 0;
+    uint8_t _TraceCount = 0;
+    unsigned long _TraceSreq = 0; // CC2530_TRACE_CLOCK() when the pending SREQ was sent
+#endif
+
+    /*
+      Configuration
+      The mutable fields of the commissioning and AF frames.  The constant part of every frame is kept in flash (PROGMEM) and streamed out with these fields by SREQ_P().
+    */
+    struct Config
+    {
+      uint8_t PanID[2] = {0xA1, 0x00}; // Default 0x00A1 PanId
+      uint8_t ChanList[4] = {0x00, 0x08, 0x00, 0x00}; // Default Channel 11
+      uint8_t LogicalType = 0x00; // Default 0x00 Coordinator
+      uint8_t ZdoDirectCb = 0x01; // Default 0x01 True
+      uint8_t PollRate[2] = {0xD0, 0x07}; // Default 2000 milliseconds
+      uint8_t QueuedPollRate[2] = {0x64, 0x00}; // Default 100 milliseconds
+      uint8_t ResponsePollRate[2] = {0x64, 0x00}; // Default 100 milliseconds
+      uint8_t RejoinPollRate[2] = {0xB8, 0x01}; // Default 440 milliseconds, required for End device join using TC Link Key, mandatory packets when joining network
+      uint8_t PollFailRetries = 0xFF; // Default 0xFF 255 Retries
+      uint8_t PreCfgKeyEnable = 0x01; // Default 0x01 True
+      uint8_t PreCfgKey[16] = {0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04};
+      uint8_t TxPower = 0x04; // Default 4dBm
+      uint8_t AFDataReq[7] = {0x01, 0x01, 0xB0, 0xFE, 0x01, 0x00, 0x04};
+      uint8_t AFDataReqExt[9] = {0x01, 0xA1, 0x00, 0x01, 0xB0, 0xFE, 0x01, 0x00, 0x04};
+    };
+    Config _Cfg;
+  };
+
+  /*
+    AF_REGISTER Endpoints
+    The frame is a pack of bytes built by the compiler: _List appends the number of clusters, then _Pairs each cluster ID, low byte first.
+  */
+  template <uint8_t... Bytes> const uint8_t CC2530::_Bytes<Bytes...>::Frame[sizeof...(Bytes)] PROGMEM = {Bytes...};
+
+  template <uint8_t... Bytes, uint16_t... ClusterIDs>
+  struct CC2530::_List<CC2530::_Bytes<Bytes...>, ClusterIDs...> : _Pairs<_Bytes<Bytes..., sizeof...(ClusterIDs)>, ClusterIDs...> {};
+
+  template <uint8_t... Bytes>
+  struct CC2530::_Pairs<CC2530::_Bytes<Bytes...> >
+  {
+    typedef _Bytes<Bytes...> Type;
+  };
+
+  template <uint8_t... Bytes, uint16_t ClusterID, uint16_t... More>
+  struct CC2530::_Pairs<CC2530::_Bytes<Bytes...>, ClusterID, More...> : _Pairs<_Bytes<Bytes..., (uint8_t) ClusterID, (uint8_t) (ClusterID >> 8)>, More...> {};
+
+  template <uint8_t EndPoint, uint16_t ProfileID, uint16_t DeviceID, uint16_t... In, uint16_t... Out, uint8_t DeviceVer>
+  struct CC2530::AfEndpoint<EndPoint, ProfileID, DeviceID, CC2530::Clusters<In...>, CC2530::Clusters<Out...>, DeviceVer>
+    : _List<typename _List<_Bytes<9 + 2 * sizeof...(In) + 2 * sizeof...(Out), 0x24, 0x00, EndPoint, (uint8_t) ProfileID, (uint8_t) (ProfileID >> 8), (uint8_t) DeviceID, (uint8_t) (DeviceID >> 8), DeviceVer, 0x00>, In...>::Type, Out...>::Type // Len, Cmd0, Cmd1, AppEndPoint, AppProfileID, DeviceID, DeviceVer, LatencyReq, then the cluster lists
+  {
+    static_assert(sizeof...(In) <= 16 && sizeof...(Out) <= 16, "AfEndpoint: Z-Stack registers up to 16 input and 16 output clusters");
   };
 
+#if defined(__AVR_ATmega328P__)
+  /*
+    Class
+    CC2530T
+    Description: CC2530 with the EN, SRDY, RES and SS/MRDY pins fixed at compile time, e.g. CC2530T<7, 8, 9, 10> mycc2530;
+    The SRDY and MRDY port registers and bit masks are resolved by the compiler from the Atmega328P pin map (D0-D7 PORTD, D8-D13 PORTB, A0-A5 PORTC) instead of the core's pin tables, and pins outside the map fail to compile.  Use CC2530 when the pins are only known at run time.
+  */
+  template <uint8_t PIN_EN, uint8_t PIN_SRDY, uint8_t PIN_RES, uint8_t PIN_SS_MRDY>
+  class CC2530T : public CC2530
+  {
+    static_assert(PIN_SRDY <= 19 && PIN_SS_MRDY <= 19, "CC2530T: SRDY and SS/MRDY must be pins D0 to D19 (A5)");
+    static_assert(PIN_SRDY != PIN_SS_MRDY, "CC2530T: SRDY and SS/MRDY must be different pins");
+
+    public:
+    CC2530T() : CC2530(PIN_EN, PIN_SRDY, PIN_RES, PIN_SS_MRDY, _IN(PIN_SRDY), _MASK(PIN_SRDY), _OUT(PIN_SS_MRDY), _MASK(PIN_SS_MRDY)) {}
+
+    private:
+    static PinRegister _IN(uint8_t Pin) { return Pin <= 7 ? &PIND : (Pin <= 13 ? &PINB : &PINC); }
+    static PinRegister _OUT(uint8_t Pin) { return Pin <= 7 ? &PORTD : (Pin <= 13 ? &PORTB : &PORTC); }
+    static constexpr uint8_t _MASK(uint8_t Pin) { return 1 << (Pin <= 7 ? Pin : (Pin <= 13 ? Pin - 8 : Pin - 14)); }
+  };
+#endif
+
 #endif
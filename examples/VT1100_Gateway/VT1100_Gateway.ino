@@ -0,0 +1,58 @@
+/*
+  Board: VT1100MiniSPI
+  Example: Gateway
+  Description: Starts the CC2530 as a Coordinator and forwards every received message to the host as a binary record (see GATEWAY_WRITE in the library).  The stream shares Serial with the debug output, so set DEBUG to false in VT1100MiniSPI.h.  extras/host/GatewayDecoder.h decodes it on the host.
+*/
+
+#include <VT1100MiniSPI.h>
+#include <SPI.h>
+
+#define InitButton 2                                                  // Button on Digital Pin 2 (D2)
+#define CHANNELS 0x02108800                                           // Channels 11, 15, 20 and 25, clear of Wi-Fi channels 1, 6 and 11
+
+// Library Class Instance
+CC2530 myCC2530;                                                      // Make an instance of the class from the Library.  A short name for referring to variables and functions from the Libraries class.
+
+void setup()
+{
+  pinMode(InitButton, INPUT_PULLUP);                                  // Button to control if the CC2530 should be commissioned.
+
+  SPI.begin();
+  Serial.begin(500000);                                               // 500000 baud is exact on the 8 MHz Atmega328P (0% error), 115200 is not
+  delay(100);
+
+  // Parameters for CC2530
+  myCC2530.SetPANID(0x00A2);                                          // PAN ID.  Two bytes set between 0x0000 and 0x3FFF.  Examples: 0x00A1, 0x00A2 or 0x00A3.
+  myCC2530.SetLOGICAL_TYPE(0x00);                                     // Device type.  Examples: Coordinator = 0x00, Roouter = 0x01 or End Device = 0x02
+  myCC2530.SetCHANLIST_MASK(CHANNELS);                                // The network is formed on one of these channels
+
+  myCC2530.POWER_UP();                                                // Power up the CC2530 (wake on reset).
+
+  if (digitalRead(InitButton) == LOW)
+  {
+    myCC2530.COMMISSION();                                            // Clears the configuration and network state then writes the new configuration parameters to the CC2530 non-volitile (NV) memory.  This should only be run once on initial setup.
+    myCC2530.AF_REGISTER(0x01);
+    myCC2530.ZDO_STARTUP_FROM_APP();                                  // Forms the network
+
+    uint8_t Energy[16];
+    uint8_t Channel = myCC2530.ENERGY_SCAN(CHANNELS, Energy);         // Energy detected on each allowed channel, about 0.6 seconds
+    if (Channel)
+    {
+      myCC2530.SetCHANLIST(Channel);                                  // Stay on the quietest channel
+      myCC2530.COMMISSION_UPDATE();                                   // Commissions again when the channel list changed
+    }
+  }
+
+  myCC2530.AF_REGISTER(0x01);                                         // Register Endpoint
+  myCC2530.ZDO_STARTUP_FROM_APP();                                    // Starts the CC2530 in the network
+}
+
+void loop()
+{
+  myCC2530.POLL();                                                    // Need to constantly POLL the CC2530 to see if it has any queued data to send to the application processor
+
+  while (myCC2530.RX_AVAILABLE())
+  {
+    myCC2530.GATEWAY_WRITE(Serial);                                   // One record per AF_INCOMING_MSG, other frames are counted by GATEWAY_SKIPPED()
+  }
+}
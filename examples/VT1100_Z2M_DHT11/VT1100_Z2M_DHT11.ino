@@ -53,25 +53,69 @@ static uint8_t sleepcount = 8;                                  // Watchdog time
 unsigned long time_now = 0;
 
 /* ------------------------------------------------------------------
-   Global Veriables
+   ZCL: Reported Attribute Values
    ------------------------------------------------------------------
 */
-uint8_t seqCount = 0;                                                 // Used for keeping track of message transaction sequences
-uint8_t seqNumber = 0;                                                // Used to match read attribute requests to read attribute responses
+int16_t Temperature = 0;                                              // Temperature Measurement cluster MeasuredValue, 0.01 degC
+uint16_t Humidity = 0;                                                // Relative Humidity Measurement cluster MeasuredValue, 0.01 %
 
 /* ------------------------------------------------------------------
-   ZCL: Read Attribute Response Commands
+   Store and Forward
    ------------------------------------------------------------------
 */
-const uint8_t ModelIdentifier[] = {'V', 'T', '1', '1', '0', '0', 'D', 'H', 'T', '1', '1'};                               // Model Identifier: VT1100DHT11
-const uint8_t ManufacturerName[] = {'V', 'e', 'r', 't', 'o', 'r', 'i', 'x'};                                             // Manufacturer Name: Vertorix
-const uint8_t PowerSource = 3;                                                                                           // Power Source: 0 = Unknown, 1 = mains(single phase), 2 = mains(3 phase), 3 = battery, 4 = DC source.
-const uint8_t ApplicationVersion = 1;                                                                                    // Application Version
-const uint8_t ZCLVersion = 1;                                                                                            // ZCL version
-const uint8_t StackVersion = 2;                                                                                          // Stack version
-const uint8_t HWVersion = 1;                                                                                             // Hardware version
-const uint8_t Datecode[] = {'2', '0', '2', '1', '0', '2', '0', '3'};                                                     // Date Code
-const uint8_t SoftwareBuildID[] = {'1', '2', '0', '0', '-', '0', '0', '0', '1'};                                         // Software Build ID
+#define LOG_CLUSTER 0xFC00                                            // Manufacturer specific cluster the queued readings are sent on
+uint32_t Clock = 0;                                                   // Approximate seconds since power up, advanced by the time slept.  Timestamps the queued readings
+
+/* ------------------------------------------------------------------
+   ZCL: Basic Cluster Attributes
+   ------------------------------------------------------------------
+*/
+const uint8_t ModelIdentifier[] PROGMEM = {'V', 'T', '1', '1', '0', '0', 'D', 'H', 'T', '1', '1'};                       // Model Identifier: VT1100DHT11
+const uint8_t ManufacturerName[] PROGMEM = {'V', 'e', 'r', 't', 'o', 'r', 'i', 'x'};                                     // Manufacturer Name: Vertorix
+const uint8_t PowerSource PROGMEM = 3;                                                                                   // Power Source: 0 = Unknown, 1 = mains(single phase), 2 = mains(3 phase), 3 = battery, 4 = DC source.
+const uint8_t ApplicationVersion PROGMEM = 1;                                                                            // Application Version
+const uint8_t ZCLVersion PROGMEM = 1;                                                                                    // ZCL version
+const uint8_t StackVersion PROGMEM = 2;                                                                                  // Stack version
+const uint8_t HWVersion PROGMEM = 1;                                                                                     // Hardware version
+const uint8_t Datecode[] PROGMEM = {'2', '0', '2', '1', '0', '2', '0', '3'};                                             // Date Code
+const uint8_t SoftwareBuildID[] PROGMEM = {'1', '2', '0', '0', '-', '0', '0', '0', '1'};                                 // Software Build ID
+
+/* ------------------------------------------------------------------
+   ZCL: Attribute Table
+   ------------------------------------------------------------------
+*/
+const CC2530::ZclAttribute Attributes[] PROGMEM = {
+  {0x0402, 0x0000, 0x29, sizeof(Temperature), CC2530::ZCL_REPORTABLE, &Temperature},           // ClusterID, AttributeID, DataType (int16), Size, Flags, Value
+  {0x0405, 0x0000, 0x21, sizeof(Humidity), CC2530::ZCL_REPORTABLE, &Humidity},                 // DataType uint16
+  {0x0000, 0x0000, 0x20, sizeof(ZCLVersion), CC2530::ZCL_FLASH, &ZCLVersion},                  // Basic cluster, read by the coordinator when it interviews the device
+  {0x0000, 0x0001, 0x20, sizeof(ApplicationVersion), CC2530::ZCL_FLASH, &ApplicationVersion},  // DataType uint8
+  {0x0000, 0x0002, 0x20, sizeof(StackVersion), CC2530::ZCL_FLASH, &StackVersion},
+  {0x0000, 0x0003, 0x20, sizeof(HWVersion), CC2530::ZCL_FLASH, &HWVersion},
+  {0x0000, 0x0004, 0x42, sizeof(ManufacturerName), CC2530::ZCL_FLASH, ManufacturerName},       // DataType character string
+  {0x0000, 0x0005, 0x42, sizeof(ModelIdentifier), CC2530::ZCL_FLASH, ModelIdentifier},
+  {0x0000, 0x0006, 0x42, sizeof(Datecode), CC2530::ZCL_FLASH, Datecode},
+  {0x0000, 0x0007, 0x30, sizeof(PowerSource), CC2530::ZCL_FLASH, &PowerSource},                // DataType enum8
+  {0x0000, 0x4000, 0x42, sizeof(SoftwareBuildID), CC2530::ZCL_FLASH, SoftwareBuildID},
+};
+
+/* ------------------------------------------------------------------
+   ZCL: Endpoint
+   ------------------------------------------------------------------
+*/
+typedef CC2530::AfEndpoint<0x01, 0x0104, 0x0000, CC2530::Clusters<0x0000, 0x0402, 0x0405> > ZclEndpoint; // Endpoint 1, Home Automation profile, input clusters Basic, Temperature Measurement, Relative Humidity Measurement.  The AF_REGISTER frame is built at compile time and kept in flash
+
+/* ------------------------------------------------------------------
+   Handlers: called by POLL() for each received frame
+   ------------------------------------------------------------------
+*/
+void OnIncoming(CC2530 &Radio, const uint8_t *Frame)                  // AF_INCOMING_MSG
+{
+  Radio.LINK_QUALITY();                                               // Prints the Short Address and Link Quality from a received message.  The link quality is from the last Hop to the receiving device.
+  if (!Radio.ZCL_CONFIGURE_REPORTING())                               // Apply the reporting configuration the coordinator sends after the interview
+  {
+    Radio.ZCL_READ_ATTRIBUTES();                                      // Answer every attribute of a ZCL Read Attributes command in one response.  This is used in the interview process.
+  }
+}
 
 /********************************************************************
    Setup
@@ -91,6 +135,13 @@ void setup()
   mycc2530.SetPANID(0xffff);                                          // PAN ID.  Two bytes set between 0x0000 and 0x3FFF.  Examples: 0x00A1, 0x00A2 or 0x00A3.
   mycc2530.SetLOGICAL_TYPE(0x02);                                     // Device type.  Examples: Coordinator = 0x00, Router = 0x01 or End Device = 0x02
   mycc2530.SetCHANLIST(11);                                           // Wireless Channel. Examples: 11 to 26 or 0xFF All Channels
+  mycc2530.SetZCL_ATTRIBUTES(Attributes, sizeof(Attributes) / sizeof(Attributes[0])); // Attributes sent by ZCL_REPORT() and ZCL_READ_ATTRIBUTES()
+  mycc2530.SetZCL_REPORTING(0x0402, 0x0000, 0, 3600, 50);             // Report a Temperature change of 0.5 degC, or at least hourly.  The coordinator can change this with Configure Reporting
+  mycc2530.SetZCL_REPORTING(0x0405, 0x0000, 0, 3600, 100);            // Report a Humidity change of 1 %, or at least hourly
+  mycc2530.SetSRDY_INTERRUPT();                                       // Sleep while waiting for the CC2530 instead of polling SRDY.  See ISR(PCINT0_vect) below.
+  mycc2530.LOG_BEGIN(0, 1022);                                        // Store and forward log in EEPROM, readings queued before a restart are kept.  The last 2 bytes keep the TX power
+  mycc2530.ON_AREQ(0x4481, OnIncoming);                               // AF_INCOMING_MSG
+  mycc2530.SetDISPATCH_DISCARD();                                     // Every other frame is discarded by POLL()
 
   Init_CC2530();
 }
@@ -117,22 +168,34 @@ void loop()
     Send Data
     ------------------------------------------------------------------
   */
+  Temperature = DHT.temperature * 100;                                  // Update the reported attributes
+  Humidity = DHT.humidity * 100;
+  if (mycc2530.ZCL_DUE(Clock) == 0)                                     // No attribute has changed by its reportable change or is due for its hourly report
+  {
+    Serial.println("No report due, radio not used");
+    Sleep();
+    return;
+  }
   Poll(50);                                                             // Give time for power to stabalise before transmitting
-  ZCLFrame_ReportAttributes_Temp();                                     // Send Temperature ZCL report attribute
-  ZCLFrame_ReportAttributes_Humidity();                                 // Send Humidity ZCL report attribute
-  Poll(500);
+  mycc2530.SetAF_DATA_REQUEST(0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x30);  // Destination EP, Source EP, (ClusterID from the attribute table), (Trans ID assigned by the library), Options, Radius
+  mycc2530.ZCL_REPORT();                                                // Send one ZCL Report Attributes frame per cluster with changed attributes
   /* -----------------------------------------------------------------
     Sleep
     -----------------------------------------------------------------
   */
-  if (AF_DATA_CONFIRM())
+  uint8_t Confirm = mycc2530.AF_DATA_CONFIRM_WAIT(500);                 // Returns as soon as every report has its AF_DATA_CONFIRM, matched by Trans ID
+  mycc2530.POLL();                                                      // Answer the frames received meanwhile, e.g. a new reporting configuration
+  if (Confirm == CC2530::AF_CONFIRMED)
   {
     Serial.println("AF_DATA_CONFIRM True, Normal Sleep Time");
     sleepcount = 8;                                                     // Sleep for approximately 60sec
+    mycc2530.LOG_DRAIN(LOG_CLUSTER, Clock);                             // Send the readings queued while the parent was unreachable, several per frame
   }
   else
   {
     Serial.println("AF_DATA_CONFIRM False, Extended Sleep Time");
+    uint16_t Reading[2] = {(uint16_t) Temperature, Humidity};           // Queue the reading in EEPROM until the parent is reachable again
+    mycc2530.LOG_APPEND(Clock, Reading);
     sleepcount = 113;                                                   // Sleep for approximately 15min.  After 255 failed retries the CC2530 will try and rejoin which causes battery drain.  Increase the time before this mechanism is activated to ensure battery conservation.
   }
   Sleep();                                                              // Puts the Atmega328P to sleep.  The watchdog timer can sleep for max of 8 sec.  We need to loop this function every 8 seconds to continue sleeping e.g. 8*8=60sec or 8*15 = 120sec (8=sleep ~1 min or 15=sleep ~2 min)
@@ -150,36 +213,45 @@ void loop()
 */
 void Init_CC2530()
 {
-  mycc2530.POWER_UP();                                                // Power up the CC2530 (wake on reset).
-  SetTXPower();
-
   pinMode(Button, INPUT_PULLUP);
+  if (digitalRead(Button) == HIGH && mycc2530.WARM_START())           // The CC2530 is still in the network after a brown-out or watchdog restart of the Atmega328P, nothing to set up
+  {
+    mycc2530.TX_POWER_BEGIN(1022, -10, 4);                            // Except the TX power, the controller starts again from the level in EEPROM
+    return;
+  }
+
+  mycc2530.POWER_UP();                                                // Reset the CC2530 and wait until it has started (cold start).
+  mycc2530.TX_POWER_BEGIN(1022, -10, 4);                              // Start at the TX power the last run settled on, then step it down from 4dBm while reports are confirmed with margin and back up when one fails
+
   if (digitalRead(Button) == LOW)
   {
-    AF_REGISTER(0x01);                                                // Register Endpoint 1 ZCL
+    mycc2530.AF_REGISTER<ZclEndpoint>();                              // Register Endpoint 1 ZCL
     mycc2530.ZDO_STARTUP_FROM_APP();                                  // Starts the CC2530 in the network
     Poll(2000);
     LEAVE_REQ();
     Poll(2000);
 
     mycc2530.COMMISSION();                                            // Clears the configuration and network state then writes the new configuration parameters to the CC2530 non-volitile (NV) memory.  This should only be run once on initial setup.
-    AF_REGISTER(0x01);                                                // Register Endpoint 1 ZCL
+    mycc2530.AF_REGISTER<ZclEndpoint>();                              // Register Endpoint 1 ZCL
     mycc2530.ZDO_STARTUP_FROM_APP();                                  // Starts the CC2530 in the network
     Poll(5000);
-    AF_REGISTER(0x01);                                                // Register Endpoint 1 ZCL
+    mycc2530.AF_REGISTER<ZclEndpoint>();                              // Register Endpoint 1 ZCL
     mycc2530.ZDO_STARTUP_FROM_APP();                                  // Starts the CC2530 in the network
     Interview(30000);
   }
 
   if (digitalRead(Button) == HIGH)
   {
-    AF_REGISTER(0x01);
+    mycc2530.AF_REGISTER<ZclEndpoint>();
     mycc2530.ZDO_STARTUP_FROM_APP();                                    // Starts the CC2530 in the network
     Poll(5000);
   }
 
-  NVSetPollRate0sec();                                                  // Set the poll rate to 0 (polling turned off) for maximum power saving and to stop rejoining on loss of parent.
-  NVSetPollFailRetries();                                               // Set poll failure retries to 255 to ensure a rejoin isn't started on loss of parent device.  To reduce battery drain.
+  mycc2530.SetPOLL_RATE(0);                                           // Set the poll rate to 0 (polling turned off) for maximum power saving and to stop rejoining on loss of parent.
+  mycc2530.SetQUEUED_POLL_RATE(0);
+  mycc2530.SetRESPONSE_POLL_RATE(0);
+  mycc2530.SetPOLL_FAILURE_RETRIES(255);                              // Set poll failure retries to 255 to ensure a rejoin isn't started on loss of parent device.  To reduce battery drain.
+  mycc2530.COMMISSION_UPDATE(false);                                  // Writes only the NV items that differ, applied on the next reset.  Nothing is written once they are set.
 }
 
 /* ------------------------------------------------------------------
@@ -195,48 +267,12 @@ void LEAVE_REQ()
 }
 
 /* ------------------------------------------------------------------
-   Set Poll Rate 0sec Function
-   ------------------------------------------------------------------
-*/
-void NVSetPollRate0sec()
-{
-  uint8_t SetPollRate[] = {0x08, 0x21, 0x09, 0x35, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00}; // SYS_OSAL_NV_WRITE Set the poll rate 0sec
-  uint8_t SetQUEUED_POLL_RATE[] = {0x06, 0x21, 0x09, 0x25, 0x00, 0x00, 0x02, 0x00, 0x00}; // SYS_OSAL_NV_WRITE Set the queued poll rate 0sec
-  uint8_t SetRESPONSE_POLL_RATE[] = {0x06, 0x21, 0x09, 0x26, 0x00, 0x00, 0x02, 0x00, 0x00}; // SYS_OSAL_NV_WRITE Set the response poll rate 0sec
-
-  uint8_t ReadPollRate[] = {0x03, 0x21, 0x08, 0x35, 0x00, 0x00}; // SYS_OSAL_NV_READ
-
-  mycc2530.WRITE_DATA(SetPollRate);
-  mycc2530.WRITE_DATA(SetQUEUED_POLL_RATE);
-  mycc2530.WRITE_DATA(SetRESPONSE_POLL_RATE);
-  Serial.println("Poll Rate set to 0 sec, polling turned off");
-  mycc2530.WRITE_DATA(ReadPollRate);
-}
-
-/* ------------------------------------------------------------------
-   Set Poll Failure Retries Function
+   SRDY Interrupt
    ------------------------------------------------------------------
 */
-void NVSetPollFailRetries()
+ISR(PCINT0_vect)                                                      // SRDY is on D8 (PCINT0)
 {
-  uint8_t SetPollFailRetries[] = {0x05, 0x21, 0x09, 0x29, 0x00, 0x00, 0x01, 0xFF}; // SYS_OSAL_NV_WRITE Set poll failure retries to 255 before start rejoin scan/backoff process
-  uint8_t ReadPollFailRetries[] = {0x03, 0x21, 0x08, 0x29, 0x00, 0x00}; // SYS_OSAL_NV_READ
-
-  mycc2530.WRITE_DATA(SetPollFailRetries);
-  Serial.println("Poll failure retries set to 255");
-  mycc2530.WRITE_DATA(ReadPollFailRetries);
-}
-
-/* ------------------------------------------------------------------
-   Set TX Power Function
-   ------------------------------------------------------------------
-*/
-void SetTXPower()
-{
-  uint8_t TXPower[] = {0x01, 0x21, 0x14, 0x04};
-
-  mycc2530.WRITE_DATA(TXPower);
-  Serial.println("~~TX power set~~");
+  CC2530::SRDY_ISR();
 }
 
 /* ------------------------------------------------------------------
@@ -245,9 +281,11 @@ void SetTXPower()
 */
 void Poll(unsigned long WaitTime)
 {
+  unsigned long Elapsed;
   time_now = millis();
-  while (millis() - time_now < WaitTime)
+  while ((Elapsed = millis() - time_now) < WaitTime)
   {
+    mycc2530.WAIT_SRDY(WaitTime - Elapsed);                           // Sleeps until the CC2530 has data queued or the wait time is up
     mycc2530.POLL();
   }
 }
@@ -258,24 +296,16 @@ void Poll(unsigned long WaitTime)
 */
 void Interview(unsigned long WaitTime)
 {
+  unsigned long Elapsed;
   time_now = millis();
-  while (millis() - time_now < WaitTime)
+  mycc2530.SetAF_DATA_REQUEST(0x01, 0x01, 0x00, 0x00, 0x00, 0x10, 0x30);  // Options (APS ACK) and Radius of the responses sent by OnIncoming()
+  while ((Elapsed = millis() - time_now) < WaitTime)
   {
-    mycc2530.POLL();                                                  // Need to constantly Poll for data from the CC2530 to the application processor
-
-    if (mycc2530.AF_INCOMING_MSG())                                   // Function returns true if a AF_INCOMING_MSG is received
-    { // Process Incoming Messages in this block of code
-      mycc2530.LINK_QUALITY();                                        // Function prints the Short Address and Link Quality from a received message.  The link quality is from the last Hop to the receiving device.
-
-      uint8_t ClusterID[2];
-      ClusterID[0] = mycc2530.ReceivedBytes[5];
-      ClusterID[1] = mycc2530.ReceivedBytes[6];
-
-      if (ClusterID[0] == 0x00 && ClusterID[1] == 0x00)
-      {
-        ZCL_Interview();                                              // Send ZCL Read attributes response.  This is used in the interview process.
-      }
-      mycc2530.LINK_QUALITY();                                        // Function prints the Short Address and Link Quality from a received message.  The link quality is from the last Hop to the receiving device.
+    mycc2530.WAIT_SRDY(WaitTime - Elapsed);
+    mycc2530.POLL();                                                  // Need to constantly Poll for data from the CC2530 to the application processor, OnIncoming() answers the interview
+    if (mycc2530.ZCL_INTERVIEWED(0x0000) && WaitTime > Elapsed + 2000)
+    {
+      WaitTime = Elapsed + 2000;                                      // All Basic attributes have been read, allow a short time for the rest of the interview
     }
   }
 }
@@ -299,12 +329,14 @@ void Sleep()
   digitalWrite(6, LOW);
 
   pinMode(PIN_MISO, INPUT_PULLUP);                                      // Needs to be pulled HIGH during sleep.  CC2530 MISO pin needs to be pulled high to reduce sleep current.
+  mycc2530.SetSRDY_INTERRUPT(false);                                    // Only the watchdog wakes the long sleep
 
   Serial.println("~~SLEEP~~");
   delay(50);                                                            // Delay required to allow time to print "SLEEP" to serial monitor prior to sleeping
   for (int sleepCounter = sleepcount; sleepCounter > 0; sleepCounter--) // Enter power down state with ADC and BOD module disabled
   {
     LowPower.powerDown(SLEEP_8S, ADC_OFF, BOD_OFF);                     // Watchdog timer can only sleep maximum of 8 seconds, so loop this function
+    Clock += 8;
   }
 
   pinMode(2, INPUT);
@@ -318,253 +350,5 @@ void Sleep()
   Serial.println("~~WAKE~~");
   SPI.begin();
   delay(100);                                                           // Delay needed after SPI begin to ensure POLL command can use SPI
-}
-
-/* ------------------------------------------------------------------
-   Receive AF_DATA_CONFIRM
-   ------------------------------------------------------------------
-*/
-bool AF_DATA_CONFIRM()
-{
-  if (mycc2530.NEW_DATA())
-  {
-    uint8_t Cmd[2];
-    Cmd[0] = mycc2530.ReceivedBytes[1];
-    Cmd[1] = mycc2530.ReceivedBytes[2];
-
-    if (Cmd[0] == 0x44 && Cmd[1] == 0x80)
-    {
-      uint8_t Status = mycc2530.ReceivedBytes[3];
-      uint8_t Endpoint = mycc2530.ReceivedBytes[4];
-      uint8_t TransID = mycc2530.ReceivedBytes[5];
-
-      if (Status == 0)
-      {
-        return true;
-      }
-    }
-    return false;
-  }
-}
-
-/* ------------------------------------------------------------------
-   AF_Register Function
-   ------------------------------------------------------------------
-*/
-void AF_REGISTER(uint8_t EndPoint)
-{
-  uint8_t Len = 0x0F;                                               // total length after Cmd1 excl. XOR
-  uint8_t Cmd0 = 0x24;
-  uint8_t Cmd1 = 0x00;
-  uint8_t AppEndPoint = EndPoint;                                   // Register End Point
-  uint8_t AppProfileID0 = 0x04;
-  uint8_t AppProfileID1 = 0x01;
-  uint8_t DeviceID0 = 0x00;
-  uint8_t DeviceID1 = 0x00;
-  uint8_t DeviceVer = 0x01;
-  uint8_t LatencyReq = 0x00;
-  uint8_t AppNumInClusters = 0x03;
-  uint8_t InCluster0 = 0x00;
-  uint8_t InCluster1 = 0x00;
-  uint8_t InCluster2 = 0x02;
-  uint8_t InCluster3 = 0x04;
-  uint8_t InCluster4 = 0x05;
-  uint8_t InCluster5 = 0x04;
-  uint8_t AppNumOutClusters = 0x00;
-
-  // Make array
-  uint8_t AFRegister[] = {Len, Cmd0, Cmd1, AppEndPoint, AppProfileID0, AppProfileID1, DeviceID0, DeviceID1, DeviceVer, LatencyReq, AppNumInClusters, InCluster0, InCluster1, InCluster2, InCluster3, InCluster4, InCluster5, AppNumOutClusters};
-
-  DEBUG_SERIAL.println(F("AF_REGISTER SREQ"));
-  // SREQ
-  digitalWrite(PIN_SS_MRDY, LOW);
-  while (digitalRead(PIN_SRDY) == HIGH) {};
-  SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
-  for (int i = 0; i < sizeof(AFRegister); i++)
-  {
-    SPI.transfer(AFRegister[i]);
-  }
-  while (digitalRead(PIN_SRDY) == LOW) {};
-
-  mycc2530.SRSP();
-}
-
-/* ------------------------------------------------------------------
-   ZCL Read Attributes Response
-   ------------------------------------------------------------------
-*/
-void ZCLFrame_ReadAttributesResponse(uint8_t Data[], uint8_t arraysize)
-{
-  // ZCL Header
-  uint8_t FrameControl = 0x18;                                      // Bitfield that defines the command type and other relevant information in the ZCL command
-  uint8_t SequenceNumber = seqNumber;                               // A sequence number used to correlate a ZCL command with a ZCL response.
-  uint8_t CommandID = 0x01;                                         // Read Attributes Response
-  const uint8_t ZCLHeader[] = {FrameControl, SequenceNumber, CommandID};  // ZCL Header
-
-  // ZCL Payload
-  uint8_t ZCLPayload[30];
-  memcpy(ZCLPayload, Data, arraysize);
-
-  // ZCL Frame
-  uint8_t ZCLFrame[sizeof(ZCLHeader) + sizeof(ZCLPayload)];
-  memcpy(ZCLFrame, ZCLHeader, sizeof(ZCLHeader));
-  memcpy(ZCLFrame + sizeof(ZCLHeader), ZCLPayload, sizeof(ZCLPayload));
-  uint8_t ZCLFrameLength = sizeof(ZCLHeader) + arraysize;
-
-  // Send ZCL Frame
-  mycc2530.SetAF_DATA_REQUEST(0x01, 0x01, 0x00, 0x00, 0x00, 0x10, 0x30);
-  mycc2530.AF_DATA_REQUEST(0x00, 0x00, ZCLFrame, ZCLFrameLength);
-}
-
-/* ------------------------------------------------------------------
-   ZCL_Interview
-   ------------------------------------------------------------------
-*/
-void ZCL_Interview()
-{
-  uint8_t ControlField = mycc2530.ReceivedBytes[20];
-  seqNumber = mycc2530.ReceivedBytes[21];
-  uint8_t Command = mycc2530.ReceivedBytes[22];
-  uint8_t Attribute[2];
-  Attribute[0] = mycc2530.ReceivedBytes[23];
-  Attribute[1] = mycc2530.ReceivedBytes[24];
-
-  if (Attribute[0] == 0x05 && Attribute[1] == 0x00)
-  {
-    uint8_t Status = 0x00;
-    uint8_t DataType = 0x42; // Char String
-    uint8_t Length = sizeof(ModelIdentifier);
-
-    uint8_t Payload[5 + Length] = {Attribute[0], Attribute[1], Status, DataType, Length};
-    memcpy(Payload + 5, ModelIdentifier, sizeof(ModelIdentifier));
-
-    ZCLFrame_ReadAttributesResponse(Payload, sizeof(Payload));
-    mycc2530.RECV_CALLBACK();
-  }
-  else if (Attribute[0] == 0x04 && Attribute[1] == 0x00)
-  {
-    uint8_t Status = 0x00;
-    uint8_t DataType = 0x42; // Char String
-    uint8_t Length = sizeof(ManufacturerName);
-
-    uint8_t Payload[5 + Length] = {Attribute[0], Attribute[1], Status, DataType, Length};
-    memcpy(Payload + 5, ManufacturerName, sizeof(ManufacturerName));
-
-    ZCLFrame_ReadAttributesResponse(Payload, sizeof(Payload));
-    mycc2530.RECV_CALLBACK();
-  }
-  else if (Attribute[0] == 0x07 && Attribute[1] == 0x00)
-  {
-    uint8_t _PowerSource[] = {0x07, 0x00, 0x00, 0x30, PowerSource};
-    ZCLFrame_ReadAttributesResponse(_PowerSource, sizeof(_PowerSource));
-    mycc2530.RECV_CALLBACK();
-  }
-  else if (Attribute[0] == 0x01 && Attribute[1] == 0x00)
-  {
-    uint8_t _ApplicationVersion[] = {0x01, 0x00, 0x00, 0x20, ApplicationVersion};
-    ZCLFrame_ReadAttributesResponse(_ApplicationVersion, sizeof(_ApplicationVersion));
-    mycc2530.RECV_CALLBACK();
-  }
-  else if (Attribute[0] == 0x00 && Attribute[1] == 0x00)
-  {
-    uint8_t _ZCLVersion[] = {0x00, 0x00, 0x00, 0x20, ZCLVersion};
-    ZCLFrame_ReadAttributesResponse(_ZCLVersion, sizeof(_ZCLVersion));
-    mycc2530.RECV_CALLBACK();
-  }
-  else if (Attribute[0] == 0x02 && Attribute[1] == 0x00)
-  {
-    uint8_t _StackVersion[] = {0x02, 0x00, 0x00, 0x20, StackVersion};
-    ZCLFrame_ReadAttributesResponse(_StackVersion, sizeof(_StackVersion));
-    mycc2530.RECV_CALLBACK();
-  }
-  else if (Attribute[0] == 0x03 && Attribute[1] == 0x00)
-  {
-    uint8_t _HWVersion[] = {0x03, 0x00, 0x00, 0x20, HWVersion};
-    ZCLFrame_ReadAttributesResponse(_HWVersion, sizeof(_HWVersion));
-    mycc2530.RECV_CALLBACK();
-  }
-  else if (Attribute[0] == 0x06 && Attribute[1] == 0x00)
-  {
-    uint8_t Status = 0x00;
-    uint8_t DataType = 0x42; // Char String
-    uint8_t Length = sizeof(Datecode);
-
-    uint8_t Payload[5 + Length] = {Attribute[0], Attribute[1], Status, DataType, Length};
-    memcpy(Payload + 5, Datecode, sizeof(Datecode));
-
-    ZCLFrame_ReadAttributesResponse(Payload, sizeof(Payload));
-    mycc2530.RECV_CALLBACK();
-  }
-  else if (Attribute[0] == 0x00 && Attribute[1] == 0x40)
-  {
-    uint8_t Status = 0x00;
-    uint8_t DataType = 0x42; // Char String
-    uint8_t Length = sizeof(SoftwareBuildID);
-
-    uint8_t Payload[5 + Length] = {Attribute[0], Attribute[1], Status, DataType, Length};
-    memcpy(Payload + 5, SoftwareBuildID, sizeof(SoftwareBuildID));
-
-    ZCLFrame_ReadAttributesResponse(Payload, sizeof(Payload));
-    mycc2530.RECV_CALLBACK();
-  }
-}
-
-/* ------------------------------------------------------------------
-   ZCL Report Temperature
-   ------------------------------------------------------------------
-*/
-
-void ZCLFrame_ReportAttributes_Temp()
-{
-  // ZCL Header
-  uint8_t FrameControl = 0x18;                                      // Bitfield that defines the command type and other relevant information in the ZCL command
-  uint8_t SequenceNumber = seqCount;                                // A sequence number used to correlate a ZCL command with a ZCL response.
-  seqCount++;
-  uint8_t CommandID = 0x0a;                                         // CommandID: Report Attributes
-  uint8_t ZCLHeader[] = {FrameControl, SequenceNumber, CommandID};  // ZCL Header
-
-  // ZCL Payload
-  uint8_t AttributeID_MeasuredVal[2] = {0x00, 0x00};                // Attribute ID: Measured Value
-  uint8_t DataType = 0x29;                                          // Data Type: 16 bit integer Temperature measurement
-  int Temp = DHT.temperature * 100;                                 // Temperature value
-  uint8_t ZCLPayload[] = {AttributeID_MeasuredVal[0], AttributeID_MeasuredVal[1], DataType, lowByte(Temp), highByte(Temp)}; // ZCL Payload
-
-  // ZCL Frame
-  uint8_t ZCLFrame[sizeof(ZCLHeader) + sizeof(ZCLPayload)];
-  memcpy(ZCLFrame, ZCLHeader, sizeof(ZCLHeader));
-  memcpy(ZCLFrame + sizeof(ZCLHeader), ZCLPayload, sizeof(ZCLPayload));
-
-  // Send ZCL Frame
-  mycc2530.SetAF_DATA_REQUEST(0x01, 0x01, 0x02, 0x04, 0x00, 0x00, 0x30);  // Destination EP, Source EP, ClusterID, ClusterID, Trans ID, Options, Radius
-  mycc2530.AF_DATA_REQUEST(0x00, 0x00, ZCLFrame, sizeof(ZCLFrame));       // NwkAddr, NwkAddr, Payload to Send, Length of Payload
-}
-
-/* ------------------------------------------------------------------
-   ZCL Report Humidity
-   ------------------------------------------------------------------
-*/
-
-void ZCLFrame_ReportAttributes_Humidity()
-{
-  // ZCL Header
-  uint8_t FrameControl = 0x18;                                      // Bitfield that defines the command type and other relevant information in the ZCL command
-  uint8_t SequenceNumber = seqCount;                                // A sequence number used to correlate a ZCL command with a ZCL response.
-  seqCount++;
-  uint8_t CommandID = 0x0a;                                         // CommandID: Report Attributes
-  uint8_t ZCLHeader[] = {FrameControl, SequenceNumber, CommandID};  // ZCL Header
-
-  // ZCL Payload
-  uint8_t AttributeID_MeasuredVal[2] = {0x00, 0x00};                // Attribute ID: Measured Value
-  uint8_t DataType = 0x21;                                          // Data Type: 16 bit integer Humidity Measurement
-  int Humidity = DHT.humidity * 100;                                // Humidity value
-  uint8_t ZCLPayload[] = {AttributeID_MeasuredVal[0], AttributeID_MeasuredVal[1], DataType, lowByte(Humidity), highByte(Humidity)}; // ZCL Payload
-
-  // ZCL Frame
-  uint8_t ZCLFrame[sizeof(ZCLHeader) + sizeof(ZCLPayload)];
-  memcpy(ZCLFrame, ZCLHeader, sizeof(ZCLHeader));
-  memcpy(ZCLFrame + sizeof(ZCLHeader), ZCLPayload, sizeof(ZCLPayload));
-
-  // Send ZCL Frame
-  mycc2530.SetAF_DATA_REQUEST(0x01, 0x01, 0x05, 0x04, 0x00, 0x00, 0x30);  // Destination EP, Source EP, ClusterID, ClusterID, Trans ID, Options, Radius
-  mycc2530.AF_DATA_REQUEST(0x00, 0x00, ZCLFrame, sizeof(ZCLFrame));       // NwkAddr, NwkAddr, Payload to Send, Length of Payload
+  mycc2530.SetSRDY_INTERRUPT();
 }
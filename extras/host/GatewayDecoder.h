@@ -0,0 +1,98 @@
+/*
+  GatewayDecoder.h
+  Host side decoder for the records written by CC2530::GATEWAY_WRITE().
+
+  Bytes from the serial port are fed one at a time.  A 0x00 ends a COBS encoded record, which is
+  decoded, checked against its CRC-16/CCITT-FALSE and its Len field, and then returned by feed().
+  Records that fail a check are counted in Errors and skipped, so decoding resumes at the next 0x00.
+*/
+
+#ifndef GatewayDecoder_h
+#define GatewayDecoder_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct GatewayRecord
+{
+  uint16_t ClusterID;
+  uint16_t SrcAddr;
+  uint8_t SrcEndpoint;
+  uint8_t DstEndpoint;
+  uint8_t LinkQuality;
+  uint8_t TransSeqNumber;
+  std::vector<uint8_t> Data;
+};
+
+class GatewayDecoder
+{
+  public:
+    unsigned Errors = 0;
+
+    // Returns true when Byte ends a valid record, which is then in Out
+    bool feed(uint8_t Byte, GatewayRecord &Out)
+    {
+      if (Byte != 0x00)
+      {
+        _Encoded.push_back(Byte);
+        return false;
+      }
+      std::vector<uint8_t> Record;
+      bool Ok = decode(_Encoded, Record);
+      _Encoded.clear();
+      if (!Ok || Record.size() < 11 || Record[8] != Record.size() - 11 || crc16(Record.data(), Record.size() - 2) != (Record[Record.size() - 2] | Record[Record.size() - 1] << 8))
+      {
+        Errors++;
+        return false;
+      }
+      Out.ClusterID = Record[0] | Record[1] << 8;
+      Out.SrcAddr = Record[2] | Record[3] << 8;
+      Out.SrcEndpoint = Record[4];
+      Out.DstEndpoint = Record[5];
+      Out.LinkQuality = Record[6];
+      Out.TransSeqNumber = Record[7];
+      Out.Data.assign(Record.begin() + 9, Record.end() - 2);
+      return true;
+    }
+
+    static bool decode(const std::vector<uint8_t> &In, std::vector<uint8_t> &Out)
+    {
+      Out.clear();
+      size_t i = 0;
+      while (i < In.size())
+      {
+        uint8_t Code = In[i++];
+        if (Code == 0x00 || i + Code - 1 > In.size())
+        {
+          return false;
+        }
+        Out.insert(Out.end(), In.begin() + i, In.begin() + i + Code - 1);
+        i += Code - 1;
+        if (i < In.size())
+        {
+          Out.push_back(0x00);
+        }
+      }
+      return true;
+    }
+
+    static uint16_t crc16(const uint8_t *Data, size_t Len)
+    {
+      uint16_t Crc = 0xFFFF;
+      for (size_t i = 0; i < Len; i++)
+      {
+        Crc ^= (uint16_t) Data[i] << 8;
+        for (int Bit = 0; Bit < 8; Bit++)
+        {
+          Crc = (Crc & 0x8000) ? (Crc << 1) ^ 0x1021 : Crc << 1;
+        }
+      }
+      return Crc;
+    }
+
+  private:
+    std::vector<uint8_t> _Encoded;
+};
+
+#endif
@@ -0,0 +1,633 @@
+/*
+  ZnpEmulator.cpp
+  See ZnpEmulator.h.
+*/
+
+#include "ZnpEmulator.h"
+#include "Arduino.h"
+
+#include <algorithm>
+
+ZnpEmulator::ZnpEmulator(uint8_t PinSrdy, uint8_t PinMrdy, uint8_t PinRes)
+{
+  _PinSrdy = PinSrdy;
+  _PinMrdy = PinMrdy;
+  _PinRes = PinRes;
+  hostsim::setHandshakePins(PinSrdy, PinMrdy);
+  _InstallDefaults();
+}
+
+ZnpEmulator::Frame ZnpEmulator::frame(uint8_t Cmd0, uint8_t Cmd1, std::initializer_list<uint8_t> Data)
+{
+  return frame(Cmd0, Cmd1, std::vector<uint8_t>(Data));
+}
+
+ZnpEmulator::Frame ZnpEmulator::frame(uint8_t Cmd0, uint8_t Cmd1, const std::vector<uint8_t> &Data)
+{
+  Frame f;
+  f.push_back((uint8_t) Data.size());
+  f.push_back(Cmd0);
+  f.push_back(Cmd1);
+  f.insert(f.end(), Data.begin(), Data.end());
+  return f;
+}
+
+void ZnpEmulator::on(uint16_t Cmd, Handler h)
+{
+  _Handlers[Cmd] = h;
+}
+
+void ZnpEmulator::queueAreq(uint64_t DelayUs, const Frame &f)
+{
+  Scheduled s;
+  s.DueNs = hostsim::nowNs() + DelayUs * 1000ULL;
+  s.Order = _Order++;
+  s.f = f;
+  _Scheduled.push_back(s);
+}
+
+/*
+  AF_INCOMING_MSG (0x4481)
+  GroupId(2) ClusterId(2) SrcAddr(2) SrcEndpoint DstEndpoint WasBroadcast LinkQuality SecurityUse TimeStamp(4) TransSeqNumber Len Data
+*/
+void ZnpEmulator::injectIncoming(uint16_t SrcAddr, uint16_t ClusterId, const std::vector<uint8_t> &Payload, uint8_t Lqi, uint64_t DelayUs, uint8_t SrcEndpoint, uint8_t DstEndpoint)
+{
+  uint32_t Stamp = (uint32_t) (hostsim::nowNs() / 1000000ULL);
+  std::vector<uint8_t> d = {0x00, 0x00, (uint8_t) (ClusterId & 0xFF), (uint8_t) (ClusterId >> 8), (uint8_t) (SrcAddr & 0xFF), (uint8_t) (SrcAddr >> 8), SrcEndpoint, DstEndpoint, 0x00, Lqi, 0x00,
+                            (uint8_t) Stamp, (uint8_t) (Stamp >> 8), (uint8_t) (Stamp >> 16), (uint8_t) (Stamp >> 24), TransSeq++, (uint8_t) Payload.size()};
+  d.insert(d.end(), Payload.begin(), Payload.end());
+  queueAreq(DelayUs, frame(0x44, 0x81, d));
+}
+
+size_t ZnpEmulator::countReceived(uint16_t Cmd) const
+{
+  size_t n = 0;
+  for (const Frame &f : Received)
+  {
+    if (cmd(f) == Cmd)
+    {
+      n++;
+    }
+  }
+  return n;
+}
+
+uint8_t ZnpEmulator::_LogicalType() const
+{
+  std::map<uint16_t, std::vector<uint8_t>>::const_iterator it = Nv.find(0x87);
+  return (it != Nv.end() && !it->second.empty()) ? it->second[0] : 0x00;
+}
+
+/*
+  Reset
+  Applies ZCD_NV_STARTUP_OPTION and schedules SYS_RESET_IND (0x4180) after the boot time.
+*/
+void ZnpEmulator::_Reset(uint8_t Reason)
+{
+  _InReset = false;
+  _Booting = true;
+  _ResetReason = Reason;
+  _BootDoneNs = hostsim::nowNs() + BootTimeUs * 1000ULL;
+  _Out.clear();
+  _Scheduled.clear();
+  _UartOut.clear();
+  Endpoints.clear();
+  State = DEV_HOLD;
+  TxPower = 0x04;
+  Resets++;
+
+  std::map<uint16_t, std::vector<uint8_t>>::iterator it = Nv.find(0x03);
+  uint8_t Options = (it != Nv.end() && !it->second.empty()) ? it->second[0] : 0x00;
+  if (Options & 0x01) // ZCD_STARTOPT_DEFAULT_CONFIG_STATE
+  {
+    Nv.clear();
+  }
+  if (Options & 0x02) // ZCD_STARTOPT_DEFAULT_NETWORK_STATE
+  {
+    NetworkFormed = false;
+  }
+  Nv[0x03] = {0x00};
+}
+
+/*
+  hostsim::Device
+*/
+bool ZnpEmulator::drivesPin(uint8_t Pin)
+{
+  return Pin == _PinSrdy;
+}
+
+int ZnpEmulator::pinRead(uint8_t Pin)
+{
+  update();
+  if (Pin != _PinSrdy || _InReset || _Booting || _Stuck)
+  {
+    return HIGH;
+  }
+  switch (_Phase)
+  {
+    case IDLE:
+      return _Out.empty() ? HIGH : LOW;
+    case WAIT_READY:
+      return (hostsim::nowNs() >= _ReadyAtNs || !_Out.empty()) ? LOW : HIGH;
+    case RX:
+    case PROCESS:
+      return LOW;
+    default:
+      return HIGH;
+  }
+}
+
+void ZnpEmulator::pinChanged(uint8_t Pin, uint8_t Level)
+{
+  update();
+  if (Pin == _PinRes)
+  {
+    if (Level == LOW && !_InReset)
+    {
+      _InReset = true;
+      _Booting = false;
+      _Phase = IDLE;
+      _Out.clear();
+      _Scheduled.clear();
+      _PendingAreq.clear();
+      _UartOut.clear();
+    }
+    else if (Level == HIGH && _InReset)
+    {
+      _Reset(Resets == 0 ? 0x00 : 0x01); // Power-up or External
+    }
+  }
+  else if (Pin == _PinMrdy)
+  {
+    if (Level == LOW && _Phase == IDLE)
+    {
+      _Phase = WAIT_READY;
+      _ReadyAtNs = hostsim::nowNs() + ReadyLatencyUs * 1000ULL;
+    }
+    else if (Level == HIGH)
+    {
+      if (_Phase == RX || _Phase == PROCESS || (_Phase == TX && _TxPos < _Tx.size()))
+      {
+        ProtocolErrors++;
+      }
+      _Phase = IDLE;
+      if (!_PendingAreq.empty())
+      {
+        Frame Req, Unused;
+        Req.swap(_PendingAreq);
+        _Execute(Req, Unused);
+      }
+    }
+  }
+}
+
+uint8_t ZnpEmulator::spiTransfer(uint8_t Out)
+{
+  update();
+  if (_InReset || _Booting)
+  {
+    ProtocolErrors++;
+    return 0x00;
+  }
+  switch (_Phase)
+  {
+    case WAIT_READY:
+      if (pinRead(_PinSrdy) == HIGH)
+      {
+        ProtocolErrors++;
+        return 0x00;
+      }
+      _Phase = RX;
+      _Rx.clear();
+      // fall through
+    case RX:
+      _Rx.push_back(Out);
+      if (_Rx.size() >= 3 && _Rx.size() == (size_t) _Rx[0] + 3)
+      {
+        _Complete();
+      }
+      return 0x00;
+    case TX:
+    {
+      uint8_t b = _Tx[_TxPos++];
+      if (_TxPos >= _Tx.size())
+      {
+        _Phase = DONE;
+      }
+      return b;
+    }
+    case PROCESS:
+      ProtocolErrors++;
+      return 0x00;
+    default:
+      return 0x00;
+  }
+}
+
+void ZnpEmulator::_Complete()
+{
+  _Phase = PROCESS;
+  _Tx.clear();
+  _TxPos = 0;
+  _RxIsPoll = _Rx[0] == 0 && _Rx[1] == 0 && _Rx[2] == 0;
+  if (_RxIsPoll)
+  {
+    _DoneAtNs = hostsim::nowNs() + PollLatencyUs * 1000ULL;
+    return;
+  }
+  Received.push_back(_Rx);
+  if ((_Rx[1] & 0xE0) != 0x20)
+  {
+    // AREQ: no response, SRDY returns high once received and the command runs when MRDY is released
+    _PendingAreq = _Rx;
+    _DoneAtNs = hostsim::nowNs() + PollLatencyUs * 1000ULL;
+    return;
+  }
+  _ResponseLatencyUs = SrspLatencyUs;
+  _Execute(_Rx, _Tx);
+  _DoneAtNs = hostsim::nowNs() + _ResponseLatencyUs * 1000ULL;
+}
+
+void ZnpEmulator::_Execute(const Frame &Req, Frame &Rsp)
+{
+  std::map<uint16_t, Handler>::iterator it = _Handlers.find(cmd(Req));
+  if (it != _Handlers.end())
+  {
+    it->second(*this, Req, Rsp);
+  }
+  else if ((Req[1] & 0xE0) == 0x20)
+  {
+    Rsp = frame(0x60, 0x00, {0x02, Req[1], Req[2]}); // RPC error: invalid command ID
+  }
+}
+
+void ZnpEmulator::update()
+{
+  uint64_t Now = hostsim::nowNs();
+
+  while (!_UartIn.empty() && _UartIn.front().AtNs <= Now)
+  {
+    uint8_t c = _UartIn.front().Byte;
+    _UartIn.pop_front();
+    _UartReceive(c);
+  }
+
+  if (_Booting && Now >= _BootDoneNs)
+  {
+    _Booting = false;
+    _Out.push_back(frame(0x41, 0x80, {_ResetReason, 0x02, 0x00, 0x02, 0x06, 0x03})); // SYS_RESET_IND
+  }
+
+  if (!_InReset && !_Booting && !_Scheduled.empty())
+  {
+    std::stable_sort(_Scheduled.begin(), _Scheduled.end(), [](const Scheduled &a, const Scheduled &b) {
+      return a.DueNs != b.DueNs ? a.DueNs < b.DueNs : a.Order < b.Order;
+    });
+    while (!_Scheduled.empty() && _Scheduled.front().DueNs <= Now)
+    {
+      const Frame &f = _Scheduled.front().f;
+      if (cmd(f) == 0x45C0 && f.size() > 3)
+      {
+        State = f[3];
+        if (State == DEV_END_DEVICE || State == DEV_ROUTER || State == DEV_ZB_COORD)
+        {
+          NetworkFormed = true;
+        }
+      }
+      _Out.push_back(f);
+      _Scheduled.erase(_Scheduled.begin());
+    }
+  }
+
+  if (_Phase == PROCESS && Now >= _DoneAtNs)
+  {
+    _Phase = TX;
+    if (_RxIsPoll)
+    {
+      if (_Out.empty())
+      {
+        _Tx = frame(0x00, 0x00);
+      }
+      else
+      {
+        _Tx = _Out.front();
+        _Out.pop_front();
+      }
+    }
+    if (_Tx.empty())
+    {
+      _Phase = DONE;
+    }
+  }
+
+  while (UartMode && !_Out.empty())
+  {
+    _UartSend(_Out.front());
+    _Out.pop_front();
+  }
+}
+
+/*
+  UART
+*/
+void ZnpEmulator::_UartSend(const Frame &f)
+{
+  uint64_t ByteNs = 10ULL * 1000000000ULL / UartBaud;
+  uint8_t Fcs = 0;
+  for (size_t i = 0; i <= f.size() + 1; i++)
+  {
+    uint8_t c = i == 0 ? 0xFE : (i <= f.size() ? f[i - 1] : Fcs);
+    if (i > 0)
+    {
+      Fcs ^= c;
+    }
+    _UartOutFreeNs = std::max(_UartOutFreeNs, hostsim::nowNs()) + ByteNs;
+    _UartOut.push_back({_UartOutFreeNs, c});
+  }
+}
+
+void ZnpEmulator::uartNoise(const std::vector<uint8_t> &Bytes)
+{
+  uint64_t ByteNs = 10ULL * 1000000000ULL / UartBaud;
+  for (uint8_t c : Bytes)
+  {
+    _UartOutFreeNs = std::max(_UartOutFreeNs, hostsim::nowNs()) + ByteNs;
+    _UartOut.push_back({_UartOutFreeNs, c});
+  }
+}
+
+void ZnpEmulator::_UartReceive(uint8_t c)
+{
+  if (!_UartSof)
+  {
+    _UartSof = c == 0xFE;
+    _UartRx.clear();
+    return;
+  }
+  _UartRx.push_back(c);
+  if (_UartRx.size() < 4 || _UartRx.size() < (size_t) _UartRx[0] + 4)
+  {
+    return;
+  }
+  _UartSof = false;
+  Frame Req(_UartRx.begin(), _UartRx.end() - 1);
+  uint8_t Fcs = 0;
+  for (uint8_t b : Req)
+  {
+    Fcs ^= b;
+  }
+  if (Fcs != _UartRx.back() || _InReset || _Booting)
+  {
+    ProtocolErrors++;
+    return;
+  }
+  Received.push_back(Req);
+  Frame Rsp;
+  _ResponseLatencyUs = SrspLatencyUs;
+  _Execute(Req, Rsp);
+  if ((Req[1] & 0xE0) == 0x20 && !Rsp.empty())
+  {
+    queueAreq(_ResponseLatencyUs, Rsp);                              // Sent when ready, in order with the AREQs
+  }
+}
+
+size_t ZnpEmulator::UartPort::_Ready()
+{
+  _Znp.update();
+  uint64_t Now = hostsim::nowNs();
+  size_t Ready = 0;
+  while (Ready < _Znp._UartOut.size() && _Znp._UartOut[Ready].AtNs <= Now)
+  {
+    Ready++;
+  }
+  size_t Buffer = hostsim::cost().serial_rx_buffer;
+  if (Ready > Buffer)                                                // Arrived since the last read with the buffer full
+  {
+    _Znp.UartDropped += Ready - Buffer;
+    _Znp._UartOut.erase(_Znp._UartOut.begin() + Buffer, _Znp._UartOut.begin() + Ready);
+    Ready = Buffer;
+  }
+  return Ready;
+}
+
+int ZnpEmulator::UartPort::available()
+{
+  hostsim::advanceNs(hostsim::cost().serial_read_ns);
+  return (int) _Ready();
+}
+
+int ZnpEmulator::UartPort::read()
+{
+  hostsim::advanceNs(hostsim::cost().serial_read_ns);
+  if (_Ready() == 0)
+  {
+    return -1;
+  }
+  uint8_t c = _Znp._UartOut.front().Byte;
+  _Znp._UartOut.pop_front();
+  return c;
+}
+
+size_t ZnpEmulator::UartPort::write(uint8_t c)
+{
+  uint64_t ByteNs = 10ULL * 1000000000ULL / _Znp.UartBaud;
+  uint64_t Capacity = hostsim::cost().serial_tx_buffer * ByteNs;
+  if (_Znp._UartInFreeNs > hostsim::nowNs() + Capacity)               // TX buffer full
+  {
+    hostsim::advanceNs(_Znp._UartInFreeNs - Capacity - hostsim::nowNs());
+  }
+  hostsim::advanceNs(4000);                                           // HardwareSerial::write() and TX ISR
+  _Znp.update();
+  _Znp._UartInFreeNs = std::max(_Znp._UartInFreeNs, hostsim::nowNs()) + ByteNs;
+  _Znp._UartIn.push_back({_Znp._UartInFreeNs, c});
+  return 1;
+}
+
+/*
+  Default Handlers
+*/
+void ZnpEmulator::_InstallDefaults()
+{
+  // SYS_RESET_REQ (AREQ)
+  on(0x4100, [](ZnpEmulator &z, const Frame &, Frame &) { z._Reset(0x02); });
+
+  // SYS_SET_TX_POWER
+  on(0x2114, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    z.TxPower = q.size() > 3 ? q[3] : 0;
+    r = frame(0x61, 0x14, {z.TxPower});
+  });
+
+  // SYS_GPIO
+  on(0x210E, [](ZnpEmulator &, const Frame &q, Frame &r) { r = frame(0x61, 0x0E, {(uint8_t) (q.size() > 4 ? q[4] : 0)}); });
+
+  // SYS_OSAL_NV_READ: Id(2) Offset
+  on(0x2108, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    uint16_t Id = q[3] | q[4] << 8;
+    std::map<uint16_t, std::vector<uint8_t>>::iterator it = z.Nv.find(Id);
+    if (it == z.Nv.end())
+    {
+      r = frame(0x61, 0x08, {0x0A, 0x00}); // NV_OPER_FAILED
+      return;
+    }
+    std::vector<uint8_t> d = {0x00, (uint8_t) it->second.size()};
+    d.insert(d.end(), it->second.begin(), it->second.end());
+    r = frame(0x61, 0x08, d);
+  });
+
+  // SYS_OSAL_NV_WRITE: Id(2) Offset Len Value
+  on(0x2109, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    uint16_t Id = q[3] | q[4] << 8;
+    uint8_t Offset = q[5];
+    uint8_t Len = q[6];
+    std::vector<uint8_t> &Item = z.Nv[Id];
+    if (Item.size() < (size_t) Offset + Len)
+    {
+      Item.resize(Offset + Len);
+    }
+    std::copy(q.begin() + 7, q.begin() + 7 + Len, Item.begin() + Offset);
+    z.delayResponse(z.NvWriteLatencyUs);
+    r = frame(0x61, 0x09, {0x00});
+  });
+
+  // ZB_READ_CONFIGURATION: ConfigId
+  on(0x2604, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    std::map<uint16_t, std::vector<uint8_t>>::iterator it = z.Nv.find(q[3]);
+    if (it == z.Nv.end())
+    {
+      r = frame(0x66, 0x04, {0x02, q[3], 0x00}); // ZInvalidParameter
+      return;
+    }
+    std::vector<uint8_t> d = {0x00, q[3], (uint8_t) it->second.size()};
+    d.insert(d.end(), it->second.begin(), it->second.end());
+    r = frame(0x66, 0x04, d);
+  });
+
+  // ZB_WRITE_CONFIGURATION: ConfigId Len Value
+  on(0x2605, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    z.Nv[q[3]] = std::vector<uint8_t>(q.begin() + 5, q.begin() + 5 + q[4]);
+    z.delayResponse(z.NvWriteLatencyUs);
+    r = frame(0x66, 0x05, {0x00});
+  });
+
+  // ZB_GET_DEVICE_INFO: Param
+  on(0x2606, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    std::vector<uint8_t> d = {q[3], 0, 0, 0, 0, 0, 0, 0, 0};
+    if (q[3] == 0x00)
+    {
+      d[1] = z.State;
+    }
+    else if (q[3] == 0x01)
+    {
+      std::copy(z.IEEEAddr, z.IEEEAddr + 8, d.begin() + 1);
+    }
+    else if (q[3] == 0x02)
+    {
+      d[1] = z.ShortAddr & 0xFF;
+      d[2] = z.ShortAddr >> 8;
+    }
+    r = frame(0x66, 0x06, d);
+  });
+
+  // UTIL_GET_DEVICE_INFO
+  on(0x2700, [](ZnpEmulator &z, const Frame &, Frame &r) {
+    std::vector<uint8_t> d = {0x00};
+    d.insert(d.end(), z.IEEEAddr, z.IEEEAddr + 8);
+    d.push_back(z.ShortAddr & 0xFF);
+    d.push_back(z.ShortAddr >> 8);
+    d.push_back(0x07); // DeviceType: coordinator, router and end device capable
+    d.push_back(z.State);
+    d.push_back(0x00); // NumAssocDevices
+    r = frame(0x67, 0x00, d);
+  });
+
+  // AF_REGISTER: EndPoint ...
+  on(0x2400, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    uint8_t Status = 0x00;
+    if (std::find(z.Endpoints.begin(), z.Endpoints.end(), q[3]) != z.Endpoints.end())
+    {
+      Status = 0xB8; // ZApsDuplicateEntry
+    }
+    else
+    {
+      z.Endpoints.push_back(q[3]);
+    }
+    r = frame(0x64, 0x00, {Status});
+  });
+
+  // AF_DATA_REQUEST: DstAddr(2) DstEndpoint SrcEndpoint ClusterId(2) TransId Options Radius Len Data
+  on(0x2401, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    z.AfSent.push_back(q);
+    bool Joined = z.State == DEV_END_DEVICE || z.State == DEV_ROUTER || z.State == DEV_ZB_COORD;
+    z.queueAreq(z.ConfirmLatencyUs, frame(0x44, 0x80, {(uint8_t) (Joined ? z.ConfirmStatus : 0xC2), q[6], q[9]}));
+    r = frame(0x64, 0x01, {0x00});
+  });
+
+  // AF_DATA_REQUEST_EXT: DstAddrMode DstAddr(8) DstEndpoint DstPanId(2) SrcEndpoint ClusterId(2) TransId Options Radius Len(2) Data
+  on(0x2402, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    z.AfSent.push_back(q);
+    bool Joined = z.State == DEV_END_DEVICE || z.State == DEV_ROUTER || z.State == DEV_ZB_COORD;
+    z.queueAreq(z.ConfirmLatencyUs, frame(0x44, 0x80, {(uint8_t) (Joined ? z.ConfirmStatus : 0xC2), q[15], q[18]}));
+    r = frame(0x64, 0x02, {0x00});
+  });
+
+  // ZDO_STARTUP_FROM_APP: StartDelay(2)
+  on(0x2540, [](ZnpEmulator &z, const Frame &, Frame &r) {
+    uint8_t Type = z._LogicalType();
+    uint64_t t = z.NetworkFormed ? z.RestoreTimeUs : z.FormTimeUs;
+    r = frame(0x65, 0x40, {(uint8_t) (z.NetworkFormed ? 0x00 : 0x01)});
+    if (Type == 0x00)
+    {
+      z.ShortAddr = 0x0000;
+      z.queueAreq(10000, frame(0x45, 0xC0, {DEV_COORD_STARTING}));
+      z.queueAreq(t, frame(0x45, 0xC0, {DEV_ZB_COORD}));
+    }
+    else
+    {
+      z.ShortAddr = 0x1A2B;
+      z.queueAreq(10000, frame(0x45, 0xC0, {DEV_NWK_DISC}));
+      z.queueAreq(t / 2, frame(0x45, 0xC0, {DEV_NWK_JOINING}));
+      z.queueAreq(t, frame(0x45, 0xC0, {(uint8_t) (Type == 0x01 ? DEV_ROUTER : DEV_END_DEVICE)}));
+    }
+  });
+
+  // ZDO_NODE_DESC_REQ
+  on(0x2502, [](ZnpEmulator &, const Frame &, Frame &r) { r = frame(0x65, 0x02, {0x00}); });
+
+  // ZDO_END_DEVICE_BIND_REQ
+  on(0x2520, [](ZnpEmulator &, const Frame &, Frame &r) { r = frame(0x65, 0x20, {0x00}); });
+
+  // ZDO_MGMT_LEAVE_REQ
+  on(0x2534, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    r = frame(0x65, 0x34, {0x00});
+    z.queueAreq(5000, frame(0x45, 0xB4, {q[3], q[4], 0x00}));
+  });
+
+  // ZDO_MGMT_PERMIT_JOIN_REQ
+  on(0x2536, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    r = frame(0x65, 0x36, {0x00});
+    z.queueAreq(5000, frame(0x45, 0xB6, {q[3], q[4], 0x00}));
+  });
+
+  // ZDO_MGMT_NWK_UPDATE_REQ: DstAddr(2) DstAddrMode ChannelMask(4) ScanDuration ScanCount NwkManagerAddr(2)
+  // A ScanDuration of 0 to 5 is an energy scan, reported by ZDO_MGMT_NWK_UPDATE_NOTIFY after (2^ScanDuration + 1) * 15.36 ms per channel and scan
+  on(0x2537, [](ZnpEmulator &z, const Frame &q, Frame &r) {
+    bool Joined = z.State == DEV_ROUTER || z.State == DEV_ZB_COORD;
+    r = frame(0x65, 0x37, {(uint8_t) (Joined ? 0x00 : 0xC2)});
+    if (!Joined || q[10] > 0x05)
+    {
+      return;
+    }
+    uint32_t Mask = q[6] | q[7] << 8 | q[8] << 16 | (uint32_t) q[9] << 24;
+    std::vector<uint8_t> d = {(uint8_t) z.ShortAddr, (uint8_t) (z.ShortAddr >> 8), 0x00, q[6], q[7], q[8], q[9], 0x00, 0x00, 0x00, 0x00, 0x00};
+    for (uint8_t Channel = 11; Channel <= 26; Channel++)
+    {
+      if (Mask & (1UL << Channel))
+      {
+        d.push_back(z.ChannelEnergy[Channel - 11]);
+      }
+    }
+    d[11] = d.size() - 12;                                           // ListCount
+    z.queueAreq((uint64_t) d[11] * q[11] * ((1 << q[10]) + 1) * 15360, frame(0x45, 0xB8, d));
+  });
+}
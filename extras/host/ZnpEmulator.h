@@ -0,0 +1,183 @@
+/*
+  ZnpEmulator.h
+  A scriptable CC2530 Z-Stack ZNP stand-in for the host build.
+
+  Implements the slave side of the ZNP SPI transport (Z-Stack ZNP Interface Specification, section 4):
+  - SRDY is driven low when the ZNP has a queued AREQ or is ready to receive after MRDY is asserted;
+  - SRDY is driven high when a SRSP (or polled AREQ) is ready to be clocked out;
+  - SREQs are answered by per command handlers, AREQs are scheduled on the modeled clock.
+
+  Default handlers cover the commands used by the library and examples.  Scripts can override any
+  command with on(), schedule AREQs with queueAreq() and change the modeled latencies.
+
+  With UartMode set the same commands are served over the UART ZNP transport (section 5) through
+  Uart instead, for CC2530(Stream &) built with CC2530_UART.
+*/
+
+#ifndef ZnpEmulator_h
+#define ZnpEmulator_h
+
+#include "HostSim.h"
+#include "Arduino.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <vector>
+
+class ZnpEmulator : public hostsim::Device
+{
+  public:
+
+  typedef std::vector<uint8_t> Frame; // Len, Cmd0, Cmd1, Data...
+  typedef std::function<void(ZnpEmulator &Znp, const Frame &Req, Frame &Rsp)> Handler;
+
+  /*
+    ZDO device states reported in ZDO_STATE_CHANGE_IND (0x45C0)
+  */
+  enum DevState
+  {
+    DEV_HOLD = 0x00,
+    DEV_INIT = 0x01,
+    DEV_NWK_DISC = 0x02,
+    DEV_NWK_JOINING = 0x03,
+    DEV_END_DEVICE = 0x06,
+    DEV_ROUTER = 0x07,
+    DEV_COORD_STARTING = 0x08,
+    DEV_ZB_COORD = 0x09
+  };
+
+  ZnpEmulator(uint8_t PinSrdy = 8, uint8_t PinMrdy = 10, uint8_t PinRes = 9);
+
+  static Frame frame(uint8_t Cmd0, uint8_t Cmd1, std::initializer_list<uint8_t> Data = {});
+  static Frame frame(uint8_t Cmd0, uint8_t Cmd1, const std::vector<uint8_t> &Data);
+  static uint16_t cmd(const Frame &f) { return f.size() >= 3 ? (f[1] << 8 | f[2]) : 0; }
+
+  // Scripting
+  void on(uint16_t Cmd, Handler h);
+  void queueAreq(uint64_t DelayUs, const Frame &f);
+  void delayResponse(uint32_t Us) { _ResponseLatencyUs = Us; }
+  void injectIncoming(uint16_t SrcAddr, uint16_t ClusterId, const std::vector<uint8_t> &Payload, uint8_t Lqi = 0x80, uint64_t DelayUs = 0, uint8_t SrcEndpoint = 0x01, uint8_t DstEndpoint = 0x01);
+  void setStuck(bool Stuck) { _Stuck = Stuck; }
+
+  // Modeled latencies
+  uint32_t ReadyLatencyUs = 25;            // MRDY low to SRDY low
+  uint32_t SrspLatencyUs = 150;            // Last SREQ byte to SRSP ready
+  uint32_t NvWriteLatencyUs = 2000;        // Flash write for NV items
+  uint32_t PollLatencyUs = 20;             // POLL frame to AREQ ready
+  uint32_t BootTimeUs = 400000;            // Reset to SYS_RESET_IND
+  uint32_t FormTimeUs = 600000;            // ZDO_STARTUP_FROM_APP to network formed / joined
+  uint32_t RestoreTimeUs = 150000;         // ZDO_STARTUP_FROM_APP with restored network state
+  uint32_t ConfirmLatencyUs = 12000;       // AF_DATA_REQUEST to AF_DATA_CONFIRM
+  uint8_t ConfirmStatus = 0x00;
+  uint8_t TransSeq = 0;                    // TransSeqNumber (APS counter) of the next injectIncoming()
+  uint8_t ChannelEnergy[16] = {0xC8, 0xD2, 0xB4, 0x96, 0x28, 0xAA, 0xBE, 0xBE, 0xA0, 0x32, 0x8C, 0x96, 0x96, 0x82, 0x1E, 0x23}; // Energy detected on channels 11 to 26: Wi-Fi on 1, 6 and 11
+
+  /*
+    UART
+    The host's end of the E18-MS1 UART: frames written to it (SOF 0xFE, Len, Cmd0, Cmd1, Data, FCS)
+    are executed as over SPI, and SRSPs and AREQs are sent back unprompted in the same framing, one
+    byte every 10 bits at UartBaud.  Bytes the host has not read are held in a serial_rx_buffer byte
+    buffer, bytes arriving while it is full are lost (UartDropped).
+  */
+  class UartPort : public Stream
+  {
+    public:
+    UartPort(ZnpEmulator &Znp) : _Znp(Znp) {}
+    int available();
+    int read();
+    size_t write(uint8_t c);
+    using Print::write;
+
+    private:
+    size_t _Ready();
+    ZnpEmulator &_Znp;
+  };
+
+  bool UartMode = false;
+  uint32_t UartBaud = 115200;
+  UartPort Uart{*this};
+  uint32_t UartDropped = 0;
+  void uartNoise(const std::vector<uint8_t> &Bytes); // Raw bytes on the line to the host, e.g. a corrupted frame
+
+  // Observable state
+  std::map<uint16_t, std::vector<uint8_t>> Nv; // NV items by id (ZB_WRITE_CONFIGURATION ids are the low byte)
+  std::vector<Frame> Received;             // Every frame received from the host, in order
+  std::vector<Frame> AfSent;               // AF_DATA_REQUEST(_EXT) frames
+  std::vector<uint8_t> Endpoints;          // Registered endpoints
+  uint8_t State = DEV_HOLD;
+  bool NetworkFormed = false;              // Network state held in NV
+  uint8_t TxPower = 0x04;
+  uint16_t ShortAddr = 0x0000;
+  uint8_t IEEEAddr[8] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+  uint32_t Resets = 0;
+  uint32_t ProtocolErrors = 0;
+
+  size_t pendingAreqs() const { return _Out.size() + _Scheduled.size(); }
+  size_t countReceived(uint16_t Cmd) const;
+
+  // hostsim::Device
+  bool drivesPin(uint8_t Pin);
+  int pinRead(uint8_t Pin);
+  void pinChanged(uint8_t Pin, uint8_t Level);
+  uint8_t spiTransfer(uint8_t Out);
+  void update();
+
+  private:
+
+  enum Phase { IDLE, WAIT_READY, RX, PROCESS, TX, DONE };
+
+  struct Scheduled
+  {
+    uint64_t DueNs;
+    uint64_t Order;
+    Frame f;
+  };
+
+  void _InstallDefaults();
+  void _Reset(uint8_t Reason);
+  void _Complete();
+  void _Execute(const Frame &Req, Frame &Rsp);
+  uint8_t _LogicalType() const;
+  void _UartSend(const Frame &f);
+  void _UartReceive(uint8_t c);
+
+  uint8_t _PinSrdy;
+  uint8_t _PinMrdy;
+  uint8_t _PinRes;
+  Phase _Phase = IDLE;
+  bool _Stuck = false;
+  bool _InReset = false;
+  bool _Booting = false;
+  uint8_t _ResetReason = 0x00;
+  uint64_t _BootDoneNs = 0;
+  uint64_t _ReadyAtNs = 0;
+  uint64_t _DoneAtNs = 0;
+  uint64_t _Order = 0;
+  uint32_t _ResponseLatencyUs = 0;
+  Frame _Rx;
+  Frame _Tx;
+  Frame _PendingAreq;
+  size_t _TxPos = 0;
+  bool _RxIsPoll = false;
+  std::deque<Frame> _Out;
+  std::vector<Scheduled> _Scheduled;
+  std::map<uint16_t, Handler> _Handlers;
+
+  struct UartByte
+  {
+    uint64_t AtNs;                         // Time the last bit arrives
+    uint8_t Byte;
+  };
+  std::deque<UartByte> _UartIn;            // Host to ZNP, in flight
+  std::deque<UartByte> _UartOut;           // ZNP to host, in flight or waiting to be read
+  uint64_t _UartInFreeNs = 0;
+  uint64_t _UartOutFreeNs = 0;
+  Frame _UartRx;                           // Frame being received after its SOF: Len, Cmd0, Cmd1, Data, FCS
+  bool _UartSof = false;
+};
+
+#endif
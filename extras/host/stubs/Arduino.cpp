@@ -0,0 +1,632 @@
+/*
+  Arduino.cpp (host stub)
+  Modeled clock, pins and Serial for the host build.  See HostSim.h.
+*/
+
+#include "Arduino.h"
+#include "HostSim.h"
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+
+#include <stdio.h>
+#include <stdexcept>
+
+namespace hostsim
+{
+  static const int NumPins = 32;
+
+  static CostModel _Cost;
+  static Counters _Counters;
+  static Device *_Device = 0;
+  static uint64_t _NowNs = 0;
+  static uint64_t _WatchdogNs = 0;
+  static uint8_t _Mode[NumPins];
+  static uint8_t _Latch[NumPins];
+  static uint8_t _SrdyPin = 8;
+  static uint8_t _MrdyPin = 10;
+  static bool _Spinning = false;           // Previous core call was an SRDY read
+  static uint64_t _LastSrdyReadNs = 0;
+  static bool _MrdyLow = false;
+  static uint64_t _MrdyLowSinceNs = 0;
+  static uint64_t _SerialFreeAtNs = 0;
+  static bool _SerialEcho = false;
+  static uint64_t _Timer0StoppedNs = 0;   // Time spent in sleep modes that stop Timer0 (millis/micros freeze)
+  static bool _Interrupts = true;          // SREG I bit, set by the Arduino core before setup()
+  static bool _InIsr = false;
+  static uint8_t _Pcifr = 0;               // Pending pin change interrupt groups
+  static uint8_t _PcLevel[NumPins];        // Last level of each pin enabled for pin change interrupts
+  static bool _PcArmed[NumPins];
+  static uint8_t _SleepMode = SLEEP_MODE_IDLE;
+  static bool _SleepEnabled = false;
+  static bool _Woken = false;
+  static uint8_t _Eeprom[E2END + 1];
+
+  void reset()
+  {
+    _Cost = CostModel();
+    _Counters = Counters();
+    _Device = 0;
+    _NowNs = 0;
+    _WatchdogNs = 0;
+    for (int i = 0; i < NumPins; i++)
+    {
+      _Mode[i] = INPUT;
+      _Latch[i] = LOW;
+    }
+    _Spinning = false;
+    _MrdyLow = false;
+    _SerialFreeAtNs = 0;
+    _Interrupts = true;
+    _Timer0StoppedNs = 0;
+    _InIsr = false;
+    _Pcifr = 0;
+    for (int i = 0; i < NumPins; i++)
+    {
+      _PcArmed[i] = false;
+    }
+    PCICR = 0;
+    PCMSK0 = 0;
+    PCMSK1 = 0;
+    PCMSK2 = 0;
+    _SleepMode = SLEEP_MODE_IDLE;
+    _SleepEnabled = false;
+    memset(_Eeprom, 0xFF, sizeof(_Eeprom));
+  }
+
+  void attach(Device *Dev) { _Device = Dev; }
+  void setHandshakePins(uint8_t Srdy, uint8_t Mrdy) { _SrdyPin = Srdy; _MrdyPin = Mrdy; }
+  CostModel &cost() { return _Cost; }
+  Counters &counters() { return _Counters; }
+  void setWatchdog(uint64_t LimitNs) { _WatchdogNs = LimitNs; }
+  void setSerialEcho(bool Echo) { _SerialEcho = Echo; }
+  uint64_t nowNs() { return _NowNs; }
+  uint8_t *eeprom() { return _Eeprom; }
+
+  Counters snapshot()
+  {
+    Counters c = _Counters;
+    if (_MrdyLow)
+    {
+      c.mrdy_low_ns += _NowNs - _MrdyLowSinceNs;
+    }
+    return c;
+  }
+
+  Counters diff(const Counters &Before, const Counters &After)
+  {
+    Counters d;
+    d.spi_bytes = After.spi_bytes - Before.spi_bytes;
+    d.spi_calls = After.spi_calls - Before.spi_calls;
+    d.spi_ns = After.spi_ns - Before.spi_ns;
+    d.srdy_reads = After.srdy_reads - Before.srdy_reads;
+    d.srdy_wait_ns = After.srdy_wait_ns - Before.srdy_wait_ns;
+    d.mrdy_low_ns = After.mrdy_low_ns - Before.mrdy_low_ns;
+    d.sleep_ns = After.sleep_ns - Before.sleep_ns;
+    d.wakeups = After.wakeups - Before.wakeups;
+    d.digital_reads = After.digital_reads - Before.digital_reads;
+    d.digital_writes = After.digital_writes - Before.digital_writes;
+    d.serial_bytes = After.serial_bytes - Before.serial_bytes;
+    d.serial_block_ns = After.serial_block_ns - Before.serial_block_ns;
+    d.eeprom_writes = After.eeprom_writes - Before.eeprom_writes;
+    return d;
+  }
+
+  void delayNs(uint64_t Ns)
+  {
+    _Spinning = false;
+    advanceNs(Ns);
+  }
+
+  /*
+    Pin change interrupts
+    Latches a change on every pin enabled in PCICR and PCMSKn (ATmega328P mapping: D0-D7 PCINT2,
+    D8-D13 PCINT0, A0-A5 PCINT1) and runs the pending vectors while interrupts are enabled.
+  */
+  static void _PinChangeInterrupts()
+  {
+    for (uint8_t Pin = 0; Pin <= 19; Pin++)
+    {
+      uint8_t Group = Pin <= 7 ? 2 : (Pin <= 13 ? 0 : 1);
+      uint8_t Mask = Group == 0 ? PCMSK0 : (Group == 1 ? PCMSK1 : PCMSK2);
+      uint8_t Bit = Pin <= 7 ? Pin : (Pin <= 13 ? Pin - 8 : Pin - 14);
+      if (!(PCICR & (1 << Group)) || !(Mask & (1 << Bit)))
+      {
+        _PcArmed[Pin] = false;
+        continue;
+      }
+      uint8_t Level = (_Device && _Device->drivesPin(Pin)) ? _Device->pinRead(Pin) : pinLevel(Pin);
+      if (_PcArmed[Pin] && Level != _PcLevel[Pin])
+      {
+        _Pcifr |= 1 << Group;
+      }
+      _PcLevel[Pin] = Level;
+      _PcArmed[Pin] = true;
+    }
+
+    if (!_Interrupts || _InIsr || _Pcifr == 0)
+    {
+      return;
+    }
+    _InIsr = true;
+    for (uint8_t Group = 0; Group < 3; Group++)
+    {
+      if (_Pcifr & (1 << Group))
+      {
+        _Pcifr &= ~(1 << Group);
+        void (*Vector)(void) = Group == 0 ? PCINT0_vect : (Group == 1 ? PCINT1_vect : PCINT2_vect);
+        if (Vector)
+        {
+          Vector();
+        }
+        _Woken = true;
+      }
+    }
+    _InIsr = false;
+  }
+
+  void advanceNs(uint64_t Ns)
+  {
+    _NowNs += Ns;
+    if (_WatchdogNs != 0 && _NowNs > _WatchdogNs)
+    {
+      throw std::runtime_error("modeled time limit exceeded (MCU hung)");
+    }
+    if (_Device)
+    {
+      _Device->update();
+    }
+    if (PCICR)
+    {
+      _PinChangeInterrupts();
+    }
+  }
+
+  uint64_t timer0Ns() { return _NowNs - _Timer0StoppedNs; }
+
+  bool interrupts() { return _Interrupts; }
+  void setInterrupts(bool Enabled) { _Interrupts = Enabled; }
+  void setSleepMode(uint8_t Mode) { _SleepMode = Mode; }
+  void setSleepEnabled(bool Enabled) { _SleepEnabled = Enabled; }
+
+  /*
+    Sleep until a pin change interrupt, or the next Timer0 overflow in SLEEP_MODE_IDLE.  With
+    interrupts disabled nothing wakes the MCU and the watchdog limit reports the hang.
+  */
+  void sleepCpu()
+  {
+    if (!_SleepEnabled)
+    {
+      return;
+    }
+    const uint64_t StepNs = 2000;
+    const uint64_t Timer0Ns = 1024000;
+    uint64_t Start = _NowNs;
+    uint64_t Tick = _NowNs / Timer0Ns;
+    _Spinning = false;
+    _Woken = false;
+    while (!_Woken)
+    {
+      advanceNs(StepNs);
+      if (_SleepMode == SLEEP_MODE_IDLE && _Interrupts && _NowNs / Timer0Ns != Tick)
+      {
+        break;
+      }
+    }
+    if (_Woken)
+    {
+      _Counters.wakeups++;
+    }
+    _Counters.sleep_ns += _NowNs - Start;
+    if (_SleepMode != SLEEP_MODE_IDLE)
+    {
+      _Timer0StoppedNs += _NowNs - Start;
+    }
+  }
+
+  uint8_t pinModeOf(uint8_t Pin)
+  {
+    return Pin < NumPins ? _Mode[Pin] : INPUT;
+  }
+
+  uint8_t pinLevel(uint8_t Pin)
+  {
+    if (Pin >= NumPins)
+    {
+      return HIGH;
+    }
+    if (_Mode[Pin] == OUTPUT)
+    {
+      return _Latch[Pin];
+    }
+    return HIGH; // Pull-up on the MCU or on the attached device
+  }
+
+  static void _PinUpdated(uint8_t Pin)
+  {
+    if (Pin == _MrdyPin)
+    {
+      bool Low = pinLevel(Pin) == LOW;
+      if (Low && !_MrdyLow)
+      {
+        _MrdyLow = true;
+        _MrdyLowSinceNs = _NowNs;
+      }
+      else if (!Low && _MrdyLow)
+      {
+        _MrdyLow = false;
+        _Counters.mrdy_low_ns += _NowNs - _MrdyLowSinceNs;
+      }
+    }
+    if (_Device)
+    {
+      _Device->pinChanged(Pin, pinLevel(Pin));
+    }
+  }
+
+  // Back to back SRDY samples are a spin: the time between them is handshake wait
+  static void _SrdySample(bool Srdy)
+  {
+    if (Srdy)
+    {
+      _Counters.srdy_reads++;
+      if (_Spinning)
+      {
+        _Counters.srdy_wait_ns += _NowNs - _LastSrdyReadNs;
+      }
+      _Spinning = true;
+      _LastSrdyReadNs = _NowNs;
+    }
+    else
+    {
+      _Spinning = false;
+    }
+  }
+
+  static uint8_t _InputLevel(uint8_t Pin)
+  {
+    if (_Device && _Device->drivesPin(Pin))
+    {
+      return _Device->pinRead(Pin);
+    }
+    return pinLevel(Pin);
+  }
+
+  int digitalRead(uint8_t Pin)
+  {
+    _Counters.digital_reads++;
+    _SrdySample(Pin == _SrdyPin);
+    advanceNs(_Cost.digital_read_ns);
+    return _InputLevel(Pin);
+  }
+
+  // Arduino pin of bit Bit of port PB, PC or PD, or -1
+  static int _PortPin(uint8_t Port, uint8_t Bit)
+  {
+    switch (Port)
+    {
+      case PB: return Bit <= 5 ? 8 + Bit : -1;
+      case PC: return Bit <= 5 ? 14 + Bit : -1;
+      case PD: return Bit;
+    }
+    return -1;
+  }
+
+  static uint8_t _PortLatches(uint8_t Port)
+  {
+    uint8_t Val = 0;
+    for (uint8_t Bit = 0; Bit < 8; Bit++)
+    {
+      int Pin = _PortPin(Port, Bit);
+      if (Pin >= 0 && _Latch[Pin])
+      {
+        Val |= 1 << Bit;
+      }
+    }
+    return Val;
+  }
+
+  uint8_t portRead(uint8_t Port, bool Input)
+  {
+    if (!Input)
+    {
+      advanceNs(_Cost.port_read_ns);
+      return _PortLatches(Port);
+    }
+    bool Srdy = false;
+    for (uint8_t Bit = 0; Bit < 8; Bit++)
+    {
+      Srdy |= _PortPin(Port, Bit) == _SrdyPin;
+    }
+    _SrdySample(Srdy);
+    advanceNs(_Cost.port_read_ns);
+    uint8_t Val = 0;
+    for (uint8_t Bit = 0; Bit < 8; Bit++)
+    {
+      int Pin = _PortPin(Port, Bit);
+      if (Pin >= 0 && _InputLevel(Pin))
+      {
+        Val |= 1 << Bit;
+      }
+    }
+    return Val;
+  }
+
+  void portWrite(uint8_t Port, uint8_t Val)
+  {
+    _Spinning = false;
+    advanceNs(_Cost.port_write_ns);
+    for (uint8_t Bit = 0; Bit < 8; Bit++)
+    {
+      int Pin = _PortPin(Port, Bit);
+      uint8_t Level = (Val >> Bit) & 1;
+      if (Pin < 0 || _Latch[Pin] == Level)
+      {
+        continue;
+      }
+      _Latch[Pin] = Level;
+      if (_Mode[Pin] == INPUT && Level)
+      {
+        _Mode[Pin] = INPUT_PULLUP;
+      }
+      else if (_Mode[Pin] == INPUT_PULLUP && !Level)
+      {
+        _Mode[Pin] = INPUT;
+      }
+      _PinUpdated(Pin);
+    }
+  }
+
+  void digitalWrite(uint8_t Pin, uint8_t Val)
+  {
+    _Counters.digital_writes++;
+    _Spinning = false;
+    advanceNs(_Cost.digital_write_ns);
+    if (Pin < NumPins)
+    {
+      _Latch[Pin] = Val ? HIGH : LOW;
+      if (_Mode[Pin] == INPUT && Val)
+      {
+        _Mode[Pin] = INPUT_PULLUP; // AVR: writing HIGH to an input enables the pull-up
+      }
+    }
+    _PinUpdated(Pin);
+  }
+
+  void pinMode(uint8_t Pin, uint8_t Mode)
+  {
+    _Spinning = false;
+    advanceNs(_Cost.pin_mode_ns);
+    if (Pin < NumPins)
+    {
+      _Mode[Pin] = Mode;
+      if (Mode == INPUT_PULLUP)
+      {
+        _Latch[Pin] = HIGH;
+      }
+    }
+    _PinUpdated(Pin);
+  }
+
+  uint8_t spiTransfer(uint8_t Out, uint32_t ByteNs, uint32_t CallNs)
+  {
+    _Spinning = false;
+    _Counters.spi_bytes++;
+    _Counters.spi_ns += CallNs + ByteNs;
+    advanceNs(CallNs + ByteNs);
+    return _Device ? _Device->spiTransfer(Out) : 0xFF;
+  }
+
+  void serialWrite(uint8_t c)
+  {
+    uint64_t CharNs = 10ULL * 1000000000ULL / _Cost.serial_baud;
+    uint64_t Capacity = _Cost.serial_tx_buffer * CharNs;
+    _Counters.serial_bytes++;
+    if (_SerialFreeAtNs > _NowNs + Capacity)
+    {
+      uint64_t Block = _SerialFreeAtNs - Capacity - _NowNs;
+      _Counters.serial_block_ns += Block;
+      advanceNs(Block);
+    }
+    advanceNs(4000); // HardwareSerial::write() and TX ISR
+    _SerialFreeAtNs = (_SerialFreeAtNs > _NowNs ? _SerialFreeAtNs : _NowNs) + CharNs;
+    if (_SerialEcho)
+    {
+      fputc(c, stderr);
+    }
+  }
+}
+
+/*
+  Arduino core
+*/
+void pinMode(uint8_t Pin, uint8_t Mode) { hostsim::pinMode(Pin, Mode); }
+void digitalWrite(uint8_t Pin, uint8_t Val) { hostsim::digitalWrite(Pin, Val); }
+int digitalRead(uint8_t Pin) { return hostsim::digitalRead(Pin); }
+
+unsigned long millis()
+{
+  hostsim::advanceNs(hostsim::cost().millis_ns);
+  return (unsigned long) (hostsim::timer0Ns() / 1000000ULL);
+}
+
+unsigned long micros()
+{
+  hostsim::advanceNs(hostsim::cost().micros_ns);
+  return (unsigned long) (hostsim::timer0Ns() / 1000ULL);
+}
+
+volatile uint8_t PCICR = 0;
+volatile uint8_t PCMSK0 = 0;
+volatile uint8_t PCMSK1 = 0;
+volatile uint8_t PCMSK2 = 0;
+
+StatusRegister SREG;
+StatusRegister::operator uint8_t() const { return hostsim::interrupts() ? 0x80 : 0x00; }
+StatusRegister &StatusRegister::operator=(uint8_t Val) { hostsim::setInterrupts(Val & 0x80); return *this; }
+
+PortRegister PINB(PB, true), PINC(PC, true), PIND(PD, true);
+PortRegister PORTB(PB, false), PORTC(PC, false), PORTD(PD, false);
+PortRegister::operator uint8_t() const { return hostsim::portRead(_Port, _Input); }
+PortRegister &PortRegister::operator=(uint8_t Val)
+{
+  hostsim::portWrite(_Port, _Input ? (uint8_t) (hostsim::portRead(_Port, false) ^ Val) : Val);
+  return *this;
+}
+
+void cli() { hostsim::setInterrupts(false); }
+void sei() { hostsim::setInterrupts(true); }
+
+void set_sleep_mode(uint8_t Mode) { hostsim::setSleepMode(Mode); }
+void sleep_enable() { hostsim::setSleepEnabled(true); }
+void sleep_disable() { hostsim::setSleepEnabled(false); }
+void sleep_cpu() { hostsim::sleepCpu(); }
+
+/*
+  EEPROM
+*/
+static size_t eepromIndex(const void *Addr, size_t Len)
+{
+  size_t Index = (size_t) (uintptr_t) Addr;
+  if (Index + Len > E2END + 1)
+  {
+    throw std::runtime_error("EEPROM access past E2END");
+  }
+  return Index;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *Addr)
+{
+  uint8_t Val;
+  eeprom_read_block(&Val, Addr, 1);
+  return Val;
+}
+
+void eeprom_read_block(void *Dst, const void *Src, size_t Len)
+{
+  memcpy(Dst, hostsim::eeprom() + eepromIndex(Src, Len), Len);
+  hostsim::advanceNs(Len * hostsim::cost().eeprom_read_ns);
+}
+
+void eeprom_update_byte(uint8_t *Addr, uint8_t Val)
+{
+  eeprom_update_block(&Val, Addr, 1);
+}
+
+void eeprom_update_block(const void *Src, void *Dst, size_t Len)
+{
+  uint8_t *Cell = hostsim::eeprom() + eepromIndex(Dst, Len);
+  for (size_t i = 0; i < Len; i++)
+  {
+    hostsim::advanceNs(hostsim::cost().eeprom_read_ns);
+    if (Cell[i] != ((const uint8_t*) Src)[i])
+    {
+      Cell[i] = ((const uint8_t*) Src)[i];
+      hostsim::counters().eeprom_writes++;
+      hostsim::advanceNs(hostsim::cost().eeprom_write_ns);
+    }
+  }
+}
+
+void delay(unsigned long Ms)
+{
+  // Advance in 1 ms steps so the attached device sees time pass
+  for (unsigned long i = 0; i < Ms; i++)
+  {
+    hostsim::delayNs(1000000ULL);
+  }
+}
+
+void delayMicroseconds(unsigned int Us)
+{
+  hostsim::delayNs(Us * 1000ULL);
+}
+
+/*
+  Print
+*/
+size_t Print::write(const uint8_t *Buf, size_t Len)
+{
+  for (size_t i = 0; i < Len; i++)
+  {
+    write(Buf[i]);
+  }
+  return Len;
+}
+
+size_t Print::print(const __FlashStringHelper *s) { return print(reinterpret_cast<const char *>(s)); }
+size_t Print::print(const char *s) { return write(reinterpret_cast<const uint8_t *>(s), strlen(s)); }
+size_t Print::print(char c) { return write((uint8_t) c); }
+size_t Print::print(unsigned char n, int Base) { return printNumber(n, Base); }
+size_t Print::print(int n, int Base) { return print((long) n, Base); }
+size_t Print::print(unsigned int n, int Base) { return printNumber(n, Base); }
+size_t Print::print(unsigned long n, int Base) { return printNumber(n, Base); }
+
+size_t Print::print(long n, int Base)
+{
+  if (Base == DEC && n < 0)
+  {
+    return print('-') + printNumber((unsigned long) -n, DEC);
+  }
+  return printNumber((unsigned long) n, Base);
+}
+
+size_t Print::print(double n, int Digits)
+{
+  char Buf[32];
+  snprintf(Buf, sizeof(Buf), "%.*f", Digits, n);
+  return print(Buf);
+}
+
+size_t Print::println() { return print("\r\n"); }
+size_t Print::println(const __FlashStringHelper *s) { return print(s) + println(); }
+size_t Print::println(const char *s) { return print(s) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char n, int Base) { return print(n, Base) + println(); }
+size_t Print::println(int n, int Base) { return print(n, Base) + println(); }
+size_t Print::println(unsigned int n, int Base) { return print(n, Base) + println(); }
+size_t Print::println(long n, int Base) { return print(n, Base) + println(); }
+size_t Print::println(unsigned long n, int Base) { return print(n, Base) + println(); }
+size_t Print::println(double n, int Digits) { return print(n, Digits) + println(); }
+
+size_t Print::printNumber(unsigned long n, int Base)
+{
+  char Buf[8 * sizeof(long) + 1];
+  char *p = &Buf[sizeof(Buf) - 1];
+  *p = '\0';
+  if (Base < 2)
+  {
+    Base = 10;
+  }
+  do
+  {
+    char c = n % Base;
+    n /= Base;
+    *--p = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return print(p);
+}
+
+/*
+  HardwareSerial
+*/
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long Baud)
+{
+  hostsim::cost().serial_baud = Baud;
+}
+
+void HardwareSerial::flush()
+{
+  // Wait for the modeled TX buffer to drain
+  for (int i = 0; i < 64; i++)
+  {
+    hostsim::advanceNs(10ULL * 1000000000ULL / hostsim::cost().serial_baud);
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  hostsim::serialWrite(c);
+  return 1;
+}
@@ -0,0 +1,188 @@
+/*
+  Arduino.h (host stub)
+  The subset of the Arduino AVR core used by the VT1100MiniSPI library, backed by HostSim.
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef F_CPU
+  #define F_CPU 8000000UL
+#endif
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+
+void pinMode(uint8_t Pin, uint8_t Mode);
+void digitalWrite(uint8_t Pin, uint8_t Val);
+int digitalRead(uint8_t Pin);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long Ms);
+void delayMicroseconds(unsigned int Us);
+
+/*
+  avr/interrupt.h and pins_arduino.h (ATmega328P)
+  Pin change interrupts are modeled by HostSim: a change on a pin enabled in PCICR and PCMSKn calls
+  the PCINTn_vect defined with ISR(), as long as interrupts are enabled (sei).
+*/
+extern volatile uint8_t PCICR;
+extern volatile uint8_t PCMSK0;
+extern volatile uint8_t PCMSK1;
+extern volatile uint8_t PCMSK2;
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#ifndef _BV
+  #define _BV(bit) (1 << (bit))
+#endif
+#define digitalPinToPCICR(p) (((p) >= 0 && (p) <= 21) ? (&PCICR) : ((volatile uint8_t *) 0))
+#define digitalPinToPCICRbit(p) (((p) <= 7) ? 2 : (((p) <= 13) ? 0 : 1))
+#define digitalPinToPCMSK(p) (((p) <= 7) ? (&PCMSK2) : (((p) <= 13) ? (&PCMSK0) : (((p) <= 21) ? (&PCMSK1) : ((volatile uint8_t *) 0))))
+#define digitalPinToPCMSKbit(p) (((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))
+
+#define ISR(vector) extern "C" void vector(void)
+extern "C" void PCINT0_vect(void) __attribute__((weak));
+extern "C" void PCINT1_vect(void) __attribute__((weak));
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+void cli();
+void sei();
+
+/*
+  SREG
+  Only the I bit is modeled: reading returns 0x80 while interrupts are enabled and writing restores it, as in
+  "uint8_t Sreg = SREG; cli(); ... SREG = Sreg;".
+*/
+class StatusRegister
+{
+  public:
+  operator uint8_t() const;
+  StatusRegister &operator=(uint8_t Val);
+};
+extern StatusRegister SREG;
+
+/*
+  Port registers (ATmega328P: D0-D7 PORTD, D8-D13 PORTB, A0-A5 PORTC)
+  PINx and PORTx are objects so a direct register access costs modeled time and reaches the attached
+  device like digitalRead() and digitalWrite().  Writing PINx toggles the PORTx bits, as on the AVR.
+*/
+class PortRegister
+{
+  public:
+  PortRegister(uint8_t Port, bool Input) : _Port(Port), _Input(Input) {}
+  operator uint8_t() const;
+  PortRegister &operator=(uint8_t Val);
+  PortRegister &operator|=(uint8_t Val) { return *this = (uint8_t) (*this | Val); }
+  PortRegister &operator&=(uint8_t Val) { return *this = (uint8_t) (*this & Val); }
+
+  private:
+  uint8_t _Port;
+  bool _Input;
+};
+extern PortRegister PINB, PINC, PIND, PORTB, PORTC, PORTD;
+
+#define NOT_A_PORT 0
+#define PB 2
+#define PC 3
+#define PD 4
+#define digitalPinToPort(P) ((P) <= 7 ? PD : ((P) <= 13 ? PB : ((P) <= 19 ? PC : NOT_A_PORT)))
+#define digitalPinToBitMask(P) ((uint8_t) _BV((P) <= 7 ? (P) : ((P) <= 13 ? (P) - 8 : (P) - 14)))
+#define portInputRegister(P) ((P) == PB ? &PINB : ((P) == PC ? &PINC : &PIND))
+#define portOutputRegister(P) ((P) == PB ? &PORTB : ((P) == PC ? &PORTC : &PORTD))
+
+// avr/pgmspace.h: flash and RAM share one address space on the host
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *) (addr))
+#define memcpy_P memcpy
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+/*
+  Print
+*/
+class Print
+{
+  public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  size_t write(const uint8_t *Buf, size_t Len);
+
+  size_t print(const __FlashStringHelper *s);
+  size_t print(const char *s);
+  size_t print(char c);
+  size_t print(unsigned char n, int Base = DEC);
+  size_t print(int n, int Base = DEC);
+  size_t print(unsigned int n, int Base = DEC);
+  size_t print(long n, int Base = DEC);
+  size_t print(unsigned long n, int Base = DEC);
+  size_t print(double n, int Digits = 2);
+
+  size_t println();
+  size_t println(const __FlashStringHelper *s);
+  size_t println(const char *s);
+  size_t println(char c);
+  size_t println(unsigned char n, int Base = DEC);
+  size_t println(int n, int Base = DEC);
+  size_t println(unsigned int n, int Base = DEC);
+  size_t println(long n, int Base = DEC);
+  size_t println(unsigned long n, int Base = DEC);
+  size_t println(double n, int Digits = 2);
+
+  private:
+  size_t printNumber(unsigned long n, int Base);
+};
+
+/*
+  Stream
+*/
+class Stream : public Print
+{
+  public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+};
+
+/*
+  HardwareSerial
+  Models a 64 byte TX buffer draining at the configured baud rate.  Writes block when the buffer is full.
+*/
+class HardwareSerial : public Stream
+{
+  public:
+  void begin(unsigned long Baud);
+  void end() {}
+  int available() { return 0; }
+  int read() { return -1; }
+  void flush();
+  size_t write(uint8_t c);
+  using Print::write;
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,120 @@
+/*
+  HostSim.h
+  Modeled time, pins and counters shared by the host-side Arduino stubs.
+
+  The library is compiled unmodified against stubs/Arduino.h and stubs/SPI.h.
+  Every stubbed Arduino call advances a modeled clock by the approximate cost
+  of that call on an 8 MHz ATmega328P (the VT1100 Mini), so the wall time
+  reported by the benchmarks is the time the MCU would be awake on the board,
+  not the time the host takes to run the simulation.
+
+  A Device (the ZNP emulator) is attached to observe pin changes and SPI
+  traffic and to drive the pins it owns (SRDY).
+*/
+
+#ifndef HostSim_h
+#define HostSim_h
+
+#include <stdint.h>
+
+namespace hostsim
+{
+  /*
+    Cost Model
+    Approximate cost of each Arduino core call at F_CPU = 8 MHz.
+  */
+  struct CostModel
+  {
+    uint32_t f_cpu = 8000000;
+    uint32_t digital_read_ns = 5000;
+    uint32_t digital_write_ns = 6000;
+    uint32_t port_read_ns = 250;           // Load of a PINx/PORTx register through a pointer (ld, 2 cycles)
+    uint32_t port_write_ns = 250;          // Store to a PORTx register through a pointer (st, 2 cycles)
+    uint32_t pin_mode_ns = 6000;
+    uint32_t millis_ns = 1500;
+    uint32_t micros_ns = 2500;
+    uint32_t spi_call_ns = 1500;           // Per SPI.transfer(byte) call: SPDR load, SPIF wait loop and return
+    uint32_t spi_block_byte_ns = 500;      // Per byte loop overhead of SPI.transfer(buf, n)
+    uint32_t spi_begin_ns = 3000;
+    uint32_t spi_end_ns = 1000;
+    uint32_t serial_baud = 115200;
+    uint32_t serial_tx_buffer = 64;
+    uint32_t serial_rx_buffer = 64;
+    uint32_t serial_read_ns = 1500;        // HardwareSerial::available() or read() from the RX buffer
+    uint32_t eeprom_read_ns = 1000;        // Per byte of eeprom_read_block()
+    uint32_t eeprom_write_ns = 3400000;    // Per byte eeprom_update_*() changes: erase and write cycle
+  };
+
+  /*
+    Counters
+    Accumulated since the last reset().  Use snapshot() and subtract to measure an operation.
+  */
+  struct Counters
+  {
+    uint64_t spi_bytes = 0;
+    uint64_t spi_calls = 0;
+    uint64_t spi_ns = 0;                   // Time spent in SPI transfers, call overhead included
+    uint64_t srdy_reads = 0;               // SRDY samples: digitalRead() of the SRDY pin or a read of its PINx register
+    uint64_t srdy_wait_ns = 0;             // Time spent spinning on SRDY (back to back SRDY reads)
+    uint64_t mrdy_low_ns = 0;              // Time MRDY was held asserted (low)
+    uint64_t digital_reads = 0;
+    uint64_t digital_writes = 0;
+    uint64_t serial_bytes = 0;
+    uint64_t serial_block_ns = 0;          // Time spent blocked on a full Serial TX buffer
+    uint64_t sleep_ns = 0;                 // Time spent in sleep_cpu()
+    uint64_t wakeups = 0;                  // Times sleep_cpu() was woken by an interrupt
+    uint64_t eeprom_writes = 0;            // EEPROM bytes written (erase and write cycles)
+  };
+
+  /*
+    Device
+    Hardware attached to the simulated MCU pins and SPI bus.
+  */
+  class Device
+  {
+    public:
+    virtual ~Device() {}
+    virtual bool drivesPin(uint8_t Pin) = 0;
+    virtual int pinRead(uint8_t Pin) = 0;
+    virtual void pinChanged(uint8_t Pin, uint8_t Level) = 0;
+    virtual uint8_t spiTransfer(uint8_t Out) = 0;
+    virtual void update() = 0;
+  };
+
+  void reset();
+  void attach(Device *Dev);
+  void setHandshakePins(uint8_t Srdy, uint8_t Mrdy);
+  CostModel &cost();
+  Counters &counters();
+  Counters snapshot();
+  Counters diff(const Counters &Before, const Counters &After);
+
+  uint64_t nowNs();
+  inline uint64_t nowUs() { return nowNs() / 1000; }
+  void advanceNs(uint64_t Ns);
+  void delayNs(uint64_t Ns);               // delay(): advances time and ends an SRDY spin
+  void setWatchdog(uint64_t LimitNs);
+
+  // Effective level of an MCU pin as seen by an attached device (output latch or pull-up).
+  uint8_t pinLevel(uint8_t Pin);
+  uint8_t pinModeOf(uint8_t Pin);
+
+  // Called by the stubs
+  int digitalRead(uint8_t Pin);
+  void digitalWrite(uint8_t Pin, uint8_t Val);
+  void pinMode(uint8_t Pin, uint8_t Mode);
+  uint8_t spiTransfer(uint8_t Out, uint32_t ByteNs, uint32_t CallNs);
+  void serialWrite(uint8_t c);
+  uint8_t portRead(uint8_t Port, bool Input);
+  void portWrite(uint8_t Port, uint8_t Val);
+  bool interrupts();
+  void setInterrupts(bool Enabled);
+  void setSleepMode(uint8_t Mode);
+  void setSleepEnabled(bool Enabled);
+  void sleepCpu();
+  uint64_t timer0Ns();                     // nowNs() less the time Timer0 was stopped in power-down: what millis() and micros() count
+  void setSerialEcho(bool Echo);
+  uint8_t *eeprom();                       // E2END + 1 bytes, kept across CC2530 objects until reset()
+}
+
+#endif
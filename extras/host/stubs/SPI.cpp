@@ -0,0 +1,56 @@
+/*
+  SPI.cpp (host stub)
+*/
+
+#include "SPI.h"
+#include "HostSim.h"
+
+SPIClass SPI;
+
+void SPIClass::begin() {}
+void SPIClass::end() {}
+
+void SPIClass::beginTransaction(SPISettings Settings)
+{
+  // AVR SPI: F_CPU / 2, 4, 8 ... 128
+  uint32_t Clock = hostsim::cost().f_cpu / 2;
+  while (Clock > Settings.Clock && Clock > hostsim::cost().f_cpu / 128)
+  {
+    Clock /= 2;
+  }
+  _Clock = Clock;
+  hostsim::advanceNs(hostsim::cost().spi_begin_ns);
+}
+
+void SPIClass::endTransaction()
+{
+  hostsim::advanceNs(hostsim::cost().spi_end_ns);
+}
+
+uint32_t SPIClass::_ByteNs() const
+{
+  return (uint32_t) (8ULL * 1000000000ULL / _Clock);
+}
+
+uint8_t SPIClass::transfer(uint8_t Data)
+{
+  hostsim::counters().spi_calls++;
+  return hostsim::spiTransfer(Data, _ByteNs(), hostsim::cost().spi_call_ns);
+}
+
+uint16_t SPIClass::transfer16(uint16_t Data)
+{
+  uint16_t Hi = transfer(Data >> 8);
+  uint16_t Lo = transfer(Data & 0xFF);
+  return Hi << 8 | Lo;
+}
+
+void SPIClass::transfer(void *Buf, size_t Count)
+{
+  hostsim::counters().spi_calls++;
+  uint8_t *p = (uint8_t *) Buf;
+  for (size_t i = 0; i < Count; i++)
+  {
+    p[i] = hostsim::spiTransfer(p[i], _ByteNs(), hostsim::cost().spi_block_byte_ns);
+  }
+}
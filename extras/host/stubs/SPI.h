@@ -0,0 +1,48 @@
+/*
+  SPI.h (host stub)
+  Routes SPI traffic to the attached HostSim device.  The modeled bit rate follows the AVR
+  clock divider: the highest F_CPU / 2^n (n >= 1) that does not exceed the requested clock.
+*/
+
+#ifndef SPI_h
+#define SPI_h
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPISettings
+{
+  public:
+  SPISettings() : Clock(4000000), BitOrder(MSBFIRST), DataMode(SPI_MODE0) {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : Clock(clock), BitOrder(bitOrder), DataMode(dataMode) {}
+  uint32_t Clock;
+  uint8_t BitOrder;
+  uint8_t DataMode;
+};
+
+class SPIClass
+{
+  public:
+  void begin();
+  void end();
+  void beginTransaction(SPISettings Settings);
+  void endTransaction();
+  uint8_t transfer(uint8_t Data);
+  uint16_t transfer16(uint16_t Data);
+  void transfer(void *Buf, size_t Count);
+
+  // Modeled SPI bit clock in Hz for the current transaction
+  uint32_t effectiveClock() const { return _Clock; }
+
+  private:
+  uint32_t _ByteNs() const;
+  uint32_t _Clock = 4000000;
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,21 @@
+/*
+  avr/eeprom.h (host stub)
+  The 1 KB EEPROM of the Atmega328P, erased (0xFF) by hostsim::reset().  Reads cost about a microsecond
+  per byte, and every byte that eeprom_update_*() actually changes blocks for the 3.4 ms erase and write
+  cycle.  See hostsim::eeprom() for the contents.
+*/
+
+#ifndef avr_eeprom_h
+#define avr_eeprom_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define E2END 0x3FF
+
+uint8_t eeprom_read_byte(const uint8_t *Addr);
+void eeprom_read_block(void *Dst, const void *Src, size_t Len);
+void eeprom_update_byte(uint8_t *Addr, uint8_t Val);
+void eeprom_update_block(const void *Src, void *Dst, size_t Len);
+
+#endif
@@ -0,0 +1,24 @@
+/*
+  avr/sleep.h (host stub)
+  sleep_cpu() advances the modeled clock until an interrupt wakes the MCU: a pin change interrupt in
+  any mode, or the Timer0 overflow (every 1.024 ms, which keeps millis() running) in SLEEP_MODE_IDLE.
+*/
+
+#ifndef avr_sleep_h
+#define avr_sleep_h
+
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE 0x00
+#define SLEEP_MODE_ADC 0x02
+#define SLEEP_MODE_PWR_DOWN 0x04
+#define SLEEP_MODE_PWR_SAVE 0x06
+#define SLEEP_MODE_STANDBY 0x0C
+#define SLEEP_MODE_EXT_STANDBY 0x0E
+
+void set_sleep_mode(uint8_t Mode);
+void sleep_enable();
+void sleep_disable();
+void sleep_cpu();
+
+#endif
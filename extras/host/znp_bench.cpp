@@ -0,0 +1,1246 @@
+/*
+  znp_bench.cpp
+  Transaction benchmarks for the CC2530 class against the ZNP emulator.
+
+  Each operation runs on a fresh modeled board and reports:
+  wall_ms     Modeled wall time for the operation
+  spi_B       Bytes clocked over SPI
+  B/us        SPI throughput: bytes clocked per microsecond spent in SPI transfers
+  srdy_rd     Number of SRDY samples (handshake polls)
+  hs_wait_us  Time spent spinning on SRDY
+  mrdy_us     Time MRDY (SPI transaction) was held asserted
+  ser_B       Debug bytes written to Serial
+  sleep_ms    Time the MCU spent in sleep_cpu() (SetSRDY_INTERRUPT)
+
+  Every operation is also checked against the emulator state, so the suite doubles as a
+  regression test: the exit status is non-zero if any check fails.
+
+  Usage: znp_bench [-v]   (-v echoes the library's Serial output to stderr)
+
+  Built twice by the Makefile: znp_bench with the library defaults and znp_bench_trace with
+  Serial debug output off and CC2530_TRACE, CC2530_DEVICES and CC2530_UART on, which adds checks
+  of the trace ring, the device table and the UART transport.
+*/
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "HostSim.h"
+#include "ZnpEmulator.h"
+#include "GatewayDecoder.h"
+#include "VT1100MiniSPI.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// SRDY is on D8 (PCINT0), as a sketch using SetSRDY_INTERRUPT() would route it
+ISR(PCINT0_vect)
+{
+  CC2530::SRDY_ISR();
+}
+
+/*
+  Board
+  A fresh modeled VT1100 Mini: clock at zero, emulator attached and the CC2530 class constructed.
+*/
+struct Board
+{
+  ZnpEmulator Znp;
+  std::shared_ptr<CC2530> Radio;           // shared_ptr deletes a CC2530T as the derived type
+  uint8_t Handle = 0;                      // Request handle or result kept by an operation for its check
+  uint8_t Result = 0;
+
+  Board()
+  {
+    hostsim::reset();
+    hostsim::setWatchdog(600ULL * 1000000000ULL); // 10 minutes modeled
+    hostsim::attach(&Znp);
+    Radio.reset(new CC2530());
+    SPI.begin();
+  }
+
+  ~Board()
+  {
+    hostsim::attach(0);
+  }
+
+#if CC2530_UART
+  // Drive the emulator over the UART transport instead of SPI
+  void useUart()
+  {
+    Znp.UartMode = true;
+    Radio.reset(new CC2530(Znp.Uart));
+  }
+#endif
+
+  // Bring the module up and joined, as a sketch's setup() would with commissioned NV
+  void bringUp(uint8_t LogicalType)
+  {
+    Znp.Nv[0x87] = {LogicalType};
+    Znp.NetworkFormed = true;
+    Radio->SetLOGICAL_TYPE(LogicalType);
+    Radio->POWER_UP();
+    Radio->AF_REGISTER(0x01);
+    Radio->ZDO_STARTUP_FROM_APP();
+  }
+};
+
+static int Failures = 0;
+static bool Verbose = false;
+
+static void header()
+{
+  printf("%-40s %10s %7s %6s %8s %11s %10s %7s %9s  %s\n", "operation", "wall_ms", "spi_B", "B/us", "srdy_rd", "hs_wait_us", "mrdy_us", "ser_B", "sleep_ms", "result");
+}
+
+/*
+  Measure
+  Runs Setup (unmeasured) then Op (measured) on a fresh board and evaluates Check.
+*/
+static void measure(const char *Name, std::function<void(Board &)> Setup, std::function<void(Board &)> Op, std::function<std::string(Board &)> Check)
+{
+  Board b;
+  std::string Result;
+  hostsim::Counters Before, After;
+  uint64_t StartNs = 0, EndNs = 0;
+  try
+  {
+    if (Setup)
+    {
+      Setup(b);
+    }
+    Before = hostsim::snapshot();
+    StartNs = hostsim::nowNs();
+    Op(b);
+    EndNs = hostsim::nowNs();
+    After = hostsim::snapshot();
+    Result = Check ? Check(b) : std::string();
+    if (Result.empty() && b.Znp.ProtocolErrors)
+    {
+      Result = "protocol errors: " + std::to_string(b.Znp.ProtocolErrors);
+    }
+  }
+  catch (const std::exception &e)
+  {
+    EndNs = hostsim::nowNs();
+    After = hostsim::snapshot();
+    Result = std::string("HANG: ") + e.what();
+  }
+  hostsim::Counters d = hostsim::diff(Before, After);
+  printf("%-40s %10.3f %7llu %6.3f %8llu %11.1f %10.1f %7llu %9.3f  %s\n", Name, (EndNs - StartNs) / 1e6, (unsigned long long) d.spi_bytes, d.spi_ns ? d.spi_bytes * 1e3 / d.spi_ns : 0.0, (unsigned long long) d.srdy_reads,
+         d.srdy_wait_ns / 1e3, d.mrdy_low_ns / 1e3, (unsigned long long) d.serial_bytes, d.sleep_ns / 1e6, Result.empty() ? "ok" : Result.c_str());
+  if (!Result.empty())
+  {
+    Failures++;
+  }
+}
+
+static std::string expect(bool Condition, const char *What)
+{
+  return Condition ? std::string() : std::string("FAIL: ") + What;
+}
+
+// Poll until an AREQ with the given command is in the receive buffer, bounded by Ms of modeled time
+static bool pollFor(CC2530 &Radio, uint16_t Cmd, unsigned long Ms)
+{
+  unsigned long Start = millis();
+  while (millis() - Start < Ms)
+  {
+    Radio.POLL();
+    if (Radio.NEW_DATA() && Radio.cmd_conv(Radio.ReceivedBytes[1], Radio.ReceivedBytes[2]) == Cmd)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Collects bytes written by TRACE_WRITE() and GATEWAY_WRITE()
+struct Capture : public Print
+{
+  std::vector<uint8_t> Bytes;
+  size_t write(uint8_t c) { Bytes.push_back(c); return 1; }
+};
+
+#if CC2530_TRACE
+static std::string expectEvent(CC2530 &Radio, uint8_t Index, uint8_t Type, uint16_t Cmd, uint8_t Len)
+{
+  CC2530::TraceEvent e;
+  if (!Radio.TRACE_READ(Index, e))
+  {
+    return "FAIL: trace event " + std::to_string(Index) + " missing";
+  }
+  return expect(e.Type == Type && Radio.cmd_conv(e.Cmd0, e.Cmd1) == Cmd && e.Len == Len, "trace event type, command and length");
+}
+#endif
+
+static const uint8_t ReportFrame[8] = {0x18, 0x01, 0x0A, 0x00, 0x00, 0x29, 0xD2, 0x04}; // ZCL Report Attributes: MeasuredValue int16 12.34
+
+int main(int argc, char **argv)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-v") == 0)
+    {
+      Verbose = true;
+    }
+  }
+  hostsim::setSerialEcho(Verbose);
+
+  printf("sizeof(CC2530): %u bytes\n\n", (unsigned) sizeof(CC2530));
+  header();
+
+  measure("POWER_UP", 0,
+    [](Board &b) { b.Result = b.Radio->POWER_UP(); },
+    [](Board &b) {
+      CC2530::ResetInd Ind;
+      return expect(b.Znp.Resets == 1 && b.Result == 0x00 && b.Radio->SYS_RESET_IND(Ind) && Ind.MajorRel == 2 && Ind.MinorRel == 6, "started, SYS_RESET_IND power-up, version 2.6");
+    });
+  measure("SYS_RESET_REQ",
+    [](Board &b) { b.Radio->POWER_UP(); },
+    [](Board &b) { b.Result = b.Radio->SYS_RESET_REQ(); },
+    [](Board &b) { return expect(b.Znp.Resets == 2 && b.Result == 0x02, "SYS_RESET_IND watchdog reset"); });
+  measure("POWER_UP stuck module (200 ms timeout)",
+    [](Board &b) { b.Znp.setStuck(true); b.Radio->SetRESET_TIMEOUT(200); },
+    [](Board &b) { b.Result = b.Radio->POWER_UP(); },
+    [](Board &b) { CC2530::ResetInd Ind; return expect(b.Result == 0xFF && !b.Radio->SYS_RESET_IND(Ind) && millis() < 250, "gives up after the reset timeout"); });
+
+  measure("COMMISSION (router)",
+    [](Board &b) {
+      b.Radio->SetLOGICAL_TYPE(0x01);
+      b.Radio->SetPANID(0x1234);
+      b.Radio->SetCHANLIST(15);
+      b.Radio->SetPRECFGKEY(0x01, 0x03, 0x05, 0x07, 0x09, 0x0B, 0x0D, 0x0F, 0x00, 0x02, 0x04, 0x06, 0x08, 0x0A, 0x0C, 0x0D);
+      b.Radio->SetTX_POWER(0x02);
+      b.Radio->POWER_UP();
+    },
+    [](Board &b) { b.Radio->COMMISSION(); },
+    [](Board &b) {
+      std::map<uint16_t, std::vector<uint8_t>> &Nv = b.Znp.Nv;
+      const std::vector<uint8_t> Key = {0x01, 0x03, 0x05, 0x07, 0x09, 0x0B, 0x0D, 0x0F, 0x00, 0x02, 0x04, 0x06, 0x08, 0x0A, 0x0C, 0x0D};
+      std::string r = expect(Nv.count(0x87) && Nv[0x87] == std::vector<uint8_t>{0x01}, "logical type written to NV");
+      if (r.empty()) r = expect(Nv.count(0x83) && Nv[0x83] == std::vector<uint8_t>({0x12, 0x34}), "PAN ID written to NV");
+      if (r.empty()) r = expect(Nv.count(0x84) && Nv[0x84] == std::vector<uint8_t>({0x00, 0x80, 0x00, 0x00}), "channel list written to NV");
+      if (r.empty()) r = expect(Nv.count(0x62) && Nv[0x62] == Key, "pre-configured key written to NV");
+      if (r.empty()) r = expect(Nv.count(0x35) && Nv[0x35] == std::vector<uint8_t>({0xD0, 0x07}), "poll rate written to NV");
+      bool TxPower = false;
+      for (const ZnpEmulator::Frame &f : b.Znp.Received)
+      {
+        TxPower |= ZnpEmulator::cmd(f) == 0x2114 && f[3] == 0x02;
+      }
+      return r.empty() ? expect(TxPower, "SYS_SET_TX_POWER sent") : r;
+    });
+
+  // Reprovisioning a commissioned module: Handle keeps the reset count after the full COMMISSION()
+  measure("COMMISSION_UPDATE unchanged",
+    [](Board &b) { b.Radio->SetLOGICAL_TYPE(0x02); b.Radio->POWER_UP(); b.Radio->COMMISSION(); b.Handle = b.Znp.Resets; b.Znp.Received.clear(); },
+    [](Board &b) { b.Result = b.Radio->COMMISSION_UPDATE(); },
+    [](Board &b) {
+      return expect(b.Result == 0 && b.Znp.Resets == b.Handle && b.Znp.countReceived(0x2605) == 0, "nothing written, no reset");
+    });
+  measure("COMMISSION_UPDATE poll rate changed",
+    [](Board &b) { b.Radio->SetLOGICAL_TYPE(0x02); b.Radio->POWER_UP(); b.Radio->COMMISSION(); b.Handle = b.Znp.Resets; b.Znp.Received.clear(); b.Radio->SetPOLL_RATE(0); },
+    [](Board &b) { b.Result = b.Radio->COMMISSION_UPDATE(); },
+    [](Board &b) {
+      return expect(b.Result == 1 && b.Znp.Resets == b.Handle + 1u && b.Znp.countReceived(0x2605) == 1 && b.Znp.Nv[0x35] == std::vector<uint8_t>({0x00, 0x00}), "only the poll rate written, one reset");
+    });
+  measure("COMMISSION_UPDATE PAN ID changed",
+    [](Board &b) { b.Radio->SetLOGICAL_TYPE(0x02); b.Radio->POWER_UP(); b.Radio->COMMISSION(); b.Radio->SetPANID(0x1234); },
+    [](Board &b) { b.Result = b.Radio->COMMISSION_UPDATE(); },
+    [](Board &b) { return expect(b.Result == 0xFF && b.Znp.Nv[0x83] == std::vector<uint8_t>({0x12, 0x34}), "full COMMISSION"); });
+
+  // Energy scan on a running coordinator.  Result keeps the quietest channel.
+  static uint8_t Energy[16];
+  measure("ENERGY_SCAN 16 channels (coord)",
+    [](Board &b) { b.bringUp(0x00); },
+    [](Board &b) { b.Result = b.Radio->ENERGY_SCAN(0x07FFF800, Energy); },
+    [](Board &b) { return expect(b.Result == 25 && memcmp(Energy, b.Znp.ChannelEnergy, 16) == 0 && millis() > 2200, "quietest of all channels after 16 x 138 ms"); });
+
+  measure("ENERGY_SCAN 11/15/20/25, commission on it",
+    [](Board &b) {
+      b.Radio->SetLOGICAL_TYPE(0x00);
+      b.Radio->SetCHANLIST_MASK(0x02108800);                         // Formed on one of the allowed channels
+      b.Radio->POWER_UP();
+      b.Radio->COMMISSION();
+      b.Radio->AF_REGISTER(0x01);
+      b.Radio->ZDO_STARTUP_FROM_APP();
+      b.Znp.ChannelEnergy[14] = 0xF0;                                // Channel 25 busy
+    },
+    [](Board &b) {
+      b.Result = b.Radio->ENERGY_SCAN(0x02108800, Energy, 2);
+      b.Radio->SetCHANLIST(b.Result);
+      b.Handle = b.Radio->COMMISSION_UPDATE();
+    },
+    [](Board &b) {
+      std::string Result = expect(b.Result == 15 && Energy[0] == 0xC8 && Energy[4] == 0x28 && Energy[9] == 0x32 && Energy[14] == 0xF0 && std::count(Energy, Energy + 16, 0xFF) == 12, "quietest allowed channel, others not scanned");
+      if (Result.empty()) Result = expect(b.Handle == 0xFF && b.Znp.Nv[0x84] == std::vector<uint8_t>({0x00, 0x80, 0x00, 0x00}), "commissioned on channel 15");
+      return Result;
+    });
+
+  measure("ENERGY_SCAN not started",
+    [](Board &b) { b.Radio->POWER_UP(); },
+    [](Board &b) { b.Result = b.Radio->ENERGY_SCAN(0x07FFF800, Energy); },
+    [](Board &b) { return expect(b.Result == 0 && Energy[0] == 0xFF && millis() < 1000, "refused at once"); });
+
+  measure("startup: AF_REGISTER + ZDO_STARTUP (rtr)",
+    [](Board &b) { b.Znp.Nv[0x87] = {0x01}; b.Znp.NetworkFormed = true; b.Radio->POWER_UP(); },
+    [](Board &b) { b.Radio->AF_REGISTER(0x01); b.Radio->ZDO_STARTUP_FROM_APP(); },
+    [](Board &b) { return expect(b.Znp.State == ZnpEmulator::DEV_ROUTER && b.Znp.Endpoints.size() == 1, "joined as router with endpoint 1"); });
+
+  // Endpoints described at compile time, registered from flash in one call
+  typedef CC2530::AfEndpoint<0x0A, 0x0104, 0x0302, CC2530::Clusters<0x0000, 0x0402, 0x0405> > SensorEndpoint;
+  typedef CC2530::AfEndpoint<0x0B, 0x0104, 0x0100, CC2530::Clusters<0x0000, 0x0006>, CC2530::Clusters<0x0019>, 0x02> LightEndpoint;
+  static_assert(sizeof(SensorEndpoint::Frame) == 18 && sizeof(LightEndpoint::Frame) == 18, "AF_REGISTER frame sizes");
+  measure("AF_REGISTER<> 2 endpoints from flash",
+    [](Board &b) { b.Znp.Nv[0x87] = {0x01}; b.Znp.NetworkFormed = true; b.Radio->POWER_UP(); b.Znp.Received.clear(); },
+    [](Board &b) { b.Result = b.Radio->AF_REGISTER<SensorEndpoint, LightEndpoint>(); },
+    [](Board &b) {
+      std::string Result = expect(b.Result == CC2530::SREQ_COMPLETE && b.Znp.Endpoints == std::vector<uint8_t>({0x0A, 0x0B}) && b.Znp.Received.size() == 2, "both endpoints registered");
+      if (Result.empty()) Result = expect(b.Znp.Received[0] == ZnpEmulator::Frame({0x0F, 0x24, 0x00, 0x0A, 0x04, 0x01, 0x02, 0x03, 0x01, 0x00, 0x03, 0x00, 0x00, 0x02, 0x04, 0x05, 0x04, 0x00}) &&
+                                          b.Znp.Received[1] == ZnpEmulator::Frame({0x0F, 0x24, 0x00, 0x0B, 0x04, 0x01, 0x00, 0x01, 0x02, 0x00, 0x02, 0x00, 0x00, 0x06, 0x00, 0x01, 0x19, 0x00}), "frames laid out by the compiler");
+      return Result;
+    });
+
+  measure("AF_REGISTER<> duplicate endpoint",
+    [](Board &b) { b.Znp.Nv[0x87] = {0x01}; b.Znp.NetworkFormed = true; b.Radio->POWER_UP(); b.Radio->AF_REGISTER<SensorEndpoint>(); },
+    [](Board &b) { b.Result = b.Radio->AF_REGISTER<SensorEndpoint, LightEndpoint>(); },
+    [](Board &b) { return expect(b.Result == CC2530::SREQ_COMPLETE && b.Radio->SREQ_STATUS() == 0x00 && b.Znp.countReceived(0x2400) == 3, "status of the last registration"); });
+
+  // Application processor restart: a new CC2530 object while the module stays joined.  Handle keeps the reset count.
+  measure("WARM_START joined (ed)",
+    [](Board &b) { b.bringUp(0x02); b.Radio.reset(new CC2530()); b.Handle = b.Znp.Resets; b.Znp.Received.clear(); },
+    [](Board &b) { b.Result = b.Radio->WARM_START(); },
+    [](Board &b) {
+      return expect(b.Result == ZnpEmulator::DEV_END_DEVICE && b.Znp.Resets == b.Handle && b.Znp.Received.size() == 1 && b.Znp.Endpoints.size() == 1, "device state from UTIL_GET_DEVICE_INFO, no reset or startup");
+    });
+  measure("WARM_START not joined",
+    [](Board &b) { b.Znp.Nv[0x87] = {0x02}; b.Radio->POWER_UP(); },
+    [](Board &b) { b.Result = b.Radio->WARM_START(); },
+    [](Board &b) { return expect(b.Result == 0 && b.Znp.State == ZnpEmulator::DEV_HOLD, "cold start needed"); });
+  measure("WRITE_DATA (SYS_SET_TX_POWER)",
+    [](Board &b) { b.bringUp(0x02); },
+    [](Board &b) { uint8_t TxPower[] = {0x01, 0x21, 0x14, 0x02}; b.Radio->WRITE_DATA(TxPower); },
+    [](Board &b) { return expect(b.Znp.TxPower == 0x02 && b.Radio->ReceivedBytes[1] == 0x61 && b.Radio->ReceivedBytes[2] == 0x14, "SRSP 0x6114"); });
+
+  measure("report send: AF_DATA_REQUEST 8 B",
+    [](Board &b) { b.bringUp(0x02); },
+    [](Board &b) { b.Radio->AF_DATA_REQUEST(0x00, 0x00, ReportFrame, sizeof(ReportFrame)); },
+    [](Board &b) {
+      if (b.Znp.AfSent.size() != 1) return std::string("FAIL: AF_DATA_REQUEST not received");
+      const ZnpEmulator::Frame &f = b.Znp.AfSent[0];
+      return expect(f[12] == sizeof(ReportFrame) && memcmp(&f[13], ReportFrame, sizeof(ReportFrame)) == 0, "payload delivered intact");
+    });
+
+  // 13 byte AF_DATA_REQUEST header + 51 byte payload: one 64 byte frame on the bus
+  static uint8_t AfPayload[51];
+  for (uint8_t i = 0; i < sizeof(AfPayload); i++)
+  {
+    AfPayload[i] = i;
+  }
+  auto AfFrame = [](uint32_t Clock) {
+    return [Clock](Board &b) { b.Radio->SetSPI_CLOCK(Clock); b.Radio->AF_DATA_REQUEST(0x00, 0x00, AfPayload, sizeof(AfPayload)); };
+  };
+  auto AfFrameCheck = [](Board &b) {
+    if (b.Znp.AfSent.size() != 1) return std::string("FAIL: AF_DATA_REQUEST not received");
+    const ZnpEmulator::Frame &f = b.Znp.AfSent[0];
+    return expect(f.size() == 64 && memcmp(&f[13], AfPayload, sizeof(AfPayload)) == 0, "64 byte frame delivered intact");
+  };
+  measure("AF_DATA_REQUEST 64 B frame @ 2 MHz", [](Board &b) { b.bringUp(0x02); }, AfFrame(2000000), AfFrameCheck);
+  measure("AF_DATA_REQUEST 64 B frame @ 4 MHz", [](Board &b) { b.bringUp(0x02); }, AfFrame(4000000), AfFrameCheck);
+
+  // ZCL Read Attributes Response for ModelIdentifier: header and record in RAM, string in flash
+  static const uint8_t ModelIdentifier[] PROGMEM = {'V', 'T', '1', '1', '0', '0', 'D', 'H', 'T', '1', '1'};
+  measure("AF_DATA_REQUEST_SG 3 segments, flash str",
+    [](Board &b) { b.bringUp(0x02); },
+    [](Board &b) {
+      uint8_t Header[] = {0x18, 0x07, 0x01};
+      uint8_t Record[] = {0x05, 0x00, 0x00, 0x42, sizeof(ModelIdentifier)};
+      CC2530::Segment Frame[] = {{Header, sizeof(Header), false}, {Record, sizeof(Record), false}, {ModelIdentifier, sizeof(ModelIdentifier), true}};
+      b.Result = b.Radio->AF_DATA_REQUEST_SG(0x00, 0x00, Frame, 3);
+    },
+    [](Board &b) {
+      if (b.Znp.AfSent.size() != 1) return std::string("FAIL: AF_DATA_REQUEST not received");
+      const ZnpEmulator::Frame &f = b.Znp.AfSent[0];
+      const uint8_t Expected[] = {0x18, 0x07, 0x01, 0x05, 0x00, 0x00, 0x42, 11, 'V', 'T', '1', '1', '0', '0', 'D', 'H', 'T', '1', '1'};
+      return expect(b.Result == sizeof(Expected) && f[0] == 10 + sizeof(Expected) && f[12] == sizeof(Expected) && memcmp(&f[13], Expected, sizeof(Expected)) == 0, "segments delivered in order");
+    });
+
+  measure("AF_DATA_REQUEST_SG oversize payload",
+    [](Board &b) { b.bringUp(0x02); },
+    [](Board &b) {
+      static uint8_t Big[125];
+      CC2530::Segment Frame[] = {{Big, sizeof(Big), false}, {Big, sizeof(Big), false}};
+      b.Result = b.Radio->AF_DATA_REQUEST_SG(0x00, 0x00, Frame, 2);
+    },
+    [](Board &b) { return expect(b.Result == 0 && b.Znp.AfSent.empty() && !b.Radio->SREQ_BUSY(), "rejected before the bus is used"); });
+
+  // ZCL attribute table: two Temperature Measurement attributes, Relative Humidity and a Basic string that is not reported
+  static int16_t Temperature = 2345, MinTemperature = -4000;
+  static uint16_t Humidity = 5678;
+  static const CC2530::ZclAttribute Attributes[] PROGMEM = {
+    {0x0000, 0x0005, 0x42, sizeof(ModelIdentifier), CC2530::ZCL_FLASH, ModelIdentifier},
+    {0x0402, 0x0000, 0x29, sizeof(Temperature), CC2530::ZCL_REPORTABLE, &Temperature},
+    {0x0405, 0x0000, 0x21, sizeof(Humidity), CC2530::ZCL_REPORTABLE, &Humidity},
+    {0x0402, 0x0001, 0x29, sizeof(MinTemperature), CC2530::ZCL_REPORTABLE, &MinTemperature},
+  };
+  measure("ZCL_REPORT 3 attributes, 2 clusters",
+    [](Board &b) {
+      b.bringUp(0x02);
+      b.Radio->SetZCL_ATTRIBUTES(Attributes, sizeof(Attributes) / sizeof(Attributes[0]));
+      b.Radio->ZCL_CHANGED(0x0402, 0x0000);
+      b.Radio->ZCL_CHANGED(0x0405, 0x0000);
+      b.Radio->ZCL_CHANGED(0x0402, 0x0001);
+    },
+    [](Board &b) { b.Result = b.Radio->ZCL_REPORT(); },
+    [](Board &b) {
+      if (b.Result != 2 || b.Znp.AfSent.size() != 2) return std::string("FAIL: 2 frames expected");
+      const uint8_t Temp[] = {0x18, 0x00, 0x0A, 0x00, 0x00, 0x29, 0x29, 0x09, 0x01, 0x00, 0x29, 0x60, 0xF0};
+      const uint8_t Hum[] = {0x18, 0x01, 0x0A, 0x00, 0x00, 0x21, 0x2E, 0x16};
+      const ZnpEmulator::Frame &t = b.Znp.AfSent[0], &h = b.Znp.AfSent[1];
+      std::string r = expect(t[7] == 0x02 && t[8] == 0x04 && t[12] == sizeof(Temp) && memcmp(&t[13], Temp, sizeof(Temp)) == 0, "0x0402 frame with both attributes");
+      if (r.empty()) r = expect(h[7] == 0x05 && h[8] == 0x04 && h[12] == sizeof(Hum) && memcmp(&h[13], Hum, sizeof(Hum)) == 0, "0x0405 frame, next sequence number");
+      if (r.empty()) r = expect(!b.Radio->ZCL_CHANGED(0x0000, 0x0005) && b.Radio->ZCL_REPORT() == 0, "only changed reportable attributes sent");
+      return r;
+    });
+
+  // Five 20 character strings in one cluster: 5 * 24 B records do not fit in CC2530_ZCL_PAYLOAD (80)
+  static const uint8_t Text[20] PROGMEM = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  static const CC2530::ZclAttribute Strings[] PROGMEM = {
+    {0xFC00, 0x0000, 0x42, sizeof(Text), CC2530::ZCL_REPORTABLE | CC2530::ZCL_FLASH, Text},
+    {0xFC00, 0x0001, 0x42, sizeof(Text), CC2530::ZCL_REPORTABLE | CC2530::ZCL_FLASH, Text},
+    {0xFC00, 0x0002, 0x42, sizeof(Text), CC2530::ZCL_REPORTABLE | CC2530::ZCL_FLASH, Text},
+    {0xFC00, 0x0003, 0x42, sizeof(Text), CC2530::ZCL_REPORTABLE | CC2530::ZCL_FLASH, Text},
+    {0xFC00, 0x0004, 0x42, sizeof(Text), CC2530::ZCL_REPORTABLE | CC2530::ZCL_FLASH, Text},
+  };
+  measure("ZCL_REPORT 120 B cluster, split",
+    [](Board &b) {
+      b.bringUp(0x02);
+      b.Radio->SetZCL_ATTRIBUTES(Strings, 5);
+      for (uint16_t i = 0; i < 5; i++) b.Radio->ZCL_CHANGED(0xFC00, i);
+    },
+    [](Board &b) { b.Result = b.Radio->ZCL_REPORT(); },
+    [](Board &b) {
+      return expect(b.Result == 2 && b.Znp.AfSent.size() == 2 && b.Znp.AfSent[0][12] == 3 + 3 * 24 && b.Znp.AfSent[1][12] == 3 + 2 * 24 && b.Znp.AfSent[1][14] == 0x01 && b.Znp.AfSent[1][16] == 0x03 && b.Znp.AfSent[1][19] == 20,
+                    "3 records then 2 records");
+    });
+
+  // Interview: the coordinator reads Basic cluster attributes, one of them not in the table
+  static const uint8_t ZCLVersion PROGMEM = 0x08;
+  static const uint8_t PowerSource PROGMEM = 0x03;
+  static const CC2530::ZclAttribute Basic[] PROGMEM = {
+    {0x0000, 0x0000, 0x20, sizeof(ZCLVersion), CC2530::ZCL_FLASH, &ZCLVersion},
+    {0x0000, 0x0005, 0x42, sizeof(ModelIdentifier), CC2530::ZCL_FLASH, ModelIdentifier},
+    {0x0000, 0x0007, 0x30, sizeof(PowerSource), CC2530::ZCL_FLASH, &PowerSource},
+    {0x0402, 0x0000, 0x29, sizeof(Temperature), CC2530::ZCL_REPORTABLE, &Temperature},
+  };
+  measure("ZCL_READ_ATTRIBUTES Basic, 4 IDs",
+    [](Board &b) {
+      b.bringUp(0x02);
+      b.Radio->SetZCL_ATTRIBUTES(Basic, sizeof(Basic) / sizeof(Basic[0]));
+      b.Znp.injectIncoming(0x0000, 0x0000, {0x00, 0x42, 0x00, 0x04, 0x00, 0x00, 0x00, 0x05, 0x00, 0x07, 0x00}, 0xA0, 0, 0x0B, 0x01);
+      pollFor(*b.Radio, 0x4481, 500);
+    },
+    [](Board &b) { b.Result = b.Radio->ZCL_READ_ATTRIBUTES(); },
+    [](Board &b) {
+      if (!b.Result || b.Znp.AfSent.size() != 1) return std::string("FAIL: 1 response frame expected");
+      const uint8_t Head[] = {0x18, 0x42, 0x01, 0x04, 0x00, 0x86, 0x00, 0x00, 0x00, 0x20, 0x08, 0x05, 0x00, 0x00, 0x42, sizeof(ModelIdentifier)};
+      const uint8_t Tail[] = {0x07, 0x00, 0x00, 0x30, 0x03};
+      const ZnpEmulator::Frame &f = b.Znp.AfSent[0];
+      std::string r = expect(f[5] == 0x0B && f[6] == 0x01 && f[7] == 0x00 && f[8] == 0x00 && f[12] == sizeof(Head) + sizeof(ModelIdentifier) + sizeof(Tail), "response to the requesting endpoint");
+      if (r.empty()) r = expect(memcmp(&f[13], Head, sizeof(Head)) == 0 && memcmp(&f[13 + sizeof(Head)], ModelIdentifier, sizeof(ModelIdentifier)) == 0 && memcmp(&f[13 + sizeof(Head) + sizeof(ModelIdentifier)], Tail, sizeof(Tail)) == 0, "all records, UNSUPPORTED_ATTRIBUTE for 0x0004");
+      if (r.empty()) r = expect(b.Radio->ZCL_INTERVIEWED(0x0000) && !b.Radio->ZCL_INTERVIEWED(0x0402) && !b.Radio->ZCL_INTERVIEWED(0x0006), "Basic cluster interviewed");
+      return r;
+    });
+
+  // Configure Reporting: Temperature min 60 s, max 3600 s, change 0.5 degC, and an attribute that is not in the table
+  measure("ZCL_CONFIGURE_REPORTING 2 records",
+    [](Board &b) {
+      b.bringUp(0x02);
+      b.Radio->SetZCL_ATTRIBUTES(Attributes, sizeof(Attributes) / sizeof(Attributes[0]));
+      b.Znp.injectIncoming(0x0000, 0x0402, {0x00, 0x21, 0x06, 0x00, 0x00, 0x00, 0x29, 0x3C, 0x00, 0x10, 0x0E, 0x32, 0x00, 0x00, 0x05, 0x00, 0x29, 0x3C, 0x00, 0x10, 0x0E, 0x32, 0x00}, 0xA0, 0, 0x01, 0x01);
+      pollFor(*b.Radio, 0x4481, 500);
+    },
+    [](Board &b) { b.Result = b.Radio->ZCL_CONFIGURE_REPORTING(); },
+    [](Board &b) {
+      if (!b.Result || b.Znp.AfSent.size() != 1) return std::string("FAIL: 1 response frame expected");
+      const uint8_t Expected[] = {0x18, 0x21, 0x07, 0x86, 0x00, 0x05, 0x00};
+      const ZnpEmulator::Frame &f = b.Znp.AfSent[0];
+      std::string r = expect(f[7] == 0x02 && f[8] == 0x04 && f[12] == sizeof(Expected) && memcmp(&f[13], Expected, sizeof(Expected)) == 0, "UNSUPPORTED_ATTRIBUTE for 0x0005 only");
+      return r.empty() ? expect(b.Radio->ZCL_DUE(0) == 3 && b.Radio->ZCL_REPORT() == 2, "configured attribute reported") : r;
+    });
+
+  // ZCL_DUE: every reportable attribute configured with min 60 s, max 3600 s and a change of 50, and reported at time 0
+  static const auto Configured = [](Board &b, int16_t Change) {
+    b.bringUp(0x02);
+    Temperature = 2345;
+    b.Radio->SetZCL_ATTRIBUTES(Attributes, sizeof(Attributes) / sizeof(Attributes[0]));
+    b.Radio->SetZCL_REPORTING(0x0402, 0x0000, 60, 3600, 50);
+    b.Radio->SetZCL_REPORTING(0x0405, 0x0000, 60, 3600, 50);
+    b.Radio->SetZCL_REPORTING(0x0402, 0x0001, 60, 3600, 50);
+    b.Radio->ZCL_DUE(0);
+    b.Radio->ZCL_REPORT();
+    b.Radio->AF_DATA_CONFIRM_WAIT(500);
+    b.Znp.AfSent.clear();
+    Temperature -= Change;
+  };
+  measure("ZCL_DUE change under MinInterval",
+    [](Board &b) { Configured(b, 60); },
+    [](Board &b) { b.Result = b.Radio->ZCL_DUE(30); },
+    [](Board &b) { return expect(b.Result == 0 && b.Radio->ZCL_REPORT() == 0 && b.Znp.AfSent.empty(), "nothing due, radio not used"); });
+  measure("ZCL_DUE change under reportable change",
+    [](Board &b) { Configured(b, 30); },
+    [](Board &b) { b.Result = b.Radio->ZCL_DUE(600); },
+    [](Board &b) { return expect(b.Result == 0 && b.Radio->ZCL_REPORT() == 0 && b.Znp.AfSent.empty(), "nothing due, radio not used"); });
+  measure("ZCL_DUE reportable change",
+    [](Board &b) { Configured(b, 60); },
+    [](Board &b) { b.Result = b.Radio->ZCL_DUE(600); },
+    [](Board &b) {
+      std::string r = expect(b.Result == 1 && b.Radio->ZCL_REPORT() == 1 && b.Znp.AfSent[0][12] == 3 + 5 && b.Znp.AfSent[0][16] == 0x00, "Temperature MeasuredValue reported");
+      return r.empty() ? expect(b.Radio->ZCL_DUE(700) == 0, "new value is the reference") : r;
+    });
+  measure("ZCL_DUE MaxInterval",
+    [](Board &b) { Configured(b, 0); },
+    [](Board &b) { b.Result = b.Radio->ZCL_DUE(3600); },
+    [](Board &b) { return expect(b.Result == 3 && b.Radio->ZCL_REPORT() == 2, "every attribute reported"); });
+
+  measure("ZCL_DUE int16 change across 0",
+    [](Board &b) { Configured(b, 2345 + 20); b.Radio->ZCL_DUE(600); b.Radio->ZCL_REPORT(); b.Radio->AF_DATA_CONFIRM_WAIT(500); Temperature = 20; },
+    [](Board &b) { b.Result = b.Radio->ZCL_DUE(1200); },
+    [](Board &b) {
+      std::string r = expect(b.Result == 0, "-20 to 20 under a change of 50");
+      Temperature = 40;
+      return r.empty() ? expect(b.Radio->ZCL_DUE(1300) == 1, "-20 to 40 is due") : r;
+    });
+
+  // Configure Reporting of a double and an int64: no reportable change this library compares, INVALID_DATA_TYPE for both
+  static double Ratio;
+  static int64_t Total;
+  static const CC2530::ZclAttribute Unsupported[] PROGMEM = {
+    {0xFC02, 0x0000, 0x3A, sizeof(Ratio), CC2530::ZCL_REPORTABLE, &Ratio},
+    {0xFC02, 0x0001, 0x2F, sizeof(Total), CC2530::ZCL_REPORTABLE, &Total},
+  };
+  measure("ZCL_CONFIGURE_REPORTING double, int64",
+    [](Board &b) {
+      b.bringUp(0x02);
+      b.Radio->SetZCL_ATTRIBUTES(Unsupported, 2);
+      b.Znp.injectIncoming(0x0000, 0xFC02, {0x00, 0x22, 0x06,
+                                            0x00, 0x00, 0x00, 0x3A, 0x3C, 0x00, 0x10, 0x0E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0x3F,
+                                            0x00, 0x01, 0x00, 0x2F, 0x3C, 0x00, 0x10, 0x0E, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, 0xA0, 0, 0x01, 0x01);
+      pollFor(*b.Radio, 0x4481, 500);
+    },
+    [](Board &b) { b.Result = b.Radio->ZCL_CONFIGURE_REPORTING(); },
+    [](Board &b) {
+      if (!b.Result || b.Znp.AfSent.size() != 1) return std::string("FAIL: 1 response frame expected");
+      const uint8_t Expected[] = {0x18, 0x22, 0x07, 0x8D, 0x00, 0x00, 0x00, 0x8D, 0x00, 0x01, 0x00};
+      const ZnpEmulator::Frame &f = b.Znp.AfSent[0];
+      return expect(f[12] == sizeof(Expected) && memcmp(&f[13], Expected, sizeof(Expected)) == 0, "INVALID_DATA_TYPE for both records");
+    });
+
+  // Reportable change of a single precision float and of an unsigned 32 bit value past 0x80000000, reported on change only
+  static float Pressure;
+  static uint32_t Summation;
+  static const CC2530::ZclAttribute Wide[] PROGMEM = {
+    {0xFC01, 0x0000, 0x39, sizeof(Pressure), CC2530::ZCL_REPORTABLE, &Pressure},
+    {0xFC01, 0x0001, 0x23, sizeof(Summation), CC2530::ZCL_REPORTABLE, &Summation},
+  };
+  static const auto ConfiguredWide = [](Board &b) {
+    b.bringUp(0x02);
+    Pressure = 20.0f;
+    Summation = 0;
+    float Change = 0.5f;
+    uint32_t ChangeBits;
+    memcpy(&ChangeBits, &Change, 4);
+    b.Radio->SetZCL_ATTRIBUTES(Wide, 2);
+    b.Radio->SetZCL_REPORTING(0xFC01, 0x0000, 0, 0, ChangeBits);
+    b.Radio->SetZCL_REPORTING(0xFC01, 0x0001, 0, 0, 0x20000000);
+    b.Radio->ZCL_REPORT();
+  };
+  measure("ZCL_DUE float reportable change",
+    [](Board &b) { ConfiguredWide(b); Pressure = 20.25f; },
+    [](Board &b) { b.Result = b.Radio->ZCL_DUE(10); },
+    [](Board &b) {
+      std::string r = expect(b.Result == 0, "0.25 under a change of 0.5");
+      Pressure = 19.25f;
+      return r.empty() ? expect(b.Radio->ZCL_DUE(20) == 1, "0.75 down is due") : r;
+    });
+  measure("ZCL_DUE uint32 reportable change",
+    [](Board &b) { ConfiguredWide(b); Summation = 0xF0000000; },
+    [](Board &b) { b.Result = b.Radio->ZCL_DUE(10); },
+    [](Board &b) { return expect(b.Result == 1, "0xF0000000 up from 0 is due"); });
+
+  // A 100 character string never fits in CC2530_ZCL_PAYLOAD (80), the attribute after it in the cluster is still reported
+  static const uint8_t LongText[100] PROGMEM = {0};
+  static const CC2530::ZclAttribute Oversize[] PROGMEM = {
+    {0xFC00, 0x0000, 0x42, sizeof(LongText), CC2530::ZCL_REPORTABLE | CC2530::ZCL_FLASH, LongText},
+    {0xFC00, 0x0001, 0x29, sizeof(Temperature), CC2530::ZCL_REPORTABLE, &Temperature},
+  };
+  measure("ZCL_REPORT oversize record",
+    [](Board &b) {
+      b.bringUp(0x02);
+      b.Radio->SetZCL_ATTRIBUTES(Oversize, 2);
+      b.Radio->ZCL_CHANGED(0xFC00, 0x0000);
+      b.Radio->ZCL_CHANGED(0xFC00, 0x0001);
+    },
+    [](Board &b) { b.Result = b.Radio->ZCL_REPORT(); },
+    [](Board &b) {
+      std::string r = expect(b.Result == 1 && b.Znp.AfSent.size() == 1 && b.Znp.AfSent[0][12] == 3 + 5 && b.Znp.AfSent[0][13 + 3] == 0x01, "only the int16 record sent");
+      return r.empty() ? expect(b.Radio->ZCL_REPORT() == 0, "string change cleared") : r;
+    });
+
+  // AF_DATA_CONFIRM tracking: each frame gets its own TransID, an AF_INCOMING_MSG arrives between the confirms
+  static const auto ReportTwo = [](Board &b) {
+    b.bringUp(0x02);
+    b.Radio->SetZCL_ATTRIBUTES(Attributes, sizeof(Attributes) / sizeof(Attributes[0]));
+    b.Radio->ZCL_CHANGED(0x0402, 0x0000);
+    b.Radio->ZCL_CHANGED(0x0405, 0x0000);
+  };
+  measure("ZCL_REPORT 2 frames + AF_DATA_CONFIRM_WAIT",
+    ReportTwo,
+    [](Board &b) { b.Radio->ZCL_REPORT(); b.Znp.injectIncoming(0x0000, 0x0006, {0x01, 0x02, 0x00}, 0xA0, 5000); b.Result = b.Radio->AF_DATA_CONFIRM_WAIT(500); },
+    [](Board &b) {
+      return expect(b.Result == CC2530::AF_CONFIRMED && b.Radio->AF_IN_FLIGHT() == 0 && b.Znp.AfSent[0][9] != b.Znp.AfSent[1][9] && b.Znp.AfSent[1][9] == b.Radio->AF_TRANS_ID(),
+                    "both confirmed by TransID, returned on the last confirm");
+    });
+  measure("AF_DATA_CONFIRM_WAIT failed confirm",
+    [](Board &b) { ReportTwo(b); b.Znp.ConfirmStatus = 0xE9; },
+    [](Board &b) { b.Radio->ZCL_REPORT(); b.Result = b.Radio->AF_DATA_CONFIRM_WAIT(500); },
+    [](Board &b) { return expect(b.Result == CC2530::AF_FAILED && b.Radio->AF_IN_FLIGHT() == 0, "AF_FAILED"); });
+  measure("AF_DATA_CONFIRM_WAIT 100 ms timeout",
+    [](Board &b) { ReportTwo(b); b.Znp.ConfirmLatencyUs = 1000000; },
+    [](Board &b) { b.Radio->ZCL_REPORT(); b.Result = b.Radio->AF_DATA_CONFIRM_WAIT(100); },
+    [](Board &b) { return expect(b.Result == CC2530::AF_TIMEOUT && b.Radio->AF_IN_FLIGHT() == 0 && b.Radio->AF_DATA_CONFIRM_WAIT(0) == CC2530::AF_CONFIRMED, "AF_TIMEOUT, then cleared"); });
+
+  // Adaptive TX power: two reports per round, the parent's frames received at Lqi (none with 0)
+  static const auto ReportRounds = [](Board &b, int Rounds, uint8_t Lqi) {
+    for (int i = 0; i < Rounds; i++)
+    {
+      if (Lqi)
+      {
+        b.Znp.injectIncoming(0x0000, 0x0006, {0x01, (uint8_t) i, 0x00}, Lqi);
+      }
+      b.Radio->POLL();
+      b.Radio->ZCL_CHANGED(0x0402, 0x0000);
+      b.Radio->ZCL_CHANGED(0x0405, 0x0000);
+      b.Radio->ZCL_REPORT();
+      b.Radio->AF_DATA_CONFIRM_WAIT(500);
+    }
+  };
+  measure("TX_POWER_BEGIN first run",
+    [](Board &b) { b.bringUp(0x02); },
+    [](Board &b) { b.Result = b.Radio->TX_POWER_BEGIN(1022, -10, 4); },
+    [](Board &b) { return expect(b.Result == 4 && b.Znp.TxPower == 4 && hostsim::eeprom()[1022] == 0xFF && hostsim::eeprom()[1023] == 0xFF, "Max sent, nothing stored"); });
+  measure("TX_POWER 16 confirms, LQI 0xC0",
+    [](Board &b) { ReportTwo(b); b.Radio->TX_POWER_BEGIN(1022, -10, 4); },
+    [](Board &b) { ReportRounds(b, 8, 0xC0); },
+    [](Board &b) { return expect(b.Radio->TX_POWER() == 2 && b.Znp.TxPower == 0x02 && b.Radio->TX_POWER_LQI() == 0xC0 && hostsim::eeprom()[1022] == 0xFF, "1 dBm down per 8 confirms, not stored on the way"); });
+  measure("TX_POWER 80 confirms, LQI 0x70",
+    [](Board &b) { ReportTwo(b); b.Radio->TX_POWER_BEGIN(1022, -10, 4); },
+    [](Board &b) { ReportRounds(b, 40, 0x70); },
+    [](Board &b) { return expect(b.Radio->TX_POWER() == -1 && b.Znp.TxPower == 0xFF && hostsim::eeprom()[1022] == 0xFF && hostsim::eeprom()[1023] == 0x00, "held where the margin would drop below 96, stored once settled"); });
+  measure("TX_POWER 80 confirms, no LQI",
+    [](Board &b) { ReportTwo(b); b.Radio->TX_POWER_BEGIN(1022, -10, 4); },
+    [](Board &b) { ReportRounds(b, 40, 0); },
+    [](Board &b) { return expect(b.Radio->TX_POWER() == -6 && b.Znp.TxPower == 0xFA && b.Radio->TX_POWER_LQI() == 0, "end device without downlink steps down on confirms"); });
+  measure("TX_POWER 3 failures, 200 confirms",
+    [](Board &b) { ReportTwo(b); b.Radio->TX_POWER_BEGIN(1022, -10, 4); b.Znp.ConfirmStatus = 0xE9; ReportRounds(b, 3, 0); b.Znp.ConfirmStatus = 0x00; },
+    [](Board &b) { ReportRounds(b, 100, 0); },
+    [](Board &b) { return expect(b.Radio->TX_POWER() == -4 && b.Znp.TxPower == 0xFC, "hold relaxed once 4 dBm settled"); });
+  measure("TX_POWER failed confirm",
+    [](Board &b) { ReportTwo(b); hostsim::eeprom()[1022] = 0xFB; hostsim::eeprom()[1023] = 0x04; b.Radio->TX_POWER_BEGIN(1022, -10, 4); b.Znp.ConfirmStatus = 0xE9; },
+    [](Board &b) { ReportRounds(b, 1, 0xC0); },
+    [](Board &b) {
+      std::string r = expect(b.Radio->TX_POWER() == -2 && b.Znp.TxPower == 0xFE, "-5 dBm stored, raised by 3 dBm");
+      b.Radio.reset(new CC2530());
+      return r.empty() ? expect(b.Radio->TX_POWER_BEGIN(1022, -10, 4) == -5, "unsettled level not stored") : r;
+    });
+
+  // Store and forward: readings queued in EEPROM while the parent is unreachable, drained in batches
+  static const auto Queue = [](Board &b, uint16_t Count) {
+    b.Radio->LOG_BEGIN();
+    for (uint16_t i = 0; i < Count; i++)
+    {
+      uint8_t Reading[CC2530_LOG_DATA] = {(uint8_t) i, 0x09, 0x10, 0x27};
+      b.Radio->LOG_APPEND(1000 + i * 900, Reading);
+    }
+  };
+  measure("LOG_APPEND 1 record",
+    [](Board &b) { b.Radio->LOG_BEGIN(); },
+    [](Board &b) { uint8_t Reading[CC2530_LOG_DATA] = {0x34, 0x09, 0x10, 0x27}; b.Result = b.Radio->LOG_APPEND(1000, Reading); },
+    [](Board &b) { return expect(b.Result && b.Radio->LOG_COUNT() == 1 && hostsim::eeprom()[2] == 0x01, "record queued"); });
+  measure("LOG_BEGIN 20 queued after restart",
+    [](Board &b) { Queue(b, 20); b.Radio.reset(new CC2530()); },
+    [](Board &b) { b.Result = b.Radio->LOG_BEGIN(); },
+    [](Board &b) { return expect(b.Result == 20 && b.Radio->LOG_COUNT() == 20, "queue found in EEPROM"); });
+  measure("LOG_BEGIN 100 appended, 1 KB",
+    [](Board &b) { Queue(b, 100); b.Radio.reset(new CC2530()); },
+    [](Board &b) { b.Result = b.Radio->LOG_BEGIN(); },
+    [](Board &b) { return expect(b.Result > 80 && b.Result < 100 && b.Radio->LOG_COUNT() == b.Result, "full log, oldest records overwritten"); });
+  measure("LOG_DRAIN 20 records",
+    [](Board &b) { b.bringUp(0x02); Queue(b, 20); },
+    [](Board &b) { b.Handle = b.Radio->LOG_DRAIN(0xFC00, 20000); },
+    [](Board &b) {
+      const uint8_t Head[] = {0x20, 0x4E, 0x00, 0x00, 9, 0xE8, 0x03, 0x00, 0x00, 0x00, 0x09, 0x10, 0x27};
+      std::string r = expect(b.Handle == 20 && b.Radio->LOG_COUNT() == 0 && b.Znp.AfSent.size() == 3, "20 records in 3 frames");
+      if (r.empty()) r = expect(b.Znp.AfSent[0][7] == 0x00 && b.Znp.AfSent[0][8] == 0xFC && b.Znp.AfSent[0][12] == 5 + 9 * 8 && memcmp(&b.Znp.AfSent[0][13], Head, sizeof(Head)) == 0, "Now, Count, then the oldest record");
+      if (r.empty()) r = expect(b.Znp.AfSent[2][12] == 5 + 2 * 8 && b.Znp.AfSent[2][13 + 5 + 8 + 4] == 19, "last frame ends with the newest record");
+      b.Radio.reset(new CC2530());
+      return r.empty() ? expect(b.Radio->LOG_BEGIN() == 0, "queue empty after restart") : r;
+    });
+  measure("LOG_DRAIN failed confirm",
+    [](Board &b) { b.bringUp(0x02); Queue(b, 20); b.Znp.ConfirmStatus = 0xE9; },
+    [](Board &b) { b.Handle = b.Radio->LOG_DRAIN(0xFC00, 20000); },
+    [](Board &b) {
+      std::string r = expect(b.Handle == 0 && b.Radio->LOG_COUNT() == 20 && b.Znp.AfSent.size() == 1, "stopped at the first frame, nothing removed");
+      b.Radio.reset(new CC2530());
+      return r.empty() ? expect(b.Radio->LOG_BEGIN() == 20, "still queued after restart") : r;
+    });
+  measure("LOG_DRAIN stuck module",
+    [](Board &b) { b.bringUp(0x02); Queue(b, 5); b.Radio->AF_DATA_REQUEST(0x00, 0x00, ReportFrame, sizeof(ReportFrame)); b.Znp.setStuck(true); },
+    [](Board &b) { b.Handle = b.Radio->LOG_DRAIN(0xFC00, 20000); },
+    [](Board &b) {
+      std::string r = expect(b.Handle == 0 && b.Radio->LOG_COUNT() == 5, "nothing removed");
+      return r.empty() ? expect(b.Radio->AF_IN_FLIGHT() == 1, "the sketch's report is still tracked") : r;
+    });
+  measure("LOG_APPEND after a drain",
+    [](Board &b) { b.bringUp(0x02); Queue(b, 12); b.Radio->LOG_DRAIN(0xFC00, 20000); },
+    [](Board &b) { uint8_t Reading[CC2530_LOG_DATA] = {0}; b.Radio->LOG_APPEND(20000, Reading); },
+    [](Board &b) {
+      b.Radio.reset(new CC2530());
+      return expect(b.Radio->LOG_BEGIN() == 1, "only the new record queued after restart");
+    });
+
+  measure("report confirm: POLL until 0x4480",
+    [](Board &b) { b.bringUp(0x02); b.Radio->AF_DATA_REQUEST(0x00, 0x00, ReportFrame, sizeof(ReportFrame)); },
+    [](Board &b) { pollFor(*b.Radio, 0x4480, 500); },
+    [](Board &b) { return expect(b.Radio->ReceivedBytes[1] == 0x44 && b.Radio->ReceivedBytes[2] == 0x80 && b.Radio->ReceivedBytes[3] == 0x00, "AF_DATA_CONFIRM success"); });
+
+  measure("report send AF_DATA_REQUEST_EXT 8 B",
+    [](Board &b) { b.bringUp(0x02); },
+    [](Board &b) { uint8_t IEEE[8] = {0}; b.Radio->AF_DATA_REQUEST_EXT(0x00, IEEE, ReportFrame, sizeof(ReportFrame)); },
+    [](Board &b) { return expect(b.Znp.AfSent.size() == 1 && b.Znp.AfSent[0][21] == sizeof(ReportFrame), "AF_DATA_REQUEST_EXT received"); });
+
+  measure("SREQ async: issue only",
+    [](Board &b) { b.bringUp(0x02); },
+    [](Board &b) { static uint8_t TxPower[] = {0x01, 0x21, 0x14, 0x02}; b.Handle = b.Radio->SREQ(TxPower); },
+    [](Board &b) {
+      std::string r = expect(b.Radio->SREQ_RESULT(b.Handle) == CC2530::SREQ_PENDING, "request pending after SREQ()");
+      return r.empty() ? expect(b.Radio->SREQ_WAIT(b.Handle) == CC2530::SREQ_COMPLETE && b.Znp.TxPower == 0x02, "request completes from TICK()") : r;
+    });
+
+  measure("WRITE_DATA stuck module (timeout)",
+    [](Board &b) { b.bringUp(0x02); b.Znp.setStuck(true); },
+    [](Board &b) { uint8_t TxPower[] = {0x01, 0x21, 0x14, 0x02}; b.Result = b.Radio->WRITE_DATA(TxPower); },
+    [](Board &b) { return expect(b.Result == CC2530::SREQ_TIMEOUT && !b.Radio->SREQ_BUSY(), "SREQ_TIMEOUT and bus released"); });
+
+  static const std::vector<uint8_t> Payload(32, 0x5A);
+  measure("POLL AF_INCOMING_MSG 32 B (coord)",
+    [](Board &b) { b.bringUp(0x00); b.Radio->POLL(); b.Znp.injectIncoming(0x1A2B, 0x0402, Payload, 0xA0); delay(1); },
+    [](Board &b) { b.Radio->POLL(); },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      return expect(r.AF_INCOMING_MSG() && r.ReceivedBytes[19] == Payload.size() && r.ReceivedBytes[12] == 0xA0 && memcmp(&r.ReceivedBytes[20], Payload.data(), Payload.size()) == 0, "AF_INCOMING_MSG decoded");
+    });
+
+  measure("POLL burst 6 AREQs, drain ring (coord)",
+    [](Board &b) {
+      b.bringUp(0x00);
+      while (b.Radio->NEW_DATA()) {}
+      for (int i = 0; i < 3; i++)
+      {
+        b.Znp.injectIncoming(0x1A2B + i, 0x0402, std::vector<uint8_t>(8, (uint8_t) i), 0x90);
+        b.Znp.queueAreq(0, ZnpEmulator::frame(0x44, 0x80, {0x00, 0x01, (uint8_t) i}));
+      }
+      delay(1);
+    },
+    [](Board &b) { while (b.Radio->RX_AVAILABLE() < 6 && !b.Radio->RX_DROPPED()) b.Radio->POLL(); },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      int Incoming = 0, Confirms = 0;
+      while (r.NEW_DATA())
+      {
+        uint16_t Cmd = r.cmd_conv(r.ReceivedBytes[1], r.ReceivedBytes[2]);
+        Incoming += Cmd == 0x4481 && r.ReceivedBytes[20] == Incoming;
+        Confirms += Cmd == 0x4480 && r.ReceivedBytes[5] == Confirms;
+      }
+      return expect(Incoming == 3 && Confirms == 3 && r.RX_DROPPED() == 0 && r.RX_HIGH_WATER() > 0, "all 6 frames kept in order");
+    });
+
+  measure("POLL oversize 0xF0 frame then AREQ",
+    [](Board &b) {
+      b.bringUp(0x00);
+      while (b.Radio->NEW_DATA()) {}
+      b.Znp.queueAreq(0, ZnpEmulator::frame(0x44, 0x81, std::vector<uint8_t>(0xF0, 0xEE)));
+      b.Znp.queueAreq(0, ZnpEmulator::frame(0x44, 0x80, {0x00, 0x01, 0x07}));
+      delay(1);
+    },
+    [](Board &b) { b.Radio->POLL(); b.Radio->POLL(); },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      return expect(r.RX_OVERRUNS() == 1 && r.NEW_DATA() && r.ReceivedBytes[2] == 0x80 && r.ReceivedBytes[5] == 0x07 && !r.NEW_DATA(), "oversize frame discarded, next frame intact");
+    });
+
+  // Handlers: each frame goes to the handler for its endpoint and cluster, its command or the default one, in the order received
+  static std::vector<uint16_t> Handled;                              // Cluster of an AF_INCOMING_MSG, command otherwise; high bit set by the default handler
+  static const CC2530::FrameHandler OnCluster = [](CC2530 &Radio, const uint8_t *Frame) { Handled.push_back(Frame[5] | Frame[6] << 8); };
+  static const CC2530::FrameHandler OnCmd = [](CC2530 &Radio, const uint8_t *Frame) { Handled.push_back(Radio.cmd_conv(Frame[1], Frame[2])); };
+  static const CC2530::FrameHandler OnOther = [](CC2530 &Radio, const uint8_t *Frame) { Handled.push_back(0x8000 | Radio.cmd_conv(Frame[1], Frame[2])); };
+  measure("POLL dispatch 6 frames to 3 handlers",
+    [](Board &b) {
+      b.bringUp(0x00);
+      while (b.Radio->NEW_DATA()) {}
+      Handled.clear();
+      b.Radio->ON_AF_INCOMING_MSG(0x01, 0x0006, OnCluster);
+      b.Radio->ON_AREQ(0x4481, OnCmd);
+      b.Radio->ON_AREQ(0x4480, OnCmd);
+      b.Radio->ON_AREQ(0x0000, OnOther);
+      b.Znp.injectIncoming(0x1A2B, 0x0006, {0x01, 0x02, 0x00}, 0xA0, 1000);
+      b.Znp.injectIncoming(0x1A2B, 0x0402, std::vector<uint8_t>(ReportFrame, ReportFrame + sizeof(ReportFrame)), 0xA0, 2000);
+      b.Znp.injectIncoming(0x1A2B, 0x0006, {0x01, 0x03, 0x01}, 0xA0, 3000, 0x01, 0x02);
+      b.Znp.queueAreq(4000, ZnpEmulator::frame(0x44, 0x80, {0x00, 0x01, 0x07}));
+      b.Znp.queueAreq(5000, ZnpEmulator::frame(0x45, 0xC0, {0x09}));
+      b.Znp.injectIncoming(0x1A2B, 0x0006, {0x01, 0x04, 0x02}, 0xA0, 6000);
+    },
+    [](Board &b) { while (Handled.size() < 6) b.Radio->POLL(); },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      return expect(Handled == std::vector<uint16_t>({0x0006, 0x4481, 0x4481, 0x4480, 0xC5C0, 0x0006}) && r.RX_AVAILABLE() == 0 && r.ZDO_STATE() == 0x09, "frames handled in order by the matching handler");
+    });
+
+  measure("POLL dispatch past unhandled frames",
+    [](Board &b) {
+      b.bringUp(0x00);
+      while (b.Radio->NEW_DATA()) {}
+      Handled.clear();
+      b.Radio->ON_AF_INCOMING_MSG(0x01, 0x0006, OnCluster);
+      b.Znp.injectIncoming(0x1A2B, 0x0006, {0x01, 0x02, 0x00}, 0xA0, 1000);
+      b.Znp.queueAreq(2000, ZnpEmulator::frame(0x44, 0x80, {0x00, 0x01, 0x07}));
+      b.Znp.injectIncoming(0x1A2B, 0x0006, {0x01, 0x03, 0x01}, 0xA0, 3000);
+      b.Znp.queueAreq(4000, ZnpEmulator::frame(0x45, 0xC0, {0x09}));
+      b.Znp.injectIncoming(0x1A2B, 0x0006, {0x01, 0x04, 0x02}, 0xA0, 5000);
+    },
+    [](Board &b) { while (Handled.size() < 3) b.Radio->POLL(); },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      std::string Result = expect(Handled.size() == 3 && r.RX_AVAILABLE() == 2, "frames after an unhandled one handled");
+      if (Result.empty()) Result = expect(r.NEW_DATA() && r.ReceivedBytes[2] == 0x80 && r.NEW_DATA() && r.ReceivedBytes[2] == 0xC0 && r.RX_AVAILABLE() == 0, "unhandled frames kept in order");
+      return Result;
+    });
+
+  measure("POLL dispatch, handler receives",
+    [](Board &b) {
+      b.bringUp(0x00);
+      while (b.Radio->NEW_DATA()) {}
+      b.Znp.queueAreq(1000, ZnpEmulator::frame(0x45, 0xC0, {0x01}));
+      b.Znp.queueAreq(2000, ZnpEmulator::frame(0x44, 0x80, {0x00, 0x01, 0x07}));
+      b.Znp.queueAreq(3000, ZnpEmulator::frame(0x45, 0xC0, {0x03}));
+      b.Znp.queueAreq(20000, ZnpEmulator::frame(0x45, 0xC0, {0x04}));
+      while (b.Radio->RX_AVAILABLE() < 3) b.Radio->POLL();
+      b.Radio->ON_AREQ(0x4480, [](CC2530 &Radio, const uint8_t *Frame) { uint8_t n = Radio.RX_AVAILABLE(); while (Radio.RX_AVAILABLE() == n) Radio.POLL(); });
+    },
+    [](Board &b) { b.Result = b.Radio->DISPATCH(); },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      uint8_t Order[3] = {0};
+      for (int i = 0; i < 3 && r.READ_FRAME(r.ReceivedBytes); i++) Order[i] = r.ReceivedBytes[3];
+      return expect(b.Result == 1 && Order[0] == 0x01 && Order[1] == 0x03 && Order[2] == 0x04 && r.RX_AVAILABLE() == 0, "kept frames in order, the handler's frame last");
+    });
+
+  measure("POLL dispatch, discard unhandled",
+    [](Board &b) {
+      b.bringUp(0x00);
+      while (b.Radio->NEW_DATA()) {}
+      Handled.clear();
+      b.Radio->ON_AF_INCOMING_MSG(0x01, 0x0006, OnCluster);
+      b.Radio->SetDISPATCH_DISCARD();
+      b.Znp.queueAreq(1000, ZnpEmulator::frame(0x44, 0x80, {0x00, 0x01, 0x07}));
+      b.Znp.injectIncoming(0x1A2B, 0x0006, {0x01, 0x03, 0x01}, 0xA0, 2000);
+    },
+    [](Board &b) { while (Handled.size() < 1) b.Radio->POLL(); },
+    [](Board &b) { return expect(b.Radio->RX_AVAILABLE() == 0 && b.Radio->RX_UNHANDLED() == 1, "confirm discarded and counted"); });
+
+  // Frame views read the fields of a frame where it lies in the receive ring
+  static uint32_t InjectedAt;
+  measure("AfIncomingMsg view of the ring",
+    [](Board &b) {
+      b.bringUp(0x00);
+      while (b.Radio->NEW_DATA()) {}
+      b.Znp.TransSeq = 0x41;
+      InjectedAt = (uint32_t) (hostsim::nowNs() / 1000000ULL);
+      b.Znp.injectIncoming(0x1A2B, 0x0402, Payload, 0xA0, 1000, 0x08, 0x01);
+    },
+    [](Board &b) { while (b.Radio->RX_AVAILABLE() == 0) b.Radio->POLL(); },
+    [](Board &b) {
+      const uint8_t *Frame = b.Radio->PEEK_FRAME();
+      CC2530::AfIncomingMsg Msg(Frame);
+      CC2530::Segment Data = Msg.Payload();
+      std::string Result = expect(Msg && Msg.GroupId() == 0x0000 && Msg.ClusterId() == 0x0402 && Msg.SrcAddr() == 0x1A2B && Msg.SrcEndpoint() == 0x08 && Msg.DstEndpoint() == 0x01 && Msg.LinkQuality() == 0xA0 &&
+                                  Msg.SecurityUse() == 0x00 && Msg.Timestamp() == InjectedAt && Msg.TransSeqNumber() == 0x41, "fields decoded");
+      if (Result.empty()) Result = expect(Data.Data == &Frame[20] && Data.Len == Payload.size() && memcmp(Data.Data, Payload.data(), Data.Len) == 0, "payload in place");
+      if (Result.empty()) Result = expect(!CC2530::AfDataConfirm(Frame) && !CC2530::ZdoStateChangeInd(Frame), "other views false");
+      return Result;
+    });
+
+  measure("frame views of truncated frames",
+    [](Board &b) {
+      b.bringUp(0x00);
+      b.Znp.injectIncoming(0x1A2B, 0x0402, {0x18, 0x01, 0x0A, 0x00, 0x00, 0x29, 0xC4, 0x09}, 0xA0);
+      while (!b.Radio->AF_INCOMING_MSG()) b.Radio->POLL();
+    },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      int16_t Small = 0;
+      uint32_t Large = 0;
+      b.Handle = r.COPY_PAYLOAD(Small);                              // 2 of 8 bytes
+      b.Result = r.COPY_PAYLOAD(Large);
+      r.ReceivedBytes[19] = 17;                                      // Len past the end of the frame
+      b.Result |= r.COPY_PAYLOAD(Large) << 4;
+    },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      uint8_t Short[20] = {16, 0x44, 0x81, 0x00, 0x00, 0x06, 0x00, 0x2B, 0x1A};
+      uint8_t Confirm[6] = {2, 0x44, 0x80, 0x00, 0x01};
+      CC2530::AfIncomingMsg Msg(Short);
+      std::string Result = expect(b.Handle == 2 && b.Result == 4 && !CC2530::AfIncomingMsg(r.ReceivedBytes), "COPY_PAYLOAD bounded by the value and the frame");
+      if (Result.empty()) Result = expect(!Msg && Msg.ClusterId() == 0 && Msg.SrcAddr() == 0 && Msg.Payload().Data == 0 && Msg.Payload().Len == 0, "short AF_INCOMING_MSG reads 0");
+      if (Result.empty()) Result = expect(!CC2530::AfDataConfirm(Confirm) && CC2530::AfDataConfirm(Confirm).TransId() == 0 && !CC2530::ZdoLeaveInd(Short), "short AF_DATA_CONFIRM reads 0");
+      return Result;
+    });
+
+  // The MCU waits 200 ms for a frame: polling SRDY, then asleep until the SRDY pin change interrupt
+  auto WaitIncoming = [](bool Interrupt, uint8_t SleepMode) {
+    return [Interrupt, SleepMode](Board &b) {
+      b.bringUp(0x00);
+      while (b.Radio->NEW_DATA()) {}
+      b.Radio->SetSRDY_INTERRUPT(Interrupt);
+      b.Radio->SetSLEEP_MODE(SleepMode);
+      b.Znp.injectIncoming(0x1A2B, 0x0402, Payload, 0xA0, 200000);
+    };
+  };
+  auto WaitIncomingCheck = [](Board &b) {
+    CC2530 &r = *b.Radio;
+    return expect(r.AF_INCOMING_MSG() && r.ReceivedBytes[19] == Payload.size() && memcmp(&r.ReceivedBytes[20], Payload.data(), Payload.size()) == 0, "AF_INCOMING_MSG after the wait");
+  };
+  measure("RECV_CALLBACK 200 ms, polling SRDY", WaitIncoming(false, SLEEP_MODE_IDLE), [](Board &b) { b.Radio->RECV_CALLBACK(); }, WaitIncomingCheck);
+  measure("RECV_CALLBACK 200 ms, SRDY int idle", WaitIncoming(true, SLEEP_MODE_IDLE), [](Board &b) { b.Radio->RECV_CALLBACK(); }, WaitIncomingCheck);
+  measure("RECV_CALLBACK 200 ms, SRDY int pwr-down", WaitIncoming(true, SLEEP_MODE_PWR_DOWN), [](Board &b) { b.Radio->RECV_CALLBACK(); }, WaitIncomingCheck);
+
+  measure("WAIT_SRDY 100 ms timeout, SRDY int idle",
+    [](Board &b) { b.bringUp(0x00); while (b.Radio->NEW_DATA()) {} b.Radio->SetSRDY_INTERRUPT(); },
+    [](Board &b) { b.Result = b.Radio->WAIT_SRDY(100); },
+    [](Board &b) { return expect(!b.Result && digitalRead(8) == HIGH, "times out with SRDY high"); });
+
+  measure("startup: ZDO_STARTUP (rtr), SRDY int",
+    [](Board &b) { b.Znp.Nv[0x87] = {0x01}; b.Znp.NetworkFormed = true; b.Radio->POWER_UP(); b.Radio->AF_REGISTER(0x01); b.Radio->SetSRDY_INTERRUPT(); b.Radio->SetSLEEP_MODE(SLEEP_MODE_PWR_DOWN); },
+    [](Board &b) { b.Radio->ZDO_STARTUP_FROM_APP(); },
+    [](Board &b) { return expect(b.Znp.State == ZnpEmulator::DEV_ROUTER && hostsim::snapshot().sleep_ns > 100000000ULL, "joined as router while asleep"); });
+
+  measure("SREQ_WAIT, SRDY int (idle)",
+    [](Board &b) { b.bringUp(0x02); b.Radio->SetSRDY_INTERRUPT(); },
+    [](Board &b) { static uint8_t TxPower[] = {0x01, 0x21, 0x14, 0x02}; b.Handle = b.Radio->SREQ(TxPower); b.Result = b.Radio->SREQ_WAIT(b.Handle); },
+    [](Board &b) { return expect(b.Result == CC2530::SREQ_COMPLETE && b.Znp.TxPower == 0x02, "request completes while the MCU idles"); });
+
+  measure("POLL idle (SRDY high)",
+    [](Board &b) { b.bringUp(0x00); b.Radio->POLL(); },
+    [](Board &b) { b.Radio->POLL(); },
+    0);
+
+  // Same transactions with the handshake pins fixed at compile time
+  measure("CC2530T<7, 8, 9, 10> WRITE_DATA",
+    [](Board &b) { b.Radio.reset(new CC2530T<7, 8, 9, 10>()); b.bringUp(0x02); },
+    [](Board &b) { uint8_t TxPower[] = {0x01, 0x21, 0x14, 0x02}; b.Radio->WRITE_DATA(TxPower); },
+    [](Board &b) { return expect(b.Znp.TxPower == 0x02 && b.Radio->ReceivedBytes[1] == 0x61 && b.Radio->ReceivedBytes[2] == 0x14, "SRSP 0x6114"); });
+
+  measure("CC2530T<7, 8, 9, 10> POLL AF_INCOMING_MSG",
+    [](Board &b) { b.Radio.reset(new CC2530T<7, 8, 9, 10>()); b.bringUp(0x00); b.Radio->POLL(); b.Znp.injectIncoming(0x1A2B, 0x0402, Payload, 0xA0); delay(1); },
+    [](Board &b) { b.Radio->POLL(); },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      return expect(r.AF_INCOMING_MSG() && r.ReceivedBytes[19] == Payload.size() && memcmp(&r.ReceivedBytes[20], Payload.data(), Payload.size()) == 0, "AF_INCOMING_MSG decoded");
+    });
+
+#if CC2530_TRACE
+  measure("trace: WRITE_DATA SREQ + SRSP",
+    [](Board &b) { b.bringUp(0x02); b.Radio->TRACE_CLEAR(); },
+    [](Board &b) { uint8_t TxPower[] = {0x01, 0x21, 0x14, 0x02}; b.Radio->WRITE_DATA(TxPower); },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      std::string Result = expect(r.TRACE_COUNT() == 2, "2 trace events");
+      if (Result.empty()) Result = expectEvent(r, 0, CC2530::TRACE_SREQ, 0x2114, 1);
+      if (Result.empty()) Result = expectEvent(r, 1, CC2530::TRACE_SRSP, 0x6114, 1);
+      CC2530::TraceEvent e;
+      r.TRACE_READ(0, e);
+      if (Result.empty()) Result = expect(e.Wait >= b.Znp.ReadyLatencyUs, "SREQ handshake wait recorded");
+      Capture Out;
+      r.TRACE_WRITE(Out);
+      if (Result.empty()) Result = expect(Out.Bytes.size() == 22 && Out.Bytes[6] == CC2530::TRACE_SREQ && Out.Bytes[7] == 0x21 && Out.Bytes[8] == 0x14, "TRACE_WRITE records");
+      return Result;
+    });
+
+  measure("trace: POLL oversize frame then AREQ",
+    [](Board &b) {
+      b.bringUp(0x00);
+      while (b.Radio->NEW_DATA()) {}
+      b.Radio->TRACE_CLEAR();
+      b.Znp.queueAreq(0, ZnpEmulator::frame(0x44, 0x81, std::vector<uint8_t>(0xF0, 0xEE)));
+      b.Znp.queueAreq(0, ZnpEmulator::frame(0x44, 0x80, {0x00, 0x01, 0x07}));
+      delay(1);
+    },
+    [](Board &b) { b.Radio->POLL(); b.Radio->POLL(); },
+    [](Board &b) {
+      CC2530 &r = *b.Radio;
+      std::string Result = expect(r.TRACE_COUNT() == 2, "2 trace events");
+      if (Result.empty()) Result = expectEvent(r, 0, CC2530::TRACE_OVERRUN, 0x4481, 0xF0);
+      if (Result.empty()) Result = expectEvent(r, 1, CC2530::TRACE_AREQ, 0x4480, 3);
+      return Result;
+    });
+#endif
+
+  // Gateway stream: COBS framed, CRC checked records straight from the receive ring
+  static const auto Forward = [](Board &b, Print &Out) {
+    unsigned long Start = millis();
+    while (millis() - Start < 100)
+    {
+      b.Radio->POLL();
+      while (b.Radio->RX_AVAILABLE())
+      {
+        b.Radio->GATEWAY_WRITE(Out);
+      }
+    }
+  };
+  static const auto Decode = [](const std::vector<uint8_t> &Bytes, GatewayDecoder &Decoder) {
+    std::vector<GatewayRecord> Records;
+    GatewayRecord r;
+    for (uint8_t c : Bytes)
+    {
+      if (Decoder.feed(c, r))
+      {
+        Records.push_back(r);
+      }
+    }
+    return Records;
+  };
+  static Capture Stream;
+  measure("GATEWAY_WRITE 3 frames + 1 other",
+    [](Board &b) {
+      b.bringUp(0x00);
+      Stream.Bytes.clear();
+      b.Znp.TransSeq = 0x41;
+      b.Znp.injectIncoming(0x1234, 0x0402, {0x18, 0x01, 0x0A, 0x00, 0x00, 0x29, 0xC4, 0x09}, 0x80, 1000, 0x08, 0x01);
+      b.Znp.injectIncoming(0x0000, 0x0000, {0x00}, 0xFF, 2000);
+      b.Znp.queueAreq(2500, ZnpEmulator::frame(0x45, 0xC0, {0x09}));   // ZDO_STATE_CHANGE_IND, skipped
+      b.Znp.injectIncoming(0xABCD, 0xFC00, std::vector<uint8_t>(40, 0x5A), 0x30, 3000);
+    },
+    [](Board &b) { Forward(b, Stream); },
+    [](Board &b) {
+      GatewayDecoder Decoder;
+      std::vector<GatewayRecord> Records = Decode(Stream.Bytes, Decoder);
+      if (Records.size() != 3 || Decoder.Errors) return std::string("FAIL: 3 records expected");
+      if (std::count(Stream.Bytes.begin(), Stream.Bytes.end(), 0x00) != 3) return std::string("FAIL: 0x00 only as delimiter");
+      const GatewayRecord &r = Records[0];
+      std::string Result = expect(r.ClusterID == 0x0402 && r.SrcAddr == 0x1234 && r.SrcEndpoint == 0x08 && r.DstEndpoint == 0x01 && r.LinkQuality == 0x80 && r.TransSeqNumber == 0x41 &&
+                                  r.Data == std::vector<uint8_t>({0x18, 0x01, 0x0A, 0x00, 0x00, 0x29, 0xC4, 0x09}), "first record fields");
+      if (Result.empty()) Result = expect(Records[1].SrcAddr == 0x0000 && Records[1].ClusterID == 0x0000 && Records[1].Data == std::vector<uint8_t>({0x00}), "all zero record");
+      if (Result.empty()) Result = expect(Records[2].Data.size() == 40 && Records[2].TransSeqNumber == 0x43, "40 byte payload");
+      return Result.empty() ? expect(b.Radio->RX_AVAILABLE() == 0 && b.Radio->GATEWAY_SKIPPED() == 1, "ring emptied, other frame counted") : Result;
+    });
+  measure("GATEWAY_WRITE corrupt + lost bytes",
+    [](Board &b) {
+      b.bringUp(0x00);
+      Stream.Bytes.clear();
+      for (uint8_t i = 0; i < 3; i++)
+      {
+        b.Znp.injectIncoming(0x1234, 0x0402, {0x18, i, 0x0A, 0x00, 0x00, 0x29, 0xC4, 0x09}, 0x80, 1000 + i * 1000);
+      }
+    },
+    [](Board &b) { Forward(b, Stream); },
+    [](Board &b) {
+      std::vector<uint8_t> Bytes = Stream.Bytes;
+      size_t First = std::find(Bytes.begin(), Bytes.end(), 0x00) - Bytes.begin();
+      Bytes[First / 2] ^= 0x10;                                      // Bit error in the first record
+      Bytes.erase(Bytes.begin() + First + 3);                        // Byte lost from the second record
+      GatewayDecoder Decoder;
+      std::vector<GatewayRecord> Records = Decode(Bytes, Decoder);
+      return expect(Records.size() == 1 && Decoder.Errors == 2 && Records[0].Data[1] == 2, "bad records rejected, next record decoded");
+    });
+#if !DEBUG
+  // The stream shares Serial with the debug output, so its rate is measured with that off
+  measure("GATEWAY_WRITE 20 frames @ 500000 baud",
+    [](Board &b) {
+      b.bringUp(0x00);
+      Serial.begin(500000);
+      for (uint16_t i = 0; i < 20; i++)
+      {
+        b.Znp.injectIncoming(0x0100 + i, 0x0402, {0x18, (uint8_t) i, 0x0A, 0x00, 0x00, 0x29, 0xC4, 0x09}, 0x80, 1000 + i * 500);
+      }
+    },
+    [](Board &b) { Forward(b, Serial); },
+    [](Board &b) { return expect(b.Radio->RX_DROPPED() == 0 && b.Radio->RX_AVAILABLE() == 0, "all frames forwarded"); });
+#endif
+
+#if CC2530_UART
+  // UART transport: the same API over SOF/FCS framed frames, no handshake
+  measure("UART bring-up (coordinator)",
+    [](Board &b) { b.useUart(); },
+    [](Board &b) { b.bringUp(0x00); },
+    [](Board &b) {
+      return expect(b.Znp.State == ZnpEmulator::DEV_ZB_COORD && b.Znp.Endpoints.size() == 1 && b.Znp.countReceived(0x2540) == 1 && b.Radio->RX_ERRORS() == 0, "started over UART");
+    });
+  measure("UART AF_DATA_REQUEST + confirm",
+    [](Board &b) { b.useUart(); b.bringUp(0x02); },
+    [](Board &b) {
+      uint8_t Payload[8] = {0xFE, 0x01, 0x02, 0xFE, 0x00, 0x05, 0x06, 0x07};
+      b.Radio->AF_DATA_REQUEST(0x00, 0x00, Payload, sizeof(Payload));
+      b.Result = b.Radio->AF_DATA_CONFIRM_WAIT(500);
+    },
+    [](Board &b) {
+      if (b.Znp.AfSent.size() != 1) return std::string("FAIL: 1 AF_DATA_REQUEST expected");
+      const ZnpEmulator::Frame &f = b.Znp.AfSent[0];
+      return expect(b.Result == CC2530::AF_CONFIRMED && f[12] == 8 && f[13] == 0xFE && f[16] == 0xFE, "SOF bytes in the payload sent as data, confirmed");
+    });
+  measure("UART 40 frames @ 115200, 5 ms apart",
+    [](Board &b) {
+      b.useUart();
+      b.bringUp(0x00);
+      for (uint16_t i = 0; i < 40; i++)
+      {
+        b.Znp.injectIncoming(0x0100 + i, 0x0402, {0x18, (uint8_t) i, 0x0A, 0x00, 0x00, 0x29, 0xFE, 0x09}, 0x80, 1000 + i * 5000);
+      }
+    },
+    [](Board &b) {
+      unsigned long Start = millis();
+      uint8_t Count = 0;
+      while (millis() - Start < 250)
+      {
+        b.Radio->POLL();
+        while (b.Radio->AF_INCOMING_MSG())
+        {
+          Count += b.Radio->ReceivedBytes[21] == Count && b.Radio->ReceivedBytes[26] == 0xFE;
+        }
+      }
+      b.Result = Count;
+    },
+    [](Board &b) { return expect(b.Result == 40 && b.Radio->RX_ERRORS() == 0 && b.Znp.UartDropped == 0, "every frame received in order"); });
+  measure("UART noise and a bad FCS",
+    [](Board &b) {
+      b.useUart();
+      b.bringUp(0x00);
+      b.Znp.uartNoise({0x00, 0x55, 0xFE, 0x01, 0x45, 0xC0, 0x09, 0x00}); // Noise, then a frame with a bad FCS
+      b.Znp.injectIncoming(0x1234, 0x0402, {0x18, 0x01, 0x0A}, 0x80, 1000);
+    },
+    [](Board &b) {
+      unsigned long Start = millis();
+      while (millis() - Start < 20)
+      {
+        b.Radio->POLL();
+      }
+    },
+    [](Board &b) { return expect(b.Radio->RX_ERRORS() == 1 && b.Radio->AF_INCOMING_MSG() && b.Radio->ReceivedBytes[7] == 0x34, "bad frame discarded, next one received"); });
+#endif
+
+#if CC2530_DEVICES
+  // Device table on a coordinator: frames are added by POLL() whether or not the sketch reads them
+  static const uint8_t IEEE[8] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+  static const auto Announce = [](Board &b, uint16_t ShortAddr, uint64_t DelayUs) {
+    b.Znp.queueAreq(DelayUs, ZnpEmulator::frame(0x45, 0xC1, {(uint8_t) ShortAddr, (uint8_t) (ShortAddr >> 8), (uint8_t) ShortAddr, (uint8_t) (ShortAddr >> 8),
+                                                            IEEE[0], IEEE[1], IEEE[2], IEEE[3], IEEE[4], IEEE[5], IEEE[6], IEEE[7], 0x80}));
+  };
+  static const auto PollAll = [](Board &b) {
+    unsigned long Start = millis();
+    while (millis() - Start < 100)
+    {
+      b.Radio->POLL();
+      b.Radio->EMPTY_BUFFER();
+    }
+  };
+  measure("device table: announce + 3 messages",
+    [](Board &b) {
+      b.bringUp(0x00);
+      Announce(b, 0x1234, 1000);
+      b.Znp.injectIncoming(0x1234, 0x0402, {0x18, 0x01, 0x0A}, 0x80, 2000);
+      b.Znp.injectIncoming(0x1234, 0x0402, {0x18, 0x02, 0x0A}, 0x80, 3000);
+      b.Znp.TransSeq += 2;                 // Two frames lost
+      b.Znp.injectIncoming(0x1234, 0x0402, {0x18, 0x03, 0x0A}, 0x40, 4000);
+    },
+    PollAll,
+    [](Board &b) {
+      const CC2530::Device *Dev = b.Radio->DEVICE_FIND(0x1234);
+      if (Dev == 0 || b.Radio->DEVICE_COUNT() != 1) return std::string("FAIL: 1 device expected");
+      std::string r = expect(b.Radio->DEVICE_FIND_IEEE(IEEE) == Dev && Dev->Messages == 3 && Dev->Gaps == 2 && Dev->LQI == 112, "messages, gaps and rolling LQI");
+      return r.empty() ? expect(b.Radio->DEVICE_FIND(0x4321) == 0, "unknown short address") : r;
+    });
+  measure("device table: rejoin with a new address",
+    [](Board &b) {
+      b.bringUp(0x00);
+      Announce(b, 0x1234, 1000);
+      b.Znp.injectIncoming(0x1234, 0x0402, {0x18, 0x01, 0x0A}, 0x80, 2000);
+      Announce(b, 0x5678, 3000);
+    },
+    PollAll,
+    [](Board &b) {
+      const CC2530::Device *Dev = b.Radio->DEVICE_FIND(0x5678);
+      return expect(b.Radio->DEVICE_COUNT() == 1 && Dev != 0 && Dev->Messages == 1 && b.Radio->DEVICE_FIND_IEEE(IEEE) == Dev && b.Radio->DEVICE_FIND(0x1234) == 0, "same entry, new short address");
+    });
+  measure("device table: short address reused",
+    [](Board &b) {
+      b.bringUp(0x00);
+      Announce(b, 0x1234, 1000);
+      b.Znp.injectIncoming(0x1234, 0x0402, {0x18, 0x01, 0x0A}, 0x80, 2000);
+      b.Znp.queueAreq(3000, ZnpEmulator::frame(0x45, 0xC1, {0x34, 0x12, 0x34, 0x12, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x80}));
+    },
+    PollAll,
+    [](Board &b) {
+      const CC2530::Device *Dev = b.Radio->DEVICE_FIND(0x1234);
+      std::string r = expect(b.Radio->DEVICE_COUNT() == 1 && Dev != 0 && Dev->IEEEAddr[0] == 0x11 && b.Radio->DEVICE_FIND_IEEE(IEEE) == 0, "entry taken over");
+      return r.empty() ? expect(Dev->Messages == 0 && Dev->LQI == 0 && Dev->Gaps == 0, "statistics cleared") : r;
+    });
+  measure("device table: 16 IEEE, one OUI",
+    [](Board &b) {
+      b.bringUp(0x00);
+      for (uint8_t i = 0; i < 16; i++)
+      {
+        b.Znp.queueAreq(1000 + i * 1000, ZnpEmulator::frame(0x45, 0xC1, {i, 0x20, i, 0x20, i, 0x00, 0x00, 0x00, 0x4B, 0x12, 0x00, 0x00, 0x80})); // One vendor's OUI 00:12:4B
+      }
+    },
+    PollAll,
+    [](Board &b) {
+      for (uint8_t i = 0; i < 16; i++)
+      {
+        const uint8_t Addr[8] = {i, 0x00, 0x00, 0x00, 0x4B, 0x12, 0x00, 0x00};
+        const CC2530::Device *Dev = b.Radio->DEVICE_FIND_IEEE(Addr);
+        if (Dev == 0 || Dev->ShortAddr != (0x2000 | i)) return "FAIL: device " + std::to_string(i);
+      }
+      return std::string();
+    });
+  measure("device table: 40 devices, 16 entries",
+    [](Board &b) {
+      b.bringUp(0x00);
+      for (uint16_t i = 0; i < 40; i++)
+      {
+        b.Znp.injectIncoming(0x0100 + i * 0x10, 0x0402, {0x18, 0x01, 0x0A}, 0x80, 1000 + i * 1000);
+      }
+    },
+    PollAll,
+    [](Board &b) {
+      for (uint16_t i = 0; i < 40; i++)
+      {
+        const CC2530::Device *Dev = b.Radio->DEVICE_FIND(0x0100 + i * 0x10);
+        if ((i >= 24) != (Dev != 0) || (Dev && Dev->ShortAddr != 0x0100 + i * 0x10)) return "FAIL: device " + std::to_string(i);
+      }
+      b.Znp.queueAreq(0, ZnpEmulator::frame(0x45, 0xC9, {0x00, 0x03, 0, 0, 0, 0, 0, 0, 0, 0, 0x00, 0x00, 0x00})); // 0x0300 left
+      PollAll(b);
+      std::string r = expect(b.Radio->DEVICE_COUNT() == 15 && b.Radio->DEVICE_FIND(0x0300) == 0, "least recently seen replaced, leave removes");
+      for (uint16_t i = 24; i < 40 && r.empty(); i++)
+      {
+        r = expect(i == 32 || b.Radio->DEVICE_FIND(0x0100 + i * 0x10) != 0, "others still found");
+      }
+      return r;
+    });
+#endif
+
+  printf("\n%d failure(s)\n", Failures);
+  return Failures ? 1 : 0;
+}